@@ -8,9 +8,9 @@ struct Material {
     float shininess;
 };
 
+// std140 layouts of render/frame_uniforms.h
 struct DirLight {
     vec3 direction;
-
     vec3 ambient;
     vec3 diffuse;
     vec3 specular;
@@ -18,29 +18,25 @@ struct DirLight {
 
 struct PointLight {
     vec3 position;
-
     float constant;
-    float linear;
-    float quadratic;
-
     vec3 ambient;
+    float linear;
     vec3 diffuse;
+    float quadratic;
     vec3 specular;
 };
 
 struct SpotLight {
     vec3 position;
-    vec3 direction;
     float cutOff;
+    vec3 direction;
     float outerCutOff;
-
-    float constant;
-    float linear;
-    float quadratic;
-
     vec3 ambient;
+    float constant;
     vec3 diffuse;
+    float linear;
     vec3 specular;
+    float quadratic;
 };
 
 #define MAX_LIGHTS 10
@@ -49,15 +45,22 @@ in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
 
-uniform vec3 viewPos;
 uniform Material material;
 
-uniform int NrDirLights;
-uniform int NrPointLights;
-uniform int NrSpotLights;
-uniform DirLight dir_lights[MAX_LIGHTS];
-uniform PointLight point_lights[MAX_LIGHTS];
-uniform SpotLight spot_lights[MAX_LIGHTS];
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+layout (std140) uniform Lights {
+    DirLight dir_lights[MAX_LIGHTS];
+    PointLight point_lights[MAX_LIGHTS];
+    SpotLight spot_lights[MAX_LIGHTS];
+    int NrDirLights;
+    int NrPointLights;
+    int NrSpotLights;
+};
 
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
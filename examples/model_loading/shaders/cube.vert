@@ -2,13 +2,19 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNorm;
 layout (location = 2) in vec2 aTexCoord;
+layout (location = 3) in mat4 aModel;
 
-uniform mat4 mapping;
+uniform mat4 dequantization;
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
 
 out vec2 TexCoord;
 
 void main()
 {
-    gl_Position = mapping * vec4(aPos, 1.0);
+    gl_Position = projection * view * aModel * dequantization * vec4(aPos, 1.0);
     TexCoord = aTexCoord;
 }
\ No newline at end of file
@@ -117,7 +117,8 @@ int main() {
     auto shader_program = result.value();
 
     auto &model_loader = dispatcher.get_world().get<render::ModelLoader>();
-    auto model = model_loader.load_model("assets/backpack/backpack.obj").value();
+    // Rendered as soon as it is loaded, textures show placeholders until decoded
+    auto model = model_loader.load_model_async("assets/backpack/backpack.obj");
 
     auto &entities = dispatcher.get_world().get<ecs::Entities>();
     entities.create(render::Transform{glm::vec3(0.0f, 0.0f, 0.0f),
@@ -0,0 +1,40 @@
+#ifndef HIGH_SHIFT_BOUNDS_H
+#define HIGH_SHIFT_BOUNDS_H
+
+#include <cmath>
+#include <span>
+
+#include "glm/glm.hpp"
+
+/**
+ * Axis aligned box and bounding sphere of the same points.
+ * Default constructed bounds are empty and merging with them is a no-op.
+ */
+struct Bounds {
+    glm::vec3 min{INFINITY};
+    glm::vec3 max{-INFINITY};
+    glm::vec3 center{0.0f};
+    float radius = -1.0f;
+
+    /**
+     * The sphere is centered in the box, its radius is the distance to the farthest point.
+     */
+    static Bounds from_points(std::span<const glm::vec3> points);
+
+    /**
+     * Smallest box and sphere which contain both.
+     */
+    static Bounds merge(const Bounds &a, const Bounds &b);
+
+    bool empty() const { return radius < 0.0f; }
+
+    /**
+     * Bounds of the points transformed by the affine matrix. The box
+     * contains the transformed box, the sphere is scaled by the largest axis.
+     */
+    Bounds transformed(const glm::mat4 &matrix) const;
+
+    bool operator==(const Bounds &) const = default;
+};
+
+#endif //HIGH_SHIFT_BOUNDS_H
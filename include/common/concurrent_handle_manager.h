@@ -0,0 +1,293 @@
+#ifndef HIGH_SHIFT_CONCURRENT_HANDLE_MANAGER_H
+#define HIGH_SHIFT_CONCURRENT_HANDLE_MANAGER_H
+
+#include "common/handle.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <optional>
+#include <utility>
+
+enum class ResourceState : uint8_t {
+    invalid, // handle was erased or never created
+    loading,
+    ready,
+    failed,
+};
+
+/**
+ * Handle allocator which may be used from any thread, e.g. by background
+ * loaders that return a handle at once and publish the data later.
+ *
+ * Entries live in fixed-size pages which are never moved, so readers
+ * do not take locks: get, is_valid and state are wait-free.
+ * Freed entries are kept in a lock-free list whose head is tagged
+ * with a counter against ABA.
+ *
+ * Lifecycle of a handle: create (loading) -> set_ready / set_failed -> erase.
+ * set_ready, set_failed and erase of the same handle must not race with each
+ * other, and erase must not race with readers of the same handle.
+ */
+template<typename T>
+class ConcurrentHandleManager {
+public:
+    ConcurrentHandleManager() = default;
+
+    ConcurrentHandleManager(const ConcurrentHandleManager &) = delete;
+    ConcurrentHandleManager &operator=(const ConcurrentHandleManager &) = delete;
+
+    ~ConcurrentHandleManager();
+
+    /**
+     * Creates new handle in the loading state.
+     * @return invalid handle if all max_size entries are in use.
+     */
+    Handle<T> create();
+
+    /**
+     * Stores the value and makes it visible to get().
+     * @return false if handle is not loading.
+     */
+    bool set_ready(Handle<T> handle, T value);
+
+    /**
+     * @return false if handle is not loading.
+     */
+    bool set_failed(Handle<T> handle);
+
+    /**
+     * @return associated data if handle is ready, nullptr otherwise.
+     */
+    [[nodiscard]] T *get(Handle<T> handle) const;
+
+    ResourceState state(Handle<T> handle) const;
+    bool is_valid(Handle<T> handle) const;
+
+    /**
+     * Invalidates handle.
+     * @return associated data if handle was ready.
+     */
+    std::optional<T> erase(Handle<T> handle);
+
+    std::size_t size() const;
+
+    /**
+     * Calls f(Handle<T>, T &) for each ready handle.
+     * Must not run concurrently with erase.
+     */
+    template<typename Fn>
+    void foreach(Fn &&f);
+
+public:
+    static constexpr uint32_t page_shift = 10;
+    static constexpr uint32_t page_size = 1 << page_shift;
+    static constexpr uint32_t max_pages = 4096;
+    static constexpr uint32_t max_size = page_size * max_pages;
+
+private:
+    struct Entry {
+        std::atomic<uint32_t> version{0};
+        std::atomic<ResourceState> state{ResourceState::invalid};
+        std::atomic<uint32_t> next{NO_ENTRY}; // free list
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T *value() {
+            return std::launder(reinterpret_cast<T *>(storage));
+        }
+    };
+
+    static constexpr uint32_t NO_ENTRY = UINT32_MAX;
+
+    static uint64_t pack(uint32_t tag, uint32_t index) {
+        return (uint64_t) tag << 32 | index;
+    }
+
+    Entry *entry(uint32_t index) const;
+    Entry *allocate_entry(uint32_t index);
+    bool finish_loading(Handle<T> handle, Entry *&entry) const;
+
+    std::atomic<Entry *> pages[max_pages]{};
+    std::atomic<uint64_t> free_list{pack(0, NO_ENTRY)}; // tag:32 | index:32
+    std::atomic<uint32_t> next_unused{0};
+    std::atomic<std::size_t> sz{0};
+};
+
+template<typename T>
+ConcurrentHandleManager<T>::~ConcurrentHandleManager() {
+    for (auto &page_ptr : pages) {
+        Entry *page = page_ptr.load(std::memory_order_relaxed);
+        if (!page)
+            continue;
+        for (uint32_t i = 0; i < page_size; ++i)
+            if (page[i].state.load(std::memory_order_relaxed) == ResourceState::ready)
+                page[i].value()->~T();
+        delete[] page;
+    }
+}
+
+template<typename T>
+auto ConcurrentHandleManager<T>::entry(uint32_t index) const -> Entry * {
+    if (index >= max_size)
+        return nullptr;
+    Entry *page = pages[index >> page_shift].load(std::memory_order_acquire);
+    return page ? page + (index & (page_size - 1)) : nullptr;
+}
+
+template<typename T>
+auto ConcurrentHandleManager<T>::allocate_entry(uint32_t index) -> Entry * {
+    assert(index < max_size);
+    auto &page_ptr = pages[index >> page_shift];
+    Entry *page = page_ptr.load(std::memory_order_acquire);
+    if (!page) {
+        // Several threads may race for a new page, only one of them wins
+        Entry *new_page = new Entry[page_size];
+        if (page_ptr.compare_exchange_strong(page, new_page, std::memory_order_acq_rel))
+            page = new_page;
+        else
+            delete[] new_page;
+    }
+    return page + (index & (page_size - 1));
+}
+
+template<typename T>
+Handle<T> ConcurrentHandleManager<T>::create() {
+    uint32_t index;
+    Entry *e;
+
+    uint64_t head = free_list.load(std::memory_order_acquire);
+    while (true) {
+        index = (uint32_t) head;
+        if (index == NO_ENTRY) {
+            index = next_unused.load(std::memory_order_relaxed);
+            do {
+                if (index >= max_size) {
+                    Handle<T> invalid;
+                    invalid.index = NO_ENTRY;
+                    invalid.version = 0;
+                    return invalid;
+                }
+            } while (!next_unused.compare_exchange_weak(index, index + 1, std::memory_order_relaxed));
+            e = allocate_entry(index);
+            break;
+        }
+
+        // Entries are never deallocated, so reading next of a stolen head is harmless
+        e = entry(index);
+        uint32_t next = e->next.load(std::memory_order_relaxed);
+        if (free_list.compare_exchange_weak(head, pack((uint32_t) (head >> 32) + 1, next),
+                                            std::memory_order_acquire, std::memory_order_acquire))
+            break;
+    }
+
+    e->state.store(ResourceState::loading, std::memory_order_release);
+    sz.fetch_add(1, std::memory_order_relaxed);
+
+    Handle<T> handle;
+    handle.index = index;
+    handle.version = e->version.load(std::memory_order_relaxed);
+    return handle;
+}
+
+template<typename T>
+bool ConcurrentHandleManager<T>::finish_loading(Handle<T> handle, Entry *&e) const {
+    e = entry(handle.index);
+    return e && e->version.load(std::memory_order_acquire) == handle.version &&
+           e->state.load(std::memory_order_acquire) == ResourceState::loading;
+}
+
+template<typename T>
+bool ConcurrentHandleManager<T>::set_ready(Handle<T> handle, T value) {
+    Entry *e;
+    if (!finish_loading(handle, e))
+        return false;
+
+    new(e->storage) T(std::move(value));
+    e->state.store(ResourceState::ready, std::memory_order_release); // publishes the value
+    return true;
+}
+
+template<typename T>
+bool ConcurrentHandleManager<T>::set_failed(Handle<T> handle) {
+    Entry *e;
+    if (!finish_loading(handle, e))
+        return false;
+
+    e->state.store(ResourceState::failed, std::memory_order_release);
+    return true;
+}
+
+template<typename T>
+T *ConcurrentHandleManager<T>::get(Handle<T> handle) const {
+    Entry *e = entry(handle.index);
+    if (!e || e->version.load(std::memory_order_acquire) != handle.version ||
+        e->state.load(std::memory_order_acquire) != ResourceState::ready)
+        return nullptr;
+    return e->value();
+}
+
+template<typename T>
+ResourceState ConcurrentHandleManager<T>::state(Handle<T> handle) const {
+    Entry *e = entry(handle.index);
+    if (!e || e->version.load(std::memory_order_acquire) != handle.version)
+        return ResourceState::invalid;
+    return e->state.load(std::memory_order_acquire);
+}
+
+template<typename T>
+bool ConcurrentHandleManager<T>::is_valid(Handle<T> handle) const {
+    return state(handle) != ResourceState::invalid;
+}
+
+template<typename T>
+std::optional<T> ConcurrentHandleManager<T>::erase(Handle<T> handle) {
+    Entry *e = entry(handle.index);
+    if (!e || e->state.load(std::memory_order_acquire) == ResourceState::invalid)
+        return std::nullopt;
+
+    // Bumping the version invalidates the handle; only one of racing erases succeeds
+    uint32_t version = handle.version;
+    if (!e->version.compare_exchange_strong(version, version + 1, std::memory_order_acq_rel))
+        return std::nullopt;
+
+    std::optional<T> result;
+    if (e->state.load(std::memory_order_acquire) == ResourceState::ready) {
+        result.emplace(std::move(*e->value()));
+        e->value()->~T();
+    }
+    e->state.store(ResourceState::invalid, std::memory_order_release);
+    sz.fetch_sub(1, std::memory_order_relaxed);
+
+    uint64_t head = free_list.load(std::memory_order_relaxed);
+    do {
+        e->next.store((uint32_t) head, std::memory_order_relaxed);
+    } while (!free_list.compare_exchange_weak(head, pack((uint32_t) (head >> 32) + 1, handle.index),
+                                              std::memory_order_release, std::memory_order_relaxed));
+    return result;
+}
+
+template<typename T>
+std::size_t ConcurrentHandleManager<T>::size() const {
+    return sz.load(std::memory_order_relaxed);
+}
+
+template<typename T>
+template<typename Fn>
+void ConcurrentHandleManager<T>::foreach(Fn &&f) {
+    uint32_t count = std::min(next_unused.load(std::memory_order_acquire), max_size);
+    for (uint32_t index = 0; index < count; ++index) {
+        Entry *e = entry(index);
+        if (!e || e->state.load(std::memory_order_acquire) != ResourceState::ready)
+            continue;
+
+        Handle<T> handle;
+        handle.index = index;
+        handle.version = e->version.load(std::memory_order_relaxed);
+        f(handle, *e->value());
+    }
+}
+
+#endif //HIGH_SHIFT_CONCURRENT_HANDLE_MANAGER_H
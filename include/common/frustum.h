@@ -0,0 +1,48 @@
+#ifndef HIGH_SHIFT_FRUSTUM_H
+#define HIGH_SHIFT_FRUSTUM_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+/**
+ * Six planes (normal, distance) of a view volume facing inwards, with unit normals.
+ */
+struct Frustum {
+    std::array<glm::vec4, 6> planes; // left, right, bottom, top, near, far
+
+    /**
+     * Extracts the planes from projection * view (Gribb, Hartmann), so they are in world space.
+     */
+    static Frustum from_matrix(const glm::mat4 &view_projection);
+
+    bool intersects_sphere(const glm::vec3 &center, float radius) const;
+    bool intersects_box(const glm::vec3 &min, const glm::vec3 &max) const;
+};
+
+/**
+ * Bounding spheres in structure of arrays layout, so that they are tested several at a time.
+ */
+struct BoundingSpheres {
+    std::vector<float> x, y, z, radius;
+
+    void clear();
+    void push_back(const glm::vec3 &center, float sphere_radius);
+    std::size_t size() const { return radius.size(); }
+
+    bool operator==(const BoundingSpheres &) const = default;
+};
+
+/**
+ * Appends indices of the spheres in [first, last) which intersect the frustum to visible, in ascending order.
+ *
+ * Tests 8 spheres at a time with AVX2 on x86 CPUs that support it (detected at runtime
+ * with GCC and Clang, so no build flags are needed), one at a time otherwise.
+ * Disjoint ranges can be culled concurrently.
+ */
+void cull_spheres(const Frustum &frustum, const BoundingSpheres &spheres, uint32_t first, uint32_t last,
+                  std::vector<uint32_t> &visible);
+
+#endif //HIGH_SHIFT_FRUSTUM_H
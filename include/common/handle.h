@@ -0,0 +1,15 @@
+#ifndef HIGH_SHIFT_HANDLE_H
+#define HIGH_SHIFT_HANDLE_H
+
+#include <cstdint>
+
+template<typename T>
+union Handle {
+    struct {
+        uint32_t index;
+        uint32_t version;
+    };
+    uint64_t raw;
+};
+
+#endif //HIGH_SHIFT_HANDLE_H
@@ -1,21 +1,14 @@
 #ifndef HIGH_SHIFT_HANDLE_MANAGER_H
 #define HIGH_SHIFT_HANDLE_MANAGER_H
 
+#include "common/handle.h"
+
 #include <cstdint>
 #include <cstddef>
 #include <cstring>
 #include <utility>
 #include <iostream>
 
-template<typename T>
-union Handle {
-    struct {
-        uint32_t index;
-        uint32_t version;
-    };
-    uint64_t raw;
-};
-
 template<typename T>
 class HandleManager {
 public:
@@ -75,6 +68,7 @@ private:
     struct Entry {
         T *data;
         uint32_t next;
+        uint32_t prev; // used entries only
         uint32_t version;
     };
 
@@ -173,6 +167,9 @@ Handle<T> HandleManager<T>::insert(T *data) {
     entry.data = data;
 
     entry.next = used_list;
+    entry.prev = NO_ENTRY;
+    if (used_list != NO_ENTRY)
+        entries[used_list].prev = free_idx;
     used_list = free_idx;
 
     Handle<T> handle;
@@ -197,7 +194,14 @@ T *HandleManager<T>::erase(Handle<T> handle) {
 
     ++entry.version;
 
-    used_list = entry.next;
+    // Unlink from the used list wherever the entry is
+    if (entry.prev != NO_ENTRY)
+        entries[entry.prev].next = entry.next;
+    else
+        used_list = entry.next;
+    if (entry.next != NO_ENTRY)
+        entries[entry.next].prev = entry.prev;
+
     entry.next = free_list;
     free_list = handle.index;
 
@@ -0,0 +1,44 @@
+#ifndef HIGH_SHIFT_MAPPED_FILE_H
+#define HIGH_SHIFT_MAPPED_FILE_H
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <expected.h>
+
+/**
+ * Read-only view of a whole file.
+ *
+ * The file is memory mapped, so pages are read by the OS on first access
+ * and may be passed to e.g. glBufferData without copying them first.
+ * Platforms without mmap fall back to reading the file into memory.
+ */
+class MappedFile {
+public:
+    static tl::expected<MappedFile, std::string> open(const std::filesystem::path &path);
+
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+    ~MappedFile();
+
+    const std::byte *data() const { return ptr; }
+    std::size_t size() const { return sz; }
+    std::span<const std::byte> bytes() const { return {ptr, sz}; }
+
+private:
+    void close();
+
+    const std::byte *ptr = nullptr;
+    std::size_t sz = 0;
+#ifdef _WIN32
+    std::vector<std::byte> buffer;
+#endif
+};
+
+#endif //HIGH_SHIFT_MAPPED_FILE_H
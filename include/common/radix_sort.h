@@ -0,0 +1,53 @@
+#ifndef HIGH_SHIFT_RADIX_SORT_H
+#define HIGH_SHIFT_RADIX_SORT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Stable LSD radix sort by 64-bit keys, a byte per pass.
+ *
+ * Histograms of all the bytes are counted in a single read of the keys.
+ * Passes over bytes which are equal in all the keys are skipped, so keys
+ * with few varying bytes take few passes.
+ *
+ * @param scratch is resized to items.size(), reuse it to avoid allocations.
+ * @param key returns uint64_t key of an item.
+ */
+template<typename T, typename KeyFn>
+void radix_sort(std::vector<T> &items, std::vector<T> &scratch, KeyFn key) {
+    const std::size_t count = items.size();
+    if (count < 2)
+        return;
+
+    std::array<std::array<std::size_t, 256>, 8> histograms{};
+    for (const T &item : items) {
+        uint64_t k = key(item);
+        for (int pass = 0; pass < 8; ++pass)
+            ++histograms[pass][(k >> (pass * 8)) & 0xFF];
+    }
+
+    scratch.resize(count);
+    for (int pass = 0; pass < 8; ++pass) {
+        auto &histogram = histograms[pass];
+        const uint64_t first_byte = (key(items[0]) >> (pass * 8)) & 0xFF;
+        if (histogram[first_byte] == count)
+            continue; // all the keys have the same byte
+
+        // Histogram to the offsets of the buckets
+        std::size_t offset = 0;
+        for (auto &bucket : histogram) {
+            std::size_t bucket_size = bucket;
+            bucket = offset;
+            offset += bucket_size;
+        }
+
+        for (T &item : items)
+            scratch[histogram[(key(item) >> (pass * 8)) & 0xFF]++] = std::move(item);
+        items.swap(scratch);
+    }
+}
+
+#endif //HIGH_SHIFT_RADIX_SORT_H
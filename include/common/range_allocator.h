@@ -0,0 +1,49 @@
+#ifndef HIGH_SHIFT_RANGE_ALLOCATOR_H
+#define HIGH_SHIFT_RANGE_ALLOCATOR_H
+
+#include <cstdint>
+#include <map>
+#include <optional>
+
+/**
+ * Suballocates ranges of a linear resource, e.g. a GPU buffer, without touching it.
+ *
+ * Free ranges are kept ordered by offset and merged with their neighbours
+ * on free. Allocation takes the first range which fits.
+ */
+class RangeAllocator {
+public:
+    RangeAllocator() = default;
+    explicit RangeAllocator(uint64_t size);
+
+    /**
+     * @return offset of the range, aligned to alignment (a power of two),
+     * or std::nullopt if there is no free range large enough.
+     */
+    std::optional<uint64_t> allocate(uint64_t size, uint64_t alignment = 1);
+
+    /**
+     * Returns the range to the allocator. Size must be the allocated one.
+     */
+    void free(uint64_t offset, uint64_t size);
+
+    /**
+     * Appends free space to the end, e.g. after the resource was reallocated.
+     */
+    void grow(uint64_t new_size);
+
+    uint64_t size() const { return total; }
+    uint64_t used() const { return used_size; }
+
+    /**
+     * Share of the free space outside of the largest free range, 0 if free space is contiguous.
+     */
+    float fragmentation() const;
+
+private:
+    std::map<uint64_t, uint64_t> free_ranges; // offset -> size
+    uint64_t total = 0;
+    uint64_t used_size = 0;
+};
+
+#endif //HIGH_SHIFT_RANGE_ALLOCATOR_H
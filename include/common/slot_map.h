@@ -0,0 +1,211 @@
+#ifndef HIGH_SHIFT_SLOT_MAP_H
+#define HIGH_SHIFT_SLOT_MAP_H
+
+#include "common/handle.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/**
+ * Stores values inline in a dense array and addresses them by handles.
+ *
+ * Handles point to slots which hold a position in the dense array and
+ * a version. Erase moves the last value into the hole and bumps the version
+ * of the slot, so stale handles are rejected and values stay contiguous.
+ *
+ * @warning Pointers returned by get() and iterators are invalidated
+ * by insert and erase. Keep handles instead.
+ */
+template<typename T>
+class SlotMap {
+public:
+    SlotMap() = default;
+    explicit SlotMap(std::size_t initial_cp);
+
+    /**
+     * Creates new handle and associates it with the value.
+     * @return handle associated with the value.
+     */
+    Handle<T> insert(T value);
+
+    template<typename... Args>
+    Handle<T> emplace(Args &&... args);
+
+    /**
+     * Gets value associated with handle.
+     * @return associated value if handle is valid, nullptr otherwise
+     */
+    [[nodiscard]] T *get(Handle<T> handle);
+    [[nodiscard]] const T *get(Handle<T> handle) const;
+
+    /**
+     * Invalidates handle.
+     * @return associated value moved out of the map.
+     * @return std::nullopt if handle was invalid.
+     */
+    std::optional<T> erase(Handle<T> handle);
+
+    bool is_valid(Handle<T> handle) const;
+
+    /**
+     * @return handle of the value at the given position of the dense array.
+     */
+    Handle<T> handle_at(std::size_t pos) const;
+
+    void reserve(std::size_t new_capacity);
+    void clear();
+
+    std::size_t capacity() const;
+    std::size_t size() const;
+    bool empty() const;
+
+    T *begin() { return values.data(); }
+    T *end() { return values.data() + values.size(); }
+    const T *begin() const { return values.data(); }
+    const T *end() const { return values.data() + values.size(); }
+
+private:
+    struct Slot {
+        uint32_t index; // position in values if used, next free slot otherwise
+        uint32_t version;
+    };
+
+    std::vector<T> values;
+    std::vector<uint32_t> value_slots; // inverse of Slot::index
+    std::vector<Slot> slots;
+    uint32_t free_list = NO_ENTRY;
+    static const uint32_t NO_ENTRY = UINT32_MAX;
+
+    uint32_t acquire_slot();
+};
+
+template<typename T>
+SlotMap<T>::SlotMap(std::size_t initial_cp) {
+    reserve(initial_cp);
+}
+
+template<typename T>
+Handle<T> SlotMap<T>::insert(T value) {
+    return emplace(std::move(value));
+}
+
+template<typename T>
+template<typename... Args>
+Handle<T> SlotMap<T>::emplace(Args &&... args) {
+    values.emplace_back(std::forward<Args>(args)...);
+
+    uint32_t slot_idx = acquire_slot();
+    Slot &slot = slots[slot_idx];
+    slot.index = (uint32_t) values.size() - 1;
+    value_slots.push_back(slot_idx);
+
+    Handle<T> handle;
+    handle.index = slot_idx;
+    handle.version = slot.version;
+    return handle;
+}
+
+template<typename T>
+uint32_t SlotMap<T>::acquire_slot() {
+    if (free_list == NO_ENTRY) {
+        slots.push_back(Slot{.index = NO_ENTRY, .version = 0});
+        return (uint32_t) slots.size() - 1;
+    }
+
+    uint32_t slot_idx = free_list;
+    free_list = slots[slot_idx].index;
+    return slot_idx;
+}
+
+template<typename T>
+T *SlotMap<T>::get(Handle<T> handle) {
+    if (!is_valid(handle))
+        return nullptr;
+    return &values[slots[handle.index].index];
+}
+
+template<typename T>
+const T *SlotMap<T>::get(Handle<T> handle) const {
+    if (!is_valid(handle))
+        return nullptr;
+    return &values[slots[handle.index].index];
+}
+
+template<typename T>
+std::optional<T> SlotMap<T>::erase(Handle<T> handle) {
+    if (!is_valid(handle))
+        return std::nullopt;
+
+    Slot &slot = slots[handle.index];
+    uint32_t pos = slot.index;
+    std::optional<T> result(std::move(values[pos]));
+
+    // Swap-remove: the last value fills the hole
+    uint32_t last = (uint32_t) values.size() - 1;
+    if (pos != last) {
+        values[pos] = std::move(values[last]);
+        value_slots[pos] = value_slots[last];
+        slots[value_slots[pos]].index = pos;
+    }
+    values.pop_back();
+    value_slots.pop_back();
+
+    ++slot.version;
+    slot.index = free_list;
+    free_list = handle.index;
+
+    return result;
+}
+
+template<typename T>
+bool SlotMap<T>::is_valid(Handle<T> handle) const {
+    // Free slots have their version bumped past all the issued handles
+    return handle.index < slots.size() && slots[handle.index].version == handle.version;
+}
+
+template<typename T>
+Handle<T> SlotMap<T>::handle_at(std::size_t pos) const {
+    Handle<T> handle;
+    handle.index = value_slots[pos];
+    handle.version = slots[handle.index].version;
+    return handle;
+}
+
+template<typename T>
+void SlotMap<T>::reserve(std::size_t new_capacity) {
+    values.reserve(new_capacity);
+    value_slots.reserve(new_capacity);
+    slots.reserve(new_capacity);
+}
+
+template<typename T>
+void SlotMap<T>::clear() {
+    for (uint32_t slot_idx : value_slots) {
+        Slot &slot = slots[slot_idx];
+        ++slot.version;
+        slot.index = free_list;
+        free_list = slot_idx;
+    }
+    values.clear();
+    value_slots.clear();
+}
+
+template<typename T>
+std::size_t SlotMap<T>::capacity() const {
+    return values.capacity();
+}
+
+template<typename T>
+std::size_t SlotMap<T>::size() const {
+    return values.size();
+}
+
+template<typename T>
+bool SlotMap<T>::empty() const {
+    return values.empty();
+}
+
+#endif //HIGH_SHIFT_SLOT_MAP_H
@@ -0,0 +1,363 @@
+#ifndef HIGH_SHIFT_TRACE_H
+#define HIGH_SHIFT_TRACE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * Timeline instrumentation.
+ *
+ * @example
+ * @code
+ * void update(...) {
+ *     HS_ZONE("PhysicsSystem::update");
+ *     // ...
+ * }
+ * @endcode
+ *
+ * Zones are compiled in only when HIGH_SHIFT_TRACE is defined
+ * (cmake -DHIGH_SHIFT_TRACE=ON). Otherwise HS_ZONE expands to nothing
+ * and its argument is not evaluated.
+ *
+ * When compiled in, zones are recorded only while a trace::Session
+ * is alive. The name must outlive the session: string literals or
+ * strings owned by long-living objects (e.g. system names).
+ */
+#define HS_TRACE_CONCAT_IMPL(a, b) a##b
+#define HS_TRACE_CONCAT(a, b) HS_TRACE_CONCAT_IMPL(a, b)
+
+#ifdef HIGH_SHIFT_TRACE
+#define HS_ZONE(name) ::trace::Zone HS_TRACE_CONCAT(hs_zone_, __LINE__)(name)
+#else
+#define HS_ZONE(name) ((void) 0)
+#endif
+
+namespace trace {
+    namespace detail {
+        inline uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#else
+            return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+        }
+
+        struct Event {
+            const char *name;
+            uint64_t begin;
+            uint64_t end;
+        };
+
+        /**
+         * Single-producer single-consumer ring of events.
+         * The owning thread pushes, the session's flushing thread drains.
+         * If the ring is full, events are dropped and counted.
+         */
+        class EventRing {
+        public:
+            static constexpr std::size_t capacity = 1 << 14;
+            static constexpr std::size_t mask = capacity - 1;
+
+            void push(const Event &event) {
+                std::size_t h = head.load(std::memory_order_relaxed);
+                if (h - tail.load(std::memory_order_acquire) == capacity) {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                events[h & mask] = event;
+                head.store(h + 1, std::memory_order_release);
+            }
+
+            template<typename Fn>
+            void drain(Fn &&f) {
+                std::size_t t = tail.load(std::memory_order_relaxed);
+                std::size_t h = head.load(std::memory_order_acquire);
+                for (; t != h; ++t)
+                    f(events[t & mask]);
+                tail.store(t, std::memory_order_release);
+            }
+
+            bool empty() const {
+                return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+            }
+
+            uint32_t tid = 0;
+            std::string thread_name; // guarded by Registry::mutex
+            bool thread_name_written = false; // accessed by the flushing thread only
+            std::atomic<bool> retired{false};
+            std::atomic<std::size_t> dropped{0};
+
+        private:
+            alignas(64) std::atomic<std::size_t> head{0};
+            alignas(64) std::atomic<std::size_t> tail{0};
+            std::unique_ptr<Event[]> events = std::make_unique<Event[]>(capacity);
+        };
+
+        /**
+         * Owns rings of all the threads that have ever recorded a zone.
+         * Rings of exited threads are reused once they are drained.
+         */
+        class Registry {
+        public:
+            EventRing *acquire_ring() {
+                std::lock_guard lock(mutex);
+                for (auto &ring : rings)
+                    if (ring->retired.load(std::memory_order_acquire) && ring->empty()) {
+                        ring->retired.store(false, std::memory_order_relaxed);
+                        ring->tid = next_tid++;
+                        ring->thread_name.clear();
+                        ring->thread_name_written = false;
+                        return ring.get();
+                    }
+                rings.push_back(std::make_unique<EventRing>());
+                rings.back()->tid = next_tid++;
+                return rings.back().get();
+            }
+
+            template<typename Fn>
+            void foreach_ring(Fn &&f) {
+                std::lock_guard lock(mutex);
+                for (auto &ring : rings)
+                    f(*ring);
+            }
+
+            void set_thread_name(EventRing *ring, std::string name) {
+                std::lock_guard lock(mutex);
+                ring->thread_name = std::move(name);
+                ring->thread_name_written = false;
+            }
+
+        private:
+            std::mutex mutex;
+            std::vector<std::unique_ptr<EventRing>> rings;
+            uint32_t next_tid = 1;
+        };
+
+        inline Registry &registry() {
+            static Registry registry;
+            return registry;
+        }
+
+        struct RingHolder {
+            EventRing *ring = registry().acquire_ring();
+
+            ~RingHolder() {
+                ring->retired.store(true, std::memory_order_release);
+            }
+        };
+
+        inline EventRing *thread_ring() {
+            thread_local RingHolder holder;
+            return holder.ring;
+        }
+
+        inline std::atomic<bool> enabled{false};
+        inline std::atomic<bool> session_active{false};
+
+        inline void write_escaped(std::FILE *file, const char *str) {
+            for (; *str; ++str) {
+                char c = *str;
+                if (c == '"' || c == '\\')
+                    std::fputc('\\', file);
+                if ((unsigned char) c < 0x20)
+                    continue;
+                std::fputc(c, file);
+            }
+        }
+    }
+
+    /**
+     * Scoped zone. Prefer HS_ZONE macro which compiles out
+     * when tracing is disabled.
+     */
+    class Zone {
+    public:
+        explicit Zone(const char *name) : name(name) {
+            if (detail::enabled.load(std::memory_order_relaxed))
+                begin = detail::now();
+        }
+
+        ~Zone() {
+            if (begin)
+                detail::thread_ring()->push({name, begin, detail::now()});
+        }
+
+        Zone(const Zone &) = delete;
+        Zone &operator=(const Zone &) = delete;
+
+    private:
+        const char *name;
+        uint64_t begin = 0;
+    };
+
+    /**
+     * Names the calling thread in the trace viewer.
+     */
+    inline void set_thread_name(std::string name) {
+        detail::registry().set_thread_name(detail::thread_ring(), std::move(name));
+    }
+
+    /**
+     * Records all the zones while alive and streams them to a
+     * Chrome trace JSON file (chrome://tracing, ui.perfetto.dev).
+     *
+     * Rings are drained by a background thread every flush_period,
+     * so recording threads never touch the file.
+     *
+     * Only one session may exist at a time.
+     */
+    class Session {
+    public:
+        explicit Session(const std::filesystem::path &path,
+                         std::chrono::milliseconds flush_period = std::chrono::milliseconds(10))
+                : flush_period(flush_period) {
+            bool expected = false;
+            if (!detail::session_active.compare_exchange_strong(expected, true))
+                return;
+
+            file = std::fopen(path.c_str(), "w");
+            if (!file) {
+                detail::session_active.store(false);
+                return;
+            }
+
+            calibrate();
+            std::fputs("{\"traceEvents\":[\n", file);
+
+            detail::enabled.store(true, std::memory_order_relaxed);
+            flusher = std::thread([this] { flush_loop(); });
+        }
+
+        Session(const Session &) = delete;
+        Session &operator=(const Session &) = delete;
+
+        /**
+         * @return false if the file could not be opened
+         * or another session is running.
+         */
+        bool is_open() const {
+            return file != nullptr;
+        }
+
+        /**
+         * @return number of events lost due to full rings.
+         */
+        std::size_t dropped() const {
+            return dropped_events;
+        }
+
+        ~Session() {
+            if (!file)
+                return;
+
+            detail::enabled.store(false, std::memory_order_relaxed);
+            {
+                std::lock_guard lock(mutex);
+                stop_requested = true;
+            }
+            cv.notify_one();
+            flusher.join();
+
+            flush();
+            std::fputs("\n]}\n", file);
+            std::fclose(file);
+            detail::session_active.store(false);
+        }
+
+    private:
+        std::FILE *file = nullptr;
+        std::thread flusher;
+        std::chrono::milliseconds flush_period;
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool stop_requested = false;
+
+        bool first_event = true;
+        std::size_t dropped_events = 0;
+
+        uint64_t ticks_origin = 0;
+        double us_per_tick = 1e-3;
+
+        void calibrate() {
+            using Clock = std::chrono::steady_clock;
+#if defined(__x86_64__) || defined(__i386__)
+            auto wall_begin = Clock::now();
+            uint64_t ticks_begin = detail::now();
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            auto wall_end = Clock::now();
+            uint64_t ticks_end = detail::now();
+
+            double us = std::chrono::duration<double, std::micro>(wall_end - wall_begin).count();
+            us_per_tick = us / (double) (ticks_end - ticks_begin);
+            ticks_origin = ticks_begin;
+#else
+            us_per_tick = std::chrono::duration<double, std::micro>(Clock::duration(1)).count();
+            ticks_origin = detail::now();
+#endif
+        }
+
+        void flush_loop() {
+            std::unique_lock lock(mutex);
+            while (!stop_requested) {
+                cv.wait_for(lock, flush_period);
+                lock.unlock();
+                flush();
+                lock.lock();
+            }
+        }
+
+        void begin_event() {
+            if (!first_event)
+                std::fputs(",\n", file);
+            first_event = false;
+        }
+
+        void flush() {
+            detail::registry().foreach_ring([this](detail::EventRing &ring) {
+                if (!ring.thread_name.empty() && !ring.thread_name_written) {
+                    begin_event();
+                    std::fprintf(file, R"({"name":"thread_name","ph":"M","pid":1,"tid":%u,"args":{"name":")",
+                                 ring.tid);
+                    detail::write_escaped(file, ring.thread_name.c_str());
+                    std::fputs("\"}}", file);
+                    ring.thread_name_written = true;
+                }
+
+                dropped_events += ring.dropped.exchange(0, std::memory_order_relaxed);
+                ring.drain([&](const detail::Event &event) {
+                    if (event.end < ticks_origin)
+                        return; // leftover of the previous session
+
+                    // Zones started before the session are clamped to its beginning
+                    uint64_t begin = std::max(event.begin, ticks_origin);
+                    double ts = (double) (begin - ticks_origin) * us_per_tick;
+                    double dur = (double) (event.end - begin) * us_per_tick;
+
+                    begin_event();
+                    std::fputs(R"({"name":")", file);
+                    detail::write_escaped(file, event.name);
+                    std::fprintf(file, R"(","ph":"X","pid":1,"tid":%u,"ts":%.3f,"dur":%.3f})",
+                                 ring.tid, ts, dur);
+                });
+            });
+            std::fflush(file);
+        }
+    };
+}
+
+#endif //HIGH_SHIFT_TRACE_H
@@ -5,10 +5,13 @@
 #include "ecs/component.h"
 #include "ecs/entity.h"
 #include "ecs/id_set.h"
+#include "ecs/paged_id_set.h"
 #include "ecs/chunk_layout.h"
 #include "ecs/chunks_data.h"
 #include "ecs/chunks_map.h"
 
+#include <array>
+#include <memory>
 #include <vector>
 
 namespace ecs {
@@ -26,11 +29,11 @@ namespace ecs {
     class EntityChunkMapping {
     public:
         const EntityPosInChunk &operator[](Id id) const {
-            return dense[sparse[id]];
+            return dense[sparse_at(id)];
         }
 
         EntityPosInChunk &operator[](Id id) {
-            return dense[sparse[id]];
+            return dense[sparse_at(id)];
         }
 
         /**
@@ -40,14 +43,14 @@ namespace ecs {
 
         /**
          * Same as insert but does not perform checking if id is
-         * present. Does not perform auto memory allocations.
+         * present. Expects the id to be absent.
          */
         void insert_unsafe(Id id, EntityPosInChunk entity_pos);
 
         /**
          * Same as insert but for multiple entities.
          * Does not perform version checking.
-         * Does not perform auto memory allocations.
+         * Does not grow dense storage, reserve it first.
          *
          * Position for the next entity is just an increment of the previous index_in_chunk.
          * chunk_index is not incremented.
@@ -55,7 +58,7 @@ namespace ecs {
         void insert_multiple(std::size_t entities_count, const Entity *entities,
                              EntityPosInChunk starting_pos);
 
-        void reserve(Id max_id, std::size_t additional_count);
+        void reserve(std::size_t additional_count);
 
         /**
          * @return true if id was present in the table
@@ -74,17 +77,39 @@ namespace ecs {
             return present.empty();
         }
 
+        /**
+         * @return bytes allocated by the mapping, including the present set
+         */
+        std::size_t memory_usage() const;
+
     private:
+        static constexpr std::size_t sparse_page_shift = 12;
+        static constexpr std::size_t sparse_page_mask = (std::size_t(1) << sparse_page_shift) - 1;
+        static constexpr std::size_t sparse_dir_shift = 10;
+        static constexpr std::size_t sparse_dir_mask = (std::size_t(1) << sparse_dir_shift) - 1;
+
+        using SparsePage = std::array<uint32_t, sparse_page_mask + 1>;
+        using SparseDir = std::array<std::unique_ptr<SparsePage>, sparse_dir_mask + 1>;
+
         // plain list of EntityPosInChunk
         std::vector<EntityPosInChunk> dense;
 
         // inverse of `sparse`: mapping from positions in `dense` to entity ids
         std::vector<uint32_t> dense_ids;
 
-        // mapping from entity idd to positions in `dense`
-        std::vector<uint32_t> sparse;
+        // mapping from entity ids to positions in `dense`, a two level page table
+        // so that an id only costs the pages on its path, however large it is
+        std::vector<std::unique_ptr<SparseDir>> sparse;
+
+        PagedIdSet present;
+
+        uint32_t sparse_at(Id id) const {
+            const SparseDir &dir = *sparse[id >> (sparse_page_shift + sparse_dir_shift)];
+            return (*dir[(id >> sparse_page_shift) & sparse_dir_mask])[id & sparse_page_mask];
+        }
 
-        IdSet present;
+        // allocates the pages of id on first write
+        uint32_t &sparse_slot(Id id);
     };
 
     struct ComponentsData {
@@ -224,6 +249,7 @@ namespace ecs {
     private:
         Storage storage;
         std::unique_ptr<EntityChunkMapping> _mapping = std::make_unique<EntityChunkMapping>();
+        IdSet query_scratch; // reused by find
 
         Storage::iterator find(std::size_t components_count,
                                const ComponentType *types);
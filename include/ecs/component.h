@@ -28,6 +28,7 @@ namespace ecs {
     template<typename C>
     concept Component = requires {
         requires !std::is_fundamental_v<C>;
+        requires !std::is_pointer_v<C>;
         requires std::is_trivially_destructible_v<C>;
         requires !std::is_same_v<Entity, C>;
         requires std::is_same_v<C, std::remove_cvref_t<C>>;
@@ -0,0 +1,148 @@
+#ifndef HIGH_SHIFT_CONCURRENT_ID_SET_H
+#define HIGH_SHIFT_CONCURRENT_ID_SET_H
+
+#include "ecs/id_set.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+namespace ecs {
+    /**
+     * IdSet with the same layout which can be modified from multiple threads
+     * at once, e.g. by workers marking visible or dirty entities.
+     *
+     * Capacity is fixed at construction, so no operation allocates.
+     * Each level is updated with atomic fetch_or/fetch_and. Erase that clears
+     * an upper bit re-checks the lower word and restores the bit if a concurrent
+     * insert refilled it, so an upper bit is never missing for a non-empty word.
+     * Upper bits may be spuriously set which traversals already tolerate.
+     *
+     * Reads are safe during modifications but observe them in no particular order.
+     */
+    class ConcurrentIdSet {
+    public:
+        explicit ConcurrentIdSet(std::size_t capacity);
+
+        ConcurrentIdSet(const ConcurrentIdSet &) = delete;
+        ConcurrentIdSet &operator=(const ConcurrentIdSet &) = delete;
+
+        /**
+         * @return true if id was inserted by this call.
+         */
+        bool insert(Id id);
+        bool erase(Id id); // true if element was present
+        bool contains(Id id) const;
+
+        /**
+         * Adds all the ids to the result. Must not run concurrently with erase.
+         */
+        void merge_into(IdSet &result) const;
+
+        /**
+         * Zeroes only non-empty words. Must not run concurrently with other modifications.
+         */
+        void clear();
+
+        std::size_t size() const;
+        std::size_t capacity() const;
+        bool empty() const;
+
+        Id first() const;
+
+        uint64_t level_data(std::size_t lvl, std::size_t ind) const;
+        std::size_t level_capacity(std::size_t lvl) const;
+
+    private:
+        static constexpr std::size_t levels_num = IdSet::levels_num;
+
+        std::unique_ptr<std::atomic<uint64_t>[]> words; // levels 0..2 one after another
+        std::atomic<uint64_t> level3{0};
+        std::atomic<uint64_t> *levels[levels_num]{nullptr, nullptr, nullptr, &level3};
+        std::size_t lvl_cp[levels_num]{0, 0, 0, 1};
+        std::size_t cp = 0;
+        std::atomic<std::size_t> sz{0};
+    };
+
+    static_assert(IdSetLike<ConcurrentIdSet>);
+
+    inline bool ConcurrentIdSet::insert(Id id) {
+        assert(id < cp);
+
+        uint64_t bit = 1ull << (id & IdSet::lower_bits);
+        std::size_t ind = id >> IdSet::shift;
+        uint64_t prev = levels[0][ind].fetch_or(bit, std::memory_order_acq_rel);
+        if (prev & bit)
+            return false;
+        sz.fetch_add(1, std::memory_order_relaxed);
+
+        // Only the thread that made a word non-empty marks it on the upper level
+        for (std::size_t lvl = 1; lvl < levels_num && !prev; ++lvl) {
+            bit = 1ull << (ind & IdSet::lower_bits);
+            ind >>= IdSet::shift;
+            prev = levels[lvl][ind].fetch_or(bit, std::memory_order_acq_rel);
+        }
+        return true;
+    }
+
+    inline bool ConcurrentIdSet::erase(Id id) {
+        if (id >= cp)
+            return false;
+
+        uint64_t bit = 1ull << (id & IdSet::lower_bits);
+        std::size_t ind = id >> IdSet::shift;
+        uint64_t prev = levels[0][ind].fetch_and(~bit, std::memory_order_acq_rel);
+        if (!(prev & bit))
+            return false;
+        sz.fetch_sub(1, std::memory_order_relaxed);
+
+        // Only the thread that emptied a word unmarks it on the upper level
+        for (std::size_t lvl = 1; lvl < levels_num && !(prev & ~bit); ++lvl) {
+            std::size_t lower = ind;
+            bit = 1ull << (ind & IdSet::lower_bits);
+            ind >>= IdSet::shift;
+            prev = levels[lvl][ind].fetch_and(~bit, std::memory_order_acq_rel);
+
+            if (levels[lvl - 1][lower].load(std::memory_order_acquire)) {
+                // Refilled by a concurrent insert after it was emptied
+                levels[lvl][ind].fetch_or(bit, std::memory_order_acq_rel);
+                break;
+            }
+        }
+        return true;
+    }
+
+    inline bool ConcurrentIdSet::contains(Id id) const {
+        if (id >= cp)
+            return false;
+        return detail::check_bit(levels[0][id >> IdSet::shift].load(std::memory_order_acquire),
+                                 id & IdSet::lower_bits);
+    }
+
+    inline std::size_t ConcurrentIdSet::size() const {
+        return sz.load(std::memory_order_relaxed);
+    }
+
+    inline std::size_t ConcurrentIdSet::capacity() const {
+        return cp;
+    }
+
+    inline bool ConcurrentIdSet::empty() const {
+        return size() == 0;
+    }
+
+    inline Id ConcurrentIdSet::first() const {
+        return detail::first(*this);
+    }
+
+    inline uint64_t ConcurrentIdSet::level_data(std::size_t lvl, std::size_t ind) const {
+        return levels[lvl][ind].load(std::memory_order_acquire);
+    }
+
+    inline std::size_t ConcurrentIdSet::level_capacity(std::size_t lvl) const {
+        return lvl_cp[lvl];
+    }
+}
+
+#endif //HIGH_SHIFT_CONCURRENT_ID_SET_H
@@ -22,12 +22,15 @@ namespace ecs {
 
         void update() {
             Clock::time_point now = Clock::now();
-            if (!first_update) {
+            if (!first_update)
                 delta_time = (float) (now - prev).count() / 1e9f;
-                prev = now;
-            } else {
+            else
                 first_update = false;
-            }
+            prev = now;
+        }
+
+        void set(float value) {
+            delta_time = value;
         }
     };
 }
@@ -20,6 +20,23 @@ namespace ecs {
             (system.*update)(world.get<std::remove_cvref_t<Args>>()...);
         }
 
+        template<typename Arg>
+        void gather_resource_access(ResourcesBitset &reads, ResourcesBitset &writes) {
+            using R = std::remove_cvref_t<Arg>;
+            if constexpr(std::is_same_v<R, Jobs>) {
+                return; // thread-safe
+            } else if constexpr(std::is_const_v<std::remove_reference_t<Arg>> && !std::is_same_v<R, Entities>) {
+                reads.set(get_resource_id<R>());
+            } else {
+                writes.set(get_resource_id<R>());
+            }
+        }
+
+        template<typename Ret, System This, typename ...Args>
+        void gather_resources_access(Ret (This::*)(Args...), ResourcesBitset &reads, ResourcesBitset &writes) {
+            (gather_resource_access<Args>(reads, writes), ...);
+        }
+
         inline uint32_t _get_system_id() {
             static uint32_t id = 0;
             return ++id;
@@ -98,6 +115,10 @@ namespace ecs {
 
             if constexpr(SystemHasSetup<S>)
                 gather_dependencies(&S::setup, deps, deps_names);
+
+            is_fixed_step = FixedStepSystem<S>;
+            is_parallel = ParallelSystem<S>;
+            gather_resources_access(&S::update, resources_reads, resources_writes);
         }
     }
 
@@ -154,4 +175,20 @@ namespace ecs {
         dispatcher.add_single<S>(std::forward<Args>(args)...);
         return std::move(*this);
     }
+
+    template<System S, typename... Args>
+    DispatcherBuilder &&DispatcherBuilder::add_system_to_group(std::string_view group_name, Args &&...args) && {
+        dispatcher.add_single<S>(std::forward<Args>(args)...);
+
+        if (auto group = dispatcher.find_group(group_name))
+            dispatcher.schedules[detail::get_system_id<S>()].group = *group;
+        else if (!group_error)
+            group_error = Dispatcher::GroupError{
+                    .group_name = std::string(group_name),
+                    .message = demangled_type_name<S>() + " is added to group " +
+                               std::string(group_name) + " but such group is not present."
+            };
+
+        return std::move(*this);
+    }
 }
@@ -68,6 +68,29 @@ namespace ecs {
             Comp *array;
         };
 
+        template<typename C, typename Ref>
+        requires PlainComponent<std::remove_const_t<C>>
+        struct ComponentExtractor<C *, Ref> {
+            explicit ComponentExtractor(const Archetype *archetype) {
+                std::size_t comp_index = archetype->layout().get_component_index<std::remove_const_t<C>>();
+                present = comp_index < archetype->components_count();
+                if (present)
+                    offset = archetype->layout().component_offsets()[comp_index];
+            }
+
+            void update(Chunk *chunk) {
+                array = present ? (C *) (chunk->data + offset) : nullptr;
+            }
+
+            Ref get(std::size_t i) {
+                return array ? array + i : nullptr;
+            }
+
+            bool present;
+            std::size_t offset = 0;
+            C *array = nullptr;
+        };
+
         template<typename Ref>
         struct ComponentExtractor<Entity, Ref> {
             static_assert(!std::is_reference_v<Ref> || std::is_const_v<std::remove_reference_t<Ref>>,
@@ -209,6 +232,7 @@ namespace ecs {
 
     template<typename... Cmps, typename Fn>
     void Entities::foreach_impl(Fn &&f) const {
+        HS_ZONE("ecs::Entities::foreach");
         auto components = typename detail::FilterComponents<std::remove_cvref_t<Cmps>...>::type();
         archetypes.foreach(components, [&](Archetype *arch) {
             auto extractors = std::make_tuple(
@@ -5,6 +5,8 @@
 
 namespace ecs {
     namespace detail {
+        static constexpr std::size_t max_levels = 6; // enough for 32-bit ids
+
         inline void reset_bit(uint64_t &mask, uint32_t pos) {
             mask &= ~(1ull << pos);
         }
@@ -30,15 +32,62 @@ namespace ecs {
             mask &= ((1 << (num)) - 1);
         }
 
+        /**
+         * Mask of bits [from, to) of a word, from < to <= 64.
+         */
+        inline uint64_t range_mask(uint32_t from, uint32_t to) {
+            uint64_t high = to == 64 ? ~0ull : (1ull << to) - 1;
+            return high & (~0ull << from);
+        }
+
+        /**
+         * @return position of k-th set bit of the mask, k < popcount(mask).
+         */
+        inline uint32_t select_bit(uint64_t mask, uint32_t k) {
+            for (; k; --k)
+                mask &= mask - 1;
+            return __builtin_ctzll(mask);
+        }
+
+        /**
+         * Number of levels of a set. Sets without levels_count() have IdSet::levels_num.
+         */
+        template<typename S>
+        inline std::size_t levels_count(const S &set) {
+            if constexpr(requires { set.levels_count(); })
+                return set.levels_count();
+            else
+                return IdSet::levels_num;
+        }
+
+        /**
+         * Sets are combined level by level, so a set with fewer levels
+         * answers synthetic levels above its top one: a single word
+         * with the lowest bit set if the set has any bits.
+         */
+        template<typename S>
+        inline uint64_t level_data(const S &set, std::size_t lvl, std::size_t ind) {
+            std::size_t levels = levels_count(set);
+            if (lvl < levels)
+                return set.level_data(lvl, ind);
+            return ind == 0 && set.level_data(levels - 1, 0) != 0;
+        }
+
+        template<typename S>
+        inline std::size_t level_capacity(const S &set, std::size_t lvl) {
+            return lvl < levels_count(set) ? set.level_capacity(lvl) : 1;
+        }
+
         template<IdSetLike S>
         inline Id first(const S &set) {
-            uint64_t levels_data[IdSet::levels_num];
-            levels_data[IdSet::levels_num - 1] = set.level_data(IdSet::levels_num - 1, 0);
+            std::size_t levels = levels_count(set);
+            uint64_t levels_data[max_levels];
+            levels_data[levels - 1] = set.level_data(levels - 1, 0);
 
-            Id pos = 0;
-            for (std::size_t i = IdSet::levels_num - 1; i < IdSet::levels_num;) {
+            std::size_t pos = 0;
+            for (std::size_t i = levels - 1; i < levels;) {
                 if (levels_data[i] == 0) { // should go up
-                    if (i == IdSet::levels_num - 1)
+                    if (i == levels - 1)
                         return set.capacity(); // nowhere to go up
                     pos >>= IdSet::shift; // move pos back
                     ++i; // go up
@@ -54,7 +103,54 @@ namespace ecs {
                 --i; // go down
                 levels_data[i] = set.level_data(i, pos);
             }
-            return pos;
+            return (Id) pos;
+        }
+
+        /**
+         * Depth-first traversal over non-empty bottom level words
+         * of a set with any number of levels.
+         * Stops as soon as f(Id base, uint64_t mask) returns true.
+         * @return true if stopped by f.
+         */
+        template<IdSetLike Set, typename Fn>
+        bool visit_blocks(const Set &set, Fn &&f) {
+            std::size_t levels = levels_count(set);
+            if (!set.level_capacity(levels - 1))
+                return false;
+            if (levels == 1) {
+                uint64_t data = set.level_data(0, 0);
+                return data && f((Id) 0, data);
+            }
+
+            uint64_t masks[max_levels];
+            std::size_t indices[max_levels];
+            std::size_t lvl = levels - 1;
+            masks[lvl] = set.level_data(lvl, 0);
+            indices[lvl] = 0;
+
+            while (true) {
+                if (!masks[lvl]) {
+                    if (++lvl == levels) // go up
+                        return false;
+                    continue;
+                }
+
+                std::size_t child = (indices[lvl] << IdSet::shift) | __builtin_ctzll(masks[lvl]);
+                masks[lvl] &= (masks[lvl] - 1); // clear right-most bit
+                if (child >= set.level_capacity(lvl - 1))
+                    return false;
+
+                if (lvl == 1) {
+                    uint64_t data = set.level_data(0, child);
+                    if (data && f((Id) (child << IdSet::shift), data))
+                        return true;
+                    continue;
+                }
+
+                --lvl; // go down
+                indices[lvl] = child;
+                masks[lvl] = set.level_data(lvl, child);
+            }
         }
     }
 
@@ -62,6 +158,21 @@ namespace ecs {
 
     inline IdSet::IdSet() = default;
 
+    inline IdSet::IdSet(std::span<const Id> sorted_ids) {
+        if (sorted_ids.empty())
+            return;
+        assert(std::is_sorted(sorted_ids.begin(), sorted_ids.end()));
+
+        reserve(sorted_ids.back() + 1);
+        for (Id id : sorted_ids)
+            detail::set_bit(levels[0][id >> shift], id & lower_bits);
+
+        std::size_t words = (sorted_ids.back() >> shift) + 1;
+        for (std::size_t i = sorted_ids.front() >> shift; i < words; ++i)
+            sz += __builtin_popcountll(levels[0][i]);
+        update_upper_levels(sorted_ids.front() >> shift, words);
+    }
+
     inline IdSet::IdSet(const IdSet &other) {
         *this = other;
     }
@@ -115,6 +226,145 @@ namespace ecs {
         }
     }
 
+    inline void IdSet::insert_range(Id first, Id last) {
+        if (first >= last)
+            return;
+        reserve(last);
+
+        std::size_t first_word = first >> shift;
+        std::size_t last_word = (last - 1) >> shift;
+        for (std::size_t i = first_word; i <= last_word; ++i) {
+            uint32_t from = i == first_word ? first & lower_bits : 0;
+            uint32_t to = i == last_word ? ((last - 1) & lower_bits) + 1 : bits_num;
+            uint64_t mask = detail::range_mask(from, to);
+            sz += __builtin_popcountll(mask & ~levels[0][i]);
+            levels[0][i] |= mask;
+        }
+        update_upper_levels(first_word, last_word + 1);
+    }
+
+    inline void IdSet::erase_range(Id first, Id last) {
+        last = std::min<std::size_t>(last, cp);
+        if (first >= last)
+            return;
+
+        std::size_t first_word = first >> shift;
+        std::size_t last_word = (last - 1) >> shift;
+        for (std::size_t i = first_word; i <= last_word; ++i) {
+            uint32_t from = i == first_word ? first & lower_bits : 0;
+            uint32_t to = i == last_word ? ((last - 1) & lower_bits) + 1 : bits_num;
+            uint64_t mask = detail::range_mask(from, to);
+            sz -= __builtin_popcountll(mask & levels[0][i]);
+            levels[0][i] &= ~mask;
+        }
+        update_upper_levels(first_word, last_word + 1);
+    }
+
+    inline IdSet &IdSet::operator|=(const IdSet &other) {
+        if (other.cp == 0)
+            return *this;
+        reserve(other.cp);
+
+        for (std::size_t i = 0; i < other.lvl_cp[0]; ++i) {
+            uint64_t word = levels[0][i] | other.levels[0][i];
+            sz += __builtin_popcountll(word ^ levels[0][i]);
+            levels[0][i] = word;
+        }
+        // Union of exact upper levels is exact
+        for (std::size_t lvl = 1; lvl < levels_num; ++lvl)
+            for (std::size_t i = 0; i < other.lvl_cp[lvl]; ++i)
+                levels[lvl][i] |= other.levels[lvl][i];
+        return *this;
+    }
+
+    inline IdSet &IdSet::operator&=(const IdSet &other) {
+        if (cp == 0)
+            return *this;
+
+        std::size_t common = std::min(lvl_cp[0], other.cp ? other.lvl_cp[0] : 0);
+        for (std::size_t i = 0; i < lvl_cp[0]; ++i) {
+            uint64_t word = i < common ? levels[0][i] & other.levels[0][i] : 0;
+            sz -= __builtin_popcountll(word ^ levels[0][i]);
+            levels[0][i] = word;
+        }
+        update_upper_levels(0, lvl_cp[0]);
+        return *this;
+    }
+
+    inline IdSet &IdSet::operator-=(const IdSet &other) {
+        if (cp == 0 || other.cp == 0)
+            return *this;
+
+        std::size_t common = std::min(lvl_cp[0], other.lvl_cp[0]);
+        for (std::size_t i = 0; i < common; ++i) {
+            uint64_t word = levels[0][i] & ~other.levels[0][i];
+            sz -= __builtin_popcountll(word ^ levels[0][i]);
+            levels[0][i] = word;
+        }
+        update_upper_levels(0, common);
+        return *this;
+    }
+
+    inline void IdSet::update_upper_levels(std::size_t begin, std::size_t end) {
+        if (begin >= end)
+            return;
+        for (std::size_t lvl = 1; lvl < levels_num; ++lvl) {
+            begin >>= shift;
+            end = ((end - 1) >> shift) + 1;
+
+            for (std::size_t i = begin; i < end; ++i) {
+                std::size_t lower_begin = i << shift;
+                std::size_t lower_end = std::min(lower_begin + bits_num, lvl_cp[lvl - 1]);
+
+                uint64_t mask = 0;
+                for (std::size_t j = lower_begin; j < lower_end; ++j)
+                    mask |= (uint64_t) (levels[lvl - 1][j] != 0) << (j - lower_begin);
+                levels[lvl][i] = mask;
+            }
+        }
+    }
+
+    inline std::size_t IdSet::rank(Id id) const {
+        id = std::min<std::size_t>(id, cp);
+        std::size_t full_words = id >> shift;
+        std::size_t result = 0;
+
+        // Empty blocks of bottom words are skipped with the first level
+        for (std::size_t block = 0; (block << shift) < full_words; ++block) {
+            uint64_t words_mask = levels[1][block];
+            std::size_t block_end = full_words - (block << shift);
+            if (block_end < bits_num)
+                words_mask &= detail::range_mask(0, block_end);
+            while (words_mask) {
+                std::size_t i = (block << shift) | __builtin_ctzll(words_mask);
+                result += __builtin_popcountll(levels[0][i]);
+                words_mask &= words_mask - 1;
+            }
+        }
+
+        if (id & lower_bits)
+            result += __builtin_popcountll(levels[0][full_words] & detail::range_mask(0, id & lower_bits));
+        return result;
+    }
+
+    inline Id IdSet::select(std::size_t k) const {
+        if (k >= sz)
+            return max_size;
+
+        for (std::size_t block = 0; block < lvl_cp[1]; ++block) {
+            uint64_t words_mask = levels[1][block];
+            while (words_mask) {
+                std::size_t i = (block << shift) | __builtin_ctzll(words_mask);
+                std::size_t count = __builtin_popcountll(levels[0][i]);
+                if (k < count)
+                    return (i << shift) | detail::select_bit(levels[0][i], k);
+                k -= count;
+                words_mask &= words_mask - 1;
+            }
+        }
+        return max_size;
+    }
+
     inline bool IdSet::erase(Id id) {
         if (!contains(id))
             return false;
@@ -135,9 +385,23 @@ namespace ecs {
     }
 
     inline void IdSet::clear() {
-        ecs::foreach(*this, [this](Id id) {
-            erase(id);
-        });
+        if (cp == 0)
+            return;
+
+        while (level3) {
+            std::size_t lvl2 = __builtin_ctzll(level3);
+            while (levels[2][lvl2]) {
+                std::size_t lvl1 = (lvl2 << shift) | __builtin_ctzll(levels[2][lvl2]);
+                while (levels[1][lvl1]) {
+                    std::size_t lvl0 = (lvl1 << shift) | __builtin_ctzll(levels[1][lvl1]);
+                    levels[0][lvl0] = 0;
+                    levels[1][lvl1] &= levels[1][lvl1] - 1;
+                }
+                levels[2][lvl2] &= levels[2][lvl2] - 1;
+            }
+            level3 &= level3 - 1;
+        }
+        sz = 0;
     }
 
     inline bool IdSet::contains(Id id) const {
@@ -218,13 +482,19 @@ namespace ecs {
     template<typename A, typename B>
     requires IdSetLike<std::remove_cvref_t<A>> && IdSetLike<std::remove_cvref_t<B>>
     inline uint64_t IdSetAnd<A, B>::level_data(std::size_t lvl, std::size_t ind) const {
-        return a.level_data(lvl, ind) & b.level_data(lvl, ind);
+        return detail::level_data(a, lvl, ind) & detail::level_data(b, lvl, ind);
     }
 
     template<typename A, typename B>
     requires IdSetLike<std::remove_cvref_t<A>> && IdSetLike<std::remove_cvref_t<B>>
     inline std::size_t IdSetAnd<A, B>::level_capacity(std::size_t lvl) const {
-        return std::min(a.level_capacity(lvl), b.level_capacity(lvl));
+        return std::min(detail::level_capacity(a, lvl), detail::level_capacity(b, lvl));
+    }
+
+    template<typename A, typename B>
+    requires IdSetLike<std::remove_cvref_t<A>> && IdSetLike<std::remove_cvref_t<B>>
+    inline std::size_t IdSetAnd<A, B>::levels_count() const {
+        return std::max(detail::levels_count(a), detail::levels_count(b));
     }
 
     template<typename A, typename B>
@@ -247,11 +517,17 @@ namespace ecs {
 
     ////////////////// DynamicIdSet
 
+    inline DynamicIdSetAnd::DynamicIdSetAnd(std::vector<const IdSet *> sets) : sets(std::move(sets)) {
+        std::sort(this->sets.begin(), this->sets.end(), [](const IdSet *a, const IdSet *b) {
+            return a->size() < b->size();
+        });
+    }
+
     inline bool DynamicIdSetAnd::contains(Id id) const {
-        bool answer = false;
         for (auto &set : sets)
-            answer = (answer && set->contains(id));
-        return answer;
+            if (!set->contains(id))
+                return false;
+        return true;
     }
 
     inline std::size_t DynamicIdSetAnd::capacity() const {
@@ -278,8 +554,11 @@ namespace ecs {
 
     inline uint64_t DynamicIdSetAnd::level_data(std::size_t lvl, std::size_t ind) const {
         uint64_t data = UINT64_MAX;
-        for (auto &set : sets)
+        for (auto &set : sets) {
             data &= set->level_data(lvl, ind);
+            if (!data)
+                break;
+        }
         return data;
     }
 
@@ -294,14 +573,20 @@ namespace ecs {
     template<typename A, typename B>
     requires IdSetLike<std::remove_cvref_t<A>> && IdSetLike<std::remove_cvref_t<B>>
     inline uint64_t IdSetOr<A, B>::level_data(std::size_t lvl, std::size_t ind) const {
-        return (ind < a.level_capacity(lvl) ? a.level_data(lvl, ind) : 0) |
-               (ind < b.level_capacity(lvl) ? b.level_data(lvl, ind) : 0);
+        return (ind < detail::level_capacity(a, lvl) ? detail::level_data(a, lvl, ind) : 0) |
+               (ind < detail::level_capacity(b, lvl) ? detail::level_data(b, lvl, ind) : 0);
     }
 
     template<typename A, typename B>
     requires IdSetLike<std::remove_cvref_t<A>> && IdSetLike<std::remove_cvref_t<B>>
     inline std::size_t IdSetOr<A, B>::level_capacity(std::size_t lvl) const {
-        return std::max(a.level_capacity(lvl), b.level_capacity(lvl));
+        return std::max(detail::level_capacity(a, lvl), detail::level_capacity(b, lvl));
+    }
+
+    template<typename A, typename B>
+    requires IdSetLike<std::remove_cvref_t<A>> && IdSetLike<std::remove_cvref_t<B>>
+    inline std::size_t IdSetOr<A, B>::levels_count() const {
+        return std::max(detail::levels_count(a), detail::levels_count(b));
     }
 
     template<typename A, typename B>
@@ -339,8 +624,15 @@ namespace ecs {
 
     template<typename S>
     requires IdSetLike<std::remove_cvref_t<S>>
-    inline std::size_t IdSetNot<S>::level_capacity(std::size_t) const {
-        return IdSet::max_size;
+    inline std::size_t IdSetNot<S>::level_capacity(std::size_t lvl) const {
+        // Complement is unbounded: cover the whole 32-bit id space
+        return std::max<std::size_t>(1, (std::size_t(1) << 32) >> (IdSet::shift * (lvl + 1)));
+    }
+
+    template<typename S>
+    requires IdSetLike<std::remove_cvref_t<S>>
+    inline std::size_t IdSetNot<S>::levels_count() const {
+        return detail::max_levels;
     }
 
     template<typename S>
@@ -426,7 +718,15 @@ namespace ecs {
     ////////////////// foreach
 
     template<IdSetLike Set, typename Fn>
-    void foreach(const Set &set, Fn &&f) {
+    void foreach_block(const Set &set, Fn &&f) {
+        if (detail::levels_count(set) != IdSet::levels_num) {
+            detail::visit_blocks(set, [&f](Id base, uint64_t mask) {
+                f(base, mask);
+                return false;
+            });
+            return;
+        }
+
         std::size_t lvl3_cp = set.level_capacity(3);
         std::size_t lvl2_cp = set.level_capacity(2);
         std::size_t lvl1_cp = set.level_capacity(1);
@@ -456,13 +756,9 @@ namespace ecs {
                         return;
 
                     uint64_t lvl0_data = set.level_data(0, lvl0);
+                    if (lvl0_data)
+                        f((Id) (lvl0 << IdSet::shift), lvl0_data);
 
-                    while (lvl0_data) {
-                        uint64_t pos = (lvl0 << IdSet::shift) |
-                                       __builtin_ctzll(lvl0_data); // get right-most bit
-                        f(pos);
-                        lvl0_data &= (lvl0_data - 1); // clear right-most bit
-                    }
                     lvl1_data &= (lvl1_data - 1); // clear right-most bit
                 }
                 lvl2_data &= (lvl2_data - 1); // clear right-most bit
@@ -472,50 +768,70 @@ namespace ecs {
     }
 
     template<IdSetLike Set, typename Fn>
-    Id find_if(const Set &set, Fn &&f) {
-        std::size_t lvl3_cp = set.level_capacity(3);
-        std::size_t lvl2_cp = set.level_capacity(2);
-        std::size_t lvl1_cp = set.level_capacity(1);
-        std::size_t lvl0_cp = set.level_capacity(0);
+    void foreach(const Set &set, Fn &&f) {
+        foreach_block(set, [&f](Id base, uint64_t mask) {
+            while (mask) {
+                f(base | __builtin_ctzll(mask)); // get right-most bit
+                mask &= (mask - 1); // clear right-most bit
+            }
+        });
+    }
 
-        if (!lvl3_cp)
-            return IdSet::max_size;
+    template<IdSetLike Set, typename Fn>
+    std::optional<Id> find_if(const Set &set, Fn &&f) {
+        std::optional<Id> found;
+        detail::visit_blocks(set, [&](Id base, uint64_t mask) {
+            while (mask) {
+                Id id = base | __builtin_ctzll(mask); // get right-most bit
+                if (f(id)) {
+                    found = id;
+                    return true;
+                }
+                mask &= (mask - 1); // clear right-most bit
+            }
+            return false;
+        });
+        return found;
+    }
 
-        uint64_t lvl3_data = set.level_data(3, 0);
-        while (lvl3_data) {
-            std::size_t lvl2 = __builtin_ctzll(lvl3_data); // get right-most bit
-            if (lvl2 >= lvl2_cp)
-                return IdSet::max_size;
+    ////////////////// IdSetIterator
 
-            uint64_t lvl2_data = set.level_data(2, lvl2);
-            while (lvl2_data) {
-                std::size_t lvl1 = (lvl2 << IdSet::shift) |
-                                   __builtin_ctzll(lvl2_data); // get right-most bit
-                if (lvl1 >= lvl1_cp)
-                    return IdSet::max_size;
+    template<IdSetLike Set>
+    IdSetIterator<Set>::IdSetIterator(const Set &set) : set(&set), levels(detail::levels_count(set)) {
+        if (!set.level_capacity(levels - 1))
+            return;
+        masks[levels - 1] = set.level_data(levels - 1, 0);
+        advance();
+    }
 
-                uint64_t lvl1_data = set.level_data(1, lvl1);
-                while (lvl1_data) {
-                    std::size_t lvl0 = (lvl1 << IdSet::shift) |
-                                       __builtin_ctzll(lvl1_data); // get right-most bit
-                    if (lvl0 >= lvl0_cp)
-                        return IdSet::max_size;
+    template<IdSetLike Set>
+    void IdSetIterator<Set>::advance() {
+        std::size_t lvl = 0;
+        while (true) {
+            if (!masks[lvl]) {
+                if (lvl == levels - 1) {
+                    finished = true; // nowhere to go up
+                    return;
+                }
+                ++lvl; // go up
+                continue;
+            }
 
-                    uint64_t lvl0_data = set.level_data(0, lvl0);
+            std::size_t pos = (indices[lvl] << IdSet::shift) | __builtin_ctzll(masks[lvl]);
+            masks[lvl] &= (masks[lvl] - 1); // clear right-most bit
+            if (lvl == 0) {
+                current = (Id) pos;
+                finished = false;
+                return;
+            }
 
-                    while (lvl0_data) {
-                        uint64_t pos = (lvl0 << IdSet::shift) |
-                                       __builtin_ctzll(lvl0_data); // get right-most bit
-                        if (f(pos))
-                            return pos;
-                        lvl0_data &= (lvl0_data - 1); // clear right-most bit
-                    }
-                    lvl1_data &= (lvl1_data - 1); // clear right-most bit
-                }
-                lvl2_data &= (lvl2_data - 1); // clear right-most bit
+            --lvl; // go down
+            if (pos >= set->level_capacity(lvl)) {
+                finished = true;
+                return;
             }
-            lvl3_data &= (lvl3_data - 1); // clear right-most bit
+            indices[lvl] = pos;
+            masks[lvl] = set->level_data(lvl, pos);
         }
-        return IdSet::max_size;
     }
 }
@@ -6,7 +6,13 @@
 #include "ecs/utils.h"
 #include "ecs/game_loop_control.h"
 #include "ecs/delta_time.h"
+#include "ecs/fixed_time.h"
+#include "ecs/headless_loop.h"
+#include "ecs/jobs.h"
+#include "ecs/run_criteria.h"
 
+#include <optional>
+#include <string_view>
 #include <tuple>
 #include <variant>
 
@@ -18,6 +24,7 @@ namespace ecs {
         using ISystemsArray = std::array<ISystem, max_systems>;
         using ISystemsVector = std::vector<detail::ISystem>;
         using ISystemsBitset = std::bitset<max_systems>;
+        using ResourcesBitset = std::bitset<World::max_resources>;
 
         class ISystem {
         public:
@@ -59,6 +66,22 @@ namespace ecs {
                 return type_name;
             }
 
+            bool fixed_step() const {
+                return is_fixed_step;
+            }
+
+            bool parallel() const {
+                return is_parallel;
+            }
+
+            const ResourcesBitset &reads() const {
+                return resources_reads;
+            }
+
+            const ResourcesBitset &writes() const {
+                return resources_writes;
+            }
+
             void *ptr() const {
                 return system_ptr;
             }
@@ -77,11 +100,34 @@ namespace ecs {
             FnDelete f_delete = nullptr;
 
             uint32_t id_ = 0;
+            bool is_fixed_step = false;
+            bool is_parallel = false;
+            ResourcesBitset resources_reads;
+            ResourcesBitset resources_writes;
             void *system_ptr = nullptr;
             std::vector<uint32_t> deps;
             std::vector<std::string> deps_names;
             std::string type_name;
         };
+
+        struct SystemGroup {
+            std::string name;
+            RunCriteria criteria;
+            uint64_t evaluated_pass = 0;
+            bool condition_met = true;
+        };
+
+        static const uint32_t default_group = 0;
+
+        /**
+         * Run-time state of a system which decides when it is due.
+         */
+        struct SystemSchedule {
+            uint32_t group = default_group;
+            uint32_t frames_left = 0;
+            float time_left = 0.0f;
+            float elapsed = 0.0f; // since the previous update
+        };
     }
 
     class DispatcherBuilder;
@@ -89,6 +135,10 @@ namespace ecs {
     /**
      * Heart of the ECS. Statically dispatches all the
      * resources used by the specified systems.
+     *
+     * Systems are updated in the order of their setup dependencies.
+     * Adjacent ecs::ParallelSystem's without conflicting resources
+     * are updated in parallel on ecs::Jobs.
      * @tparam Systems
      */
     class Dispatcher {
@@ -97,6 +147,8 @@ namespace ecs {
 //            world->emplace<Entities>(world.get());
             world->emplace<GameLoopControl>();
             world->emplace<DeltaTime>();
+            world->emplace<FixedTime>();
+            world->emplace<Jobs>();
         };
 
         Dispatcher(Dispatcher &&) = default;
@@ -118,7 +170,12 @@ namespace ecs {
             } type;
         };
 
-        using DispatcherError = std::variant<SystemError, DependencyError>;
+        struct GroupError {
+            std::string group_name;
+            std::string message;
+        };
+
+        using DispatcherError = std::variant<SystemError, DependencyError, GroupError>;
 
         template<System... Systems>
         static tl::expected<Dispatcher, DispatcherError> create();
@@ -126,9 +183,27 @@ namespace ecs {
         /**
          * Takes all the resources used by the systems and injects them
          * when update method of each system is called.
+         *
+         * Runs a single frame: spends DeltaTime on fixed steps
+         * (see ecs::FixedTime) and then updates per-frame systems.
          */
         void update();
 
+        /**
+         * Same as above but the frame lasts exactly delta_time seconds.
+         */
+        void update(float delta_time);
+
+        /**
+         * Updates systems tagged with ecs::FixedUpdateTag once.
+         */
+        void update_fixed_step();
+
+        /**
+         * Updates per-frame systems once.
+         */
+        void update_frame();
+
         void loop() {
             auto &game_loop_control = world->get<GameLoopControl>();
             auto &delta_time = world->get<DeltaTime>();
@@ -138,6 +213,12 @@ namespace ecs {
             }
         }
 
+        /**
+         * Runs the game loop on a virtual clock.
+         * @see ecs::HeadlessLoop
+         */
+        void loop(const HeadlessLoop &headless);
+
         template<System S>
         S &get_system();
 
@@ -172,10 +253,40 @@ namespace ecs {
          */
         [[nodiscard]] tl::expected<void, DispatcherError> setup();
 
+        /**
+         * Assigns phase offsets to grouped systems so that systems
+         * of the same rate are spread over their period.
+         */
+        void stagger_groups();
+
+        void update_systems(bool fixed_step);
+
+        /**
+         * Parallel systems are collected into a batch until one of them
+         * conflicts with the batch or a main-thread system is met.
+         * Then the batch is run on ecs::Jobs and the main thread helps.
+         */
+        void add_to_parallel_batch(detail::ISystem &i_system);
+        void run_parallel_batch();
+
+        bool is_due(detail::SystemSchedule &schedule, float pass_delta_time);
+        bool is_due_now(detail::SystemSchedule &schedule);
+
+        std::optional<uint32_t> find_group(std::string_view name) const;
+
         detail::ISystemsArray systems_by_id;
         detail::ISystemsVector systems;
         detail::ISystemsBitset systems_presence;
 
+        std::vector<detail::SystemGroup> groups{detail::SystemGroup{}}; // default group is always present
+        std::array<detail::SystemSchedule, detail::max_systems> schedules{};
+        uint64_t pass_index = 0;
+
+        std::vector<detail::ISystem *> parallel_batch;
+        detail::ResourcesBitset batch_reads;
+        detail::ResourcesBitset batch_writes;
+        detail::ISystemsBitset batch_systems;
+
         friend DispatcherBuilder;
 
         bool successfully_created = false;
@@ -187,9 +298,24 @@ namespace ecs {
         template<System S, typename... Args>
         DispatcherBuilder &&add_system(Args &&...args) &&;
 
+        /**
+         * Declares a group of systems updated according to the criteria.
+         * @see ecs::RunCriteria
+         */
+        DispatcherBuilder &&add_group(std::string name, RunCriteria criteria) &&;
+
+        /**
+         * Same as add_system but the system is updated
+         * according to the criteria of the group.
+         * The group must be added beforehand.
+         */
+        template<System S, typename... Args>
+        DispatcherBuilder &&add_system_to_group(std::string_view group_name, Args &&...args) &&;
+
         tl::expected<Dispatcher, Dispatcher::DispatcherError> build() &&;
     private:
         Dispatcher dispatcher;
+        std::optional<Dispatcher::GroupError> group_error;
     };
 }
 
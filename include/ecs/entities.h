@@ -6,6 +6,7 @@
 #include "ecs/component.h"
 #include "ecs/id_set.h"
 #include "ecs/chunk_layout.h"
+#include "common/trace.h"
 
 namespace ecs {
 
@@ -169,6 +170,15 @@ namespace ecs {
          *     // ...
          * });
          * @endcode
+         *
+         * Components listed by pointer are optional: they do not restrict
+         * the set of entities and nullptr is passed if the entity lacks one.
+         * @example
+         * @code
+         * Entities.foreach([](const ComponentA &a, const ComponentB *maybe_b) {
+         *     // ...
+         * });
+         * @endcode
          */
         template<typename Fn>
         void foreach(Fn &&fn) const {
@@ -0,0 +1,92 @@
+#ifndef HIGH_SHIFT_FIXED_TIME_H
+#define HIGH_SHIFT_FIXED_TIME_H
+
+#include <cstdint>
+#include <cassert>
+#include <cmath>
+
+namespace ecs {
+    class Dispatcher;
+
+    /**
+     * Special resource to control fixed-step simulation.
+     *
+     * Frame time is accumulated and spent on fixed steps
+     * of systems tagged with ecs::FixedUpdateTag.
+     * The remainder is exposed as alpha() so that rendering can
+     * blend between the previous and the current simulation states.
+     *
+     * At most max_steps_per_frame() steps are run per frame.
+     * If a frame is slower than that, the excess time is dropped
+     * and the simulation slows down instead of spiraling.
+     */
+    class FixedTime {
+    public:
+        /**
+         * Duration of a single fixed step in seconds.
+         */
+        float step() const {
+            return _step;
+        }
+
+        void set_step(float step) {
+            assert(step > 0.0f);
+            _step = step;
+        }
+
+        uint32_t max_steps_per_frame() const {
+            return _max_steps_per_frame;
+        }
+
+        void set_max_steps_per_frame(uint32_t max_steps) {
+            assert(max_steps > 0);
+            _max_steps_per_frame = max_steps;
+        }
+
+        /**
+         * Fraction of the step that has been accumulated but not simulated yet.
+         * @return value in [0, 1).
+         */
+        float alpha() const {
+            return _alpha;
+        }
+
+        /**
+         * @return number of fixed steps performed in the current frame.
+         */
+        uint32_t steps() const {
+            return _steps;
+        }
+
+    private:
+        friend Dispatcher;
+
+        float _step = 1.0f / 60.0f;
+        uint32_t _max_steps_per_frame = 8;
+
+        float accumulator = 0.0f;
+        float _alpha = 0.0f;
+        uint32_t _steps = 0;
+
+        /**
+         * @return number of fixed steps to perform in this frame.
+         */
+        uint32_t advance(float frame_delta) {
+            accumulator += frame_delta;
+
+            _steps = 0;
+            while (accumulator >= _step && _steps < _max_steps_per_frame) {
+                accumulator -= _step;
+                ++_steps;
+            }
+
+            if (accumulator >= _step) // catch-up bound is reached, drop the excess
+                accumulator = std::fmod(accumulator, _step);
+
+            _alpha = accumulator / _step;
+            return _steps;
+        }
+    };
+}
+
+#endif //HIGH_SHIFT_FIXED_TIME_H
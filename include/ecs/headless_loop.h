@@ -0,0 +1,33 @@
+#ifndef HIGH_SHIFT_HEADLESS_LOOP_H
+#define HIGH_SHIFT_HEADLESS_LOOP_H
+
+#include <cstdint>
+
+namespace ecs {
+    /**
+     * Options of a game loop that is not bound to a window or a wall clock,
+     * e.g. for dedicated servers, tests and benchmarks.
+     *
+     * Frames are run back to back as fast as possible and DeltaTime
+     * is driven by a virtual clock advancing by delta_time each frame,
+     * so the run is deterministic.
+     *
+     * @example
+     * @code
+     * dispatcher.loop(ecs::HeadlessLoop{.frames = 1000, .delta_time = 1.0f / 30.0f});
+     * @endcode
+     */
+    struct HeadlessLoop {
+        /**
+         * Number of frames to run. 0 means until GameLoopControl::stop() is called.
+         */
+        uint64_t frames = 0;
+
+        /**
+         * Virtual duration of a single frame in seconds.
+         */
+        float delta_time = 1.0f / 60.0f;
+    };
+}
+
+#endif //HIGH_SHIFT_HEADLESS_LOOP_H
@@ -6,6 +6,9 @@
 #include <cstdint>
 #include <cstddef>
 #include <concepts>
+#include <iterator>
+#include <optional>
+#include <span>
 #include <vector>
 
 namespace ecs {
@@ -33,6 +36,12 @@ namespace ecs {
     public:
         IdSet();
 
+        /**
+         * Builds the set word by word.
+         * @param sorted_ids ascending ids, duplicates are allowed.
+         */
+        explicit IdSet(std::span<const Id> sorted_ids);
+
         IdSet(const IdSet &);
         IdSet &operator=(const IdSet &);
 
@@ -50,6 +59,29 @@ namespace ecs {
          */
         void insert_unsafe(Id id);
 
+        /**
+         * Inserts/erases all the ids in [first, last) word by word.
+         */
+        void insert_range(Id first, Id last);
+        void erase_range(Id first, Id last);
+
+        /**
+         * Word-parallel set algebra. Upper levels are kept exact.
+         */
+        IdSet &operator|=(const IdSet &other);
+        IdSet &operator&=(const IdSet &other);
+        IdSet &operator-=(const IdSet &other);
+
+        /**
+         * @return number of ids less than id.
+         */
+        std::size_t rank(Id id) const;
+
+        /**
+         * @return k-th smallest id (starting from 0) or max_size if k >= size().
+         */
+        Id select(std::size_t k) const;
+
         std::size_t size() const;
         std::size_t capacity() const;
         bool empty() const;
@@ -58,6 +90,10 @@ namespace ecs {
 
         void reserve(std::size_t n);
 
+        /**
+         * Zeroes only non-empty words found through the upper levels,
+         * so the cost depends on the population rather than the capacity.
+         */
         void clear();
 
         void swap(IdSet &other);
@@ -68,16 +104,24 @@ namespace ecs {
         std::size_t level_capacity(std::size_t lvl) const;
 
     public:
-        static const std::size_t levels_num = 4;
-        static const std::size_t bits_num = 64;
-        static const std::size_t lower_bits = bits_num - 1;
-        static const std::size_t shift = 6; // = log2(bits_num);
+        static constexpr std::size_t levels_num = 4;
+        static constexpr std::size_t bits_num = 64;
+        static constexpr std::size_t lower_bits = bits_num - 1;
+        static constexpr std::size_t shift = 6; // = log2(bits_num);
         constexpr static std::size_t shifts[levels_num] = {0, shift, shift * 2, shift * 3};
 
-        static const std::size_t max_size = (1 << (shift * levels_num));
+        static constexpr std::size_t max_size = (1 << (shift * levels_num));
         // pow(bits_num, levels_num) = pow(2, log2(bits_num) * levels_num);
 
     private:
+        friend class DynamicIdSetAnd;
+        friend class ConcurrentIdSet;
+
+        /**
+         * Recomputes upper levels above the bottom level words [begin, end).
+         */
+        void update_upper_levels(std::size_t begin, std::size_t end);
+
         uint64_t level3 = 0; // level3 is preallocated and hardcoded to never grow
         uint64_t *levels[levels_num]{nullptr, nullptr, nullptr, &level3};
         std::size_t lvl_cp[levels_num]{0, 0, 0, 1};
@@ -122,6 +166,7 @@ namespace ecs {
 
         uint64_t level_data(std::size_t lvl, std::size_t ind) const;
         std::size_t level_capacity(std::size_t lvl) const;
+        std::size_t levels_count() const;
 
     private:
         A a;
@@ -140,10 +185,13 @@ namespace ecs {
      *
      * Unlike IdSetAnd its' type is not modified
      * by &'ed sets.
+     *
+     * Sets are ordered by population, so the sparsest one
+     * is probed first and cuts the rest of the probes.
      */
     class DynamicIdSetAnd {
     public:
-        explicit DynamicIdSetAnd(std::vector<const IdSet *> sets) : sets(std::move(sets)) {}
+        explicit DynamicIdSetAnd(std::vector<const IdSet *> sets);
 
         bool contains(Id id) const;
         bool empty() const;
@@ -154,6 +202,16 @@ namespace ecs {
         uint64_t level_data(std::size_t lvl, std::size_t ind) const;
         std::size_t level_capacity(std::size_t lvl) const;
 
+        /**
+         * Computes the intersection into the result eagerly.
+         * Bottom level words are AND'ed in bulk (with SIMD if available)
+         * in the blocks where the sparsest set has any bits.
+         *
+         * Pass the same result set across calls to reuse its memory.
+         * There must be at least one set.
+         */
+        void materialize(IdSet &result) const;
+
     private:
         std::vector<const IdSet *> sets;
     };
@@ -179,6 +237,7 @@ namespace ecs {
 
         uint64_t level_data(std::size_t lvl, std::size_t ind) const;
         std::size_t level_capacity(std::size_t lvl) const;
+        std::size_t levels_count() const;
 
     private:
         A a;
@@ -217,6 +276,7 @@ namespace ecs {
 
         uint64_t level_data(std::size_t lvl, std::size_t ind) const;
         std::size_t level_capacity(std::size_t lvl) const;
+        std::size_t levels_count() const;
 
     private:
         S set;
@@ -271,6 +331,21 @@ namespace ecs {
 
     static_assert(IdSetLike<EmptyIdSet>);
 
+    /**
+     * Iterates over non-empty bottom level words of the set
+     * and calls f(Id base, uint64_t mask) with each of them.
+     * Bit i of the mask stands for id base + i.
+     *
+     * @example
+     * @code
+     * ecs::foreach_block(set, [&](ecs::Id base, uint64_t mask) {
+     *     process_up_to_64(base, mask);
+     * });
+     * @endcode
+     */
+    template<IdSetLike Set, typename Fn>
+    void foreach_block(const Set &set, Fn &&f);
+
     /**
      * Iterates over set and calls f with each id.
      */
@@ -280,10 +355,76 @@ namespace ecs {
     /**
      * @param f predicate.
      * @return the first matched id if any.
-     * @return IdSet::max_size, otherwise.
+     * @return std::nullopt, otherwise.
      */
     template<IdSetLike Set, typename Fn>
-    Id find_if(const Set &set, Fn &&f);
+    std::optional<Id> find_if(const Set &set, Fn &&f);
+}
+
+namespace ecs {
+    /**
+     * Forward iterator over ids of any IdSetLike set.
+     * The set must outlive the iterator and must not be modified.
+     *
+     * @example
+     * @code
+     * for (ecs::Id id : a & b) { ... }
+     * @endcode
+     */
+    template<IdSetLike Set>
+    class IdSetIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Id;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Id *;
+        using reference = Id;
+
+        IdSetIterator() = default; // end
+
+        explicit IdSetIterator(const Set &set);
+
+        Id operator*() const {
+            return current;
+        }
+
+        IdSetIterator &operator++() {
+            advance();
+            return *this;
+        }
+
+        IdSetIterator operator++(int) {
+            IdSetIterator copy = *this;
+            advance();
+            return copy;
+        }
+
+        bool operator==(const IdSetIterator &other) const {
+            return finished == other.finished && (finished || current == other.current);
+        }
+
+    private:
+        static constexpr std::size_t max_levels = 6;
+
+        const Set *set = nullptr;
+        std::size_t levels = 0;
+        uint64_t masks[max_levels]{}; // bits left to visit on each level
+        std::size_t indices[max_levels]{}; // visited word on each level
+        Id current = 0;
+        bool finished = true;
+
+        void advance();
+    };
+
+    template<IdSetLike Set>
+    IdSetIterator<Set> begin(const Set &set) {
+        return IdSetIterator<Set>(set);
+    }
+
+    template<IdSetLike Set>
+    IdSetIterator<Set> end(const Set &) {
+        return IdSetIterator<Set>();
+    }
 }
 
 namespace std {
@@ -0,0 +1,208 @@
+#ifndef HIGH_SHIFT_JOBS_H
+#define HIGH_SHIFT_JOBS_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ecs {
+    class Jobs;
+
+    /**
+     * Counts unfinished tasks. Tasks spawned with the same counter
+     * are waited for together with Jobs::wait.
+     */
+    class JobCounter {
+    public:
+        bool done() const {
+            return pending.load(std::memory_order_acquire) == 0;
+        }
+
+    private:
+        friend Jobs;
+        std::atomic<uint32_t> pending{0};
+    };
+
+    /**
+     * Set of tasks with dependencies between them. Can be run multiple times.
+     *
+     * @example
+     * @code
+     * ecs::TaskGraph graph;
+     * auto load = graph.add([&] { ... });
+     * auto parse = graph.add([&] { ... });
+     * graph.precede(load, parse);
+     * jobs.run(graph);
+     * @endcode
+     */
+    class TaskGraph {
+    public:
+        using TaskId = uint32_t;
+
+        TaskId add(std::function<void()> task) {
+            nodes.push_back(Node{.task = std::move(task)});
+            return (TaskId) nodes.size() - 1;
+        }
+
+        /**
+         * Makes the task `after` wait for completion of the task `before`.
+         */
+        void precede(TaskId before, TaskId after) {
+            nodes[before].successors.push_back(after);
+            ++nodes[after].dependencies_count;
+        }
+
+        std::size_t size() const {
+            return nodes.size();
+        }
+
+    private:
+        friend Jobs;
+
+        struct Node {
+            std::function<void()> task;
+            std::vector<TaskId> successors;
+            uint32_t dependencies_count = 0;
+        };
+
+        std::vector<Node> nodes;
+    };
+
+    /**
+     * Special resource: a pool of worker threads shared by all the systems.
+     *
+     * Each worker owns a deque of tasks. Tasks spawned on a worker go
+     * to its own deque, idle workers steal from the others. Tasks spawned
+     * by any other thread (e.g. the main one) go to a shared deque.
+     *
+     * Waiting never blocks the thread: it executes pending tasks
+     * until the awaited ones are finished. So the main thread contributes
+     * while waiting and nested parallelism does not deadlock.
+     *
+     * Long tasks which nobody waits for within a frame, e.g. asset loading,
+     * go to a separate background queue. Only workers take them, when they
+     * have nothing else to do, and waiting runs a background task only if it
+     * belongs to the awaited counter. Without workers a dedicated thread runs them.
+     *
+     * Workers are started on the first spawned task.
+     */
+    class Jobs {
+    public:
+        using Task = std::function<void()>;
+
+        explicit Jobs(uint32_t workers_count = default_workers_count());
+
+        Jobs(const Jobs &) = delete;
+        Jobs &operator=(const Jobs &) = delete;
+
+        ~Jobs();
+
+        /**
+         * One worker per core, except the core of the main thread.
+         */
+        static uint32_t default_workers_count();
+
+        uint32_t workers_count() const {
+            return _workers_count;
+        }
+
+        /**
+         * Tasks spawned by background tasks are background too.
+         */
+        void spawn(JobCounter &counter, Task task);
+
+        /**
+         * Queues the task to the background queue, see the class description.
+         */
+        void spawn_background(JobCounter &counter, Task task);
+
+        /**
+         * Executes pending tasks until all the tasks of the counter are finished.
+         */
+        void wait(JobCounter &counter);
+
+        /**
+         * Calls fn(chunk_begin, chunk_end) for chunks of at most grain
+         * indices covering [begin, end) and waits for all of them.
+         */
+        template<typename Fn>
+        void parallel_for(uint32_t begin, uint32_t end, uint32_t grain, Fn &&fn);
+
+        /**
+         * Runs all the tasks of the graph respecting dependencies
+         * and waits for them. The graph must be acyclic.
+         */
+        void run(const TaskGraph &graph);
+
+    private:
+        struct Queue {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        struct BackgroundTask {
+            const JobCounter *counter;
+            Task task;
+        };
+
+        uint32_t _workers_count;
+        std::vector<std::unique_ptr<Queue>> queues; // 0 is shared by non-worker threads
+        std::vector<std::thread> workers; // and the background thread if there are no workers
+
+        std::mutex background_mutex;
+        std::deque<BackgroundTask> background;
+
+        std::once_flag started;
+        std::mutex sleep_mutex;
+        std::condition_variable sleep_cv;
+        std::atomic<uint32_t> queued{0};
+        std::atomic<uint32_t> background_queued{0};
+        bool stopping = false;
+
+        void start();
+        void worker_loop(uint32_t queue_index);
+        void background_loop();
+        void notify();
+        uint32_t this_thread_queue() const;
+        bool try_run_one(uint32_t queue_index);
+
+        /**
+         * Runs the oldest background task, of the counter if it is not nullptr.
+         */
+        bool try_run_background(const JobCounter *counter);
+    };
+
+    template<typename Fn>
+    void Jobs::parallel_for(uint32_t begin, uint32_t end, uint32_t grain, Fn &&fn) {
+        if (begin >= end)
+            return;
+        if (grain == 0)
+            grain = 1;
+        if (end - begin <= grain || _workers_count == 0) {
+            for (uint32_t chunk_begin = begin; chunk_begin < end; chunk_begin += std::min(grain, end - chunk_begin))
+                fn(chunk_begin, chunk_begin + std::min(grain, end - chunk_begin));
+            return;
+        }
+
+        // The calling thread takes the first chunk itself
+        JobCounter counter;
+        uint32_t first_end = begin + grain;
+        for (uint32_t chunk_begin = first_end; chunk_begin < end; chunk_begin += grain) {
+            uint32_t chunk_end = chunk_begin + std::min(grain, end - chunk_begin);
+            spawn(counter, [&fn, chunk_begin, chunk_end] {
+                fn(chunk_begin, chunk_end);
+            });
+        }
+        fn(begin, first_end);
+        wait(counter);
+    }
+}
+
+#endif //HIGH_SHIFT_JOBS_H
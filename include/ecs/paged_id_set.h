@@ -0,0 +1,151 @@
+#ifndef HIGH_SHIFT_PAGED_ID_SET_H
+#define HIGH_SHIFT_PAGED_ID_SET_H
+
+#include "ecs/id_set.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace ecs {
+    /**
+     * Hierarchical bitset like IdSet, but sparse: words are grouped into pages
+     * of 64 words which are allocated only when any of their bits is set.
+     * Memory is proportional to the population rather than to the largest id,
+     * so ids may span the whole 32-bit space.
+     *
+     * Levels are added on top as larger ids are inserted: the set starts with
+     * a single word and has at most 6 levels.
+     *
+     * Pages of all the levels live in one contiguous pool. An open-addressing
+     * table maps (level, page index) to a page of the pool. Absent pages
+     * resolve to the page 0 which is kept zeroed, so reads never branch on it.
+     */
+    class PagedIdSet {
+    public:
+        PagedIdSet();
+
+        void insert(Id id);
+        bool erase(Id id); // true if element was present
+        bool contains(Id id) const;
+
+        std::size_t size() const;
+        std::size_t capacity() const;
+        bool empty() const;
+
+        Id first() const;
+
+        /**
+         * Releases all the pages but keeps the memory for reuse.
+         */
+        void clear();
+
+        /**
+         * @return bytes allocated by the set.
+         */
+        std::size_t memory_usage() const;
+
+        std::size_t levels_count() const;
+        uint64_t level_data(std::size_t lvl, std::size_t ind) const;
+        std::size_t level_capacity(std::size_t lvl) const;
+
+    public:
+        static constexpr std::size_t max_levels = 6;
+        static constexpr std::size_t page_shift = 6;
+        static constexpr std::size_t page_words = 1 << page_shift;
+        static constexpr std::size_t max_size = UINT32_MAX; // UINT32_MAX itself is reserved for first()
+
+    private:
+        struct Slot {
+            uint32_t key = empty_key;
+            uint32_t page = 0;
+        };
+
+        static constexpr uint32_t empty_key = UINT32_MAX;
+
+        static uint32_t page_key(std::size_t lvl, std::size_t page) {
+            return (uint32_t) (page << 3 | lvl);
+        }
+
+        std::size_t slot_index(uint32_t key) const {
+            return (std::size_t) ((key * 2654435769u) >> (32 - slots_shift));
+        }
+
+        /**
+         * @return index of the page in the pool, 0 if it is not allocated.
+         */
+        uint32_t find_page(std::size_t lvl, std::size_t page) const;
+
+        /**
+         * @return word of the level, allocating its page if necessary.
+         */
+        uint64_t &word(std::size_t lvl, std::size_t ind);
+
+        void release_page(std::size_t lvl, std::size_t page);
+        void grow_slots();
+        void grow_levels();
+
+        std::vector<uint64_t> pool; // page 0 is always zero
+        std::vector<uint32_t> free_pages;
+        std::vector<Slot> slots; // size is a power of two
+        std::size_t slots_shift = 0;
+        std::size_t used_slots = 0;
+        std::size_t lvl_num = 1;
+        std::size_t sz = 0;
+    };
+
+    static_assert(IdSetLike<PagedIdSet>);
+
+    inline uint32_t PagedIdSet::find_page(std::size_t lvl, std::size_t page) const {
+        if (slots.empty())
+            return 0;
+        uint32_t key = page_key(lvl, page);
+        std::size_t mask = slots.size() - 1;
+        for (std::size_t i = slot_index(key);; i = (i + 1) & mask) {
+            const Slot &slot = slots[i];
+            if (slot.key == key)
+                return slot.page;
+            if (slot.key == empty_key)
+                return 0;
+        }
+    }
+
+    inline bool PagedIdSet::contains(Id id) const {
+        if (id >= capacity())
+            return false;
+        return (level_data(0, id >> IdSet::shift) >> (id & IdSet::lower_bits)) & 1ull;
+    }
+
+    inline std::size_t PagedIdSet::size() const {
+        return sz;
+    }
+
+    inline std::size_t PagedIdSet::capacity() const {
+        if (lvl_num == max_levels)
+            return max_size;
+        return std::size_t(1) << (IdSet::shift * lvl_num);
+    }
+
+    inline bool PagedIdSet::empty() const {
+        return sz == 0;
+    }
+
+    inline Id PagedIdSet::first() const {
+        return detail::first(*this);
+    }
+
+    inline std::size_t PagedIdSet::levels_count() const {
+        return lvl_num;
+    }
+
+    inline uint64_t PagedIdSet::level_data(std::size_t lvl, std::size_t ind) const {
+        uint32_t page = find_page(lvl, ind >> page_shift);
+        return pool[(page << page_shift) | (ind & (page_words - 1))];
+    }
+
+    inline std::size_t PagedIdSet::level_capacity(std::size_t lvl) const {
+        return std::size_t(1) << (IdSet::shift * (lvl_num - 1 - lvl));
+    }
+}
+
+#endif //HIGH_SHIFT_PAGED_ID_SET_H
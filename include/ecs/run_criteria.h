@@ -0,0 +1,49 @@
+#ifndef HIGH_SHIFT_RUN_CRITERIA_H
+#define HIGH_SHIFT_RUN_CRITERIA_H
+
+#include "ecs/world.h"
+
+#include <cstdint>
+#include <functional>
+
+namespace ecs {
+    /**
+     * Describes how often systems of a group are updated.
+     * All the specified conditions must be met.
+     *
+     * Systems of a group receive time elapsed since
+     * their previous update as ecs::DeltaTime.
+     *
+     * @example
+     * @code
+     * ecs::RunCriteria{.every_frames = 4}
+     * ecs::RunCriteria{.every_seconds = 0.5f}
+     * ecs::RunCriteria{.condition = [](ecs::World &world) { return !world.get<Pause>().paused; }}
+     * @endcode
+     */
+    struct RunCriteria {
+        /**
+         * Update on every N-th frame (or fixed step for fixed-step systems).
+         */
+        uint32_t every_frames = 1;
+
+        /**
+         * Update no more often than once per T seconds.
+         */
+        float every_seconds = 0.0f;
+
+        /**
+         * Predicate evaluated by Dispatcher at most once per frame (or fixed step),
+         * only when a system of the group is due by its rate.
+         */
+        std::function<bool(World &)> condition;
+
+        /**
+         * Spread systems of the same rate over the period with phase
+         * offsets so that they do not land on the same frame.
+         */
+        bool stagger = true;
+    };
+}
+
+#endif //HIGH_SHIFT_RUN_CRITERIA_H
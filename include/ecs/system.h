@@ -112,6 +112,83 @@ namespace ecs {
     concept SystemHasTeardown = requires(S sys, World &world) {
         sys.teardown(world);
     };
+
+    struct FrameUpdateTag {};
+    struct FixedUpdateTag {};
+
+    struct MainThreadTag {};
+    struct AnyThreadTag {};
+
+    template<typename S>
+    struct SystemTraits {
+    private:
+        template<typename>
+        static FrameUpdateTag update_tag_impl(...);
+
+        template<typename Q>
+        static typename Q::UpdateTag update_tag_impl(int);
+
+        template<typename>
+        static MainThreadTag thread_tag_impl(...);
+
+        template<typename Q>
+        static typename Q::ThreadTag thread_tag_impl(int);
+
+    public:
+        using UpdateTag = decltype(update_tag_impl<S>(0));
+        using ThreadTag = decltype(thread_tag_impl<S>(0));
+    };
+
+    /**
+     * By default a System is updated once per frame.
+     *
+     * System that declares `using UpdateTag = ecs::FixedUpdateTag;`
+     * is updated by Dispatcher zero or more times per frame, so that
+     * each update advances the simulation by exactly ecs::FixedTime::step().
+     * ecs::DeltaTime is equal to the step within such updates.
+     *
+     * @example ```
+     * class PhysicsSystem {
+     * public:
+     *     using UpdateTag = ecs::FixedUpdateTag;
+     *
+     *     void update(ecs::Entities &entities, const ecs::DeltaTime &dt) {
+     *         ...
+     *     }
+     * };
+     * ```
+     */
+    template<class S>
+    concept FixedStepSystem = requires {
+        requires System<S>;
+        requires std::is_same_v<typename SystemTraits<S>::UpdateTag, FixedUpdateTag>;
+    };
+
+    /**
+     * By default a System is updated on the main thread.
+     *
+     * System that declares `using ThreadTag = ecs::AnyThreadTag;`
+     * may be updated by Dispatcher on a worker of ecs::Jobs, in parallel with
+     * other such systems whose resources do not conflict with its own.
+     * A mutable reference to a resource is a write, a const reference is a read.
+     * ecs::Entities is always accessed exclusively and ecs::Jobs is shared.
+     *
+     * @example ```
+     * class AnimationSystem {
+     * public:
+     *     using ThreadTag = ecs::AnyThreadTag;
+     *
+     *     void update(const ecs::DeltaTime &dt, Skeletons &skeletons) {
+     *         ...
+     *     }
+     * };
+     * ```
+     */
+    template<class S>
+    concept ParallelSystem = requires {
+        requires System<S>;
+        requires std::is_same_v<typename SystemTraits<S>::ThreadTag, AnyThreadTag>;
+    };
 }
 
 #endif //HIGH_SHIFT_SYSTEM_H
@@ -33,6 +33,8 @@ namespace ecs {
      */
     class World {
     public:
+        static constexpr std::size_t max_resources = 1024;
+
         World() = default;
 
         World(const World &) = delete;
@@ -117,7 +119,6 @@ namespace ecs {
         }
 
     private:
-        static constexpr std::size_t max_resources = 1024;
         using ResourcesPresence = std::bitset<max_resources>;
         using ResourcesArray = std::array<std::shared_ptr<void>, max_resources>; // shared_ptr implements type-erasure
 
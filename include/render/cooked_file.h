@@ -0,0 +1,60 @@
+#ifndef HIGH_SHIFT_COOKED_FILE_H
+#define HIGH_SHIFT_COOKED_FILE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+
+#include <expected.h>
+
+namespace render {
+    /**
+     * Hash of the canonical path, size and modification time of a source asset.
+     * Cooked files are named by it, so an edited source gets a new entry.
+     * @return std::nullopt if the source does not exist.
+     */
+    std::optional<uint64_t> source_key(const std::filesystem::path &source);
+
+    /**
+     * Directory of cooked assets in the system temp directory, empty if there is none.
+     */
+    std::filesystem::path default_cache_directory();
+
+    std::filesystem::path cooked_path(const std::filesystem::path &directory, uint64_t key, const char *extension);
+
+    /**
+     * Writes a cooked file aside and renames it into place on commit,
+     * so concurrent cooks of the same source and readers never see partial files.
+     * The temporary file is removed if commit was not called or failed.
+     */
+    class CookedFileWriter {
+    public:
+        explicit CookedFileWriter(std::filesystem::path path);
+        ~CookedFileWriter();
+
+        CookedFileWriter(const CookedFileWriter &) = delete;
+        CookedFileWriter &operator=(const CookedFileWriter &) = delete;
+
+        void write(const void *data, std::size_t size);
+
+        /**
+         * Writes zeros up to the offset, e.g. to page align GPU blobs.
+         */
+        void pad_to(uint64_t offset);
+
+        uint64_t offset() const { return written; }
+
+        tl::expected<void, std::string> commit();
+
+    private:
+        std::filesystem::path path;
+        std::filesystem::path temp_path;
+        std::ofstream fout;
+        uint64_t written = 0;
+        bool committed = false;
+    };
+}
+
+#endif //HIGH_SHIFT_COOKED_FILE_H
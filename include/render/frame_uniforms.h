@@ -0,0 +1,135 @@
+#ifndef HIGH_SHIFT_FRAME_UNIFORMS_H
+#define HIGH_SHIFT_FRAME_UNIFORMS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+namespace render {
+    /**
+     * Binding points of the uniform blocks filled by RenderSystem.
+     * ShaderProgram::reflect binds blocks named "Camera" and "Lights" to them.
+     */
+    constexpr unsigned int camera_block_binding = 0;
+    constexpr unsigned int lights_block_binding = 1;
+
+    // Lights past it are not drawn
+    constexpr std::size_t max_lights = 10;
+
+    /**
+     * std140 layout of
+     * ```
+     * layout(std140) uniform Camera {
+     *     mat4 projection;
+     *     mat4 view;
+     *     vec3 viewPos;
+     * };
+     * ```
+     * Written once per camera.
+     */
+    struct CameraBlock {
+        glm::mat4 projection;
+        glm::mat4 view;
+        glm::vec3 view_pos;
+        float padding;
+    };
+
+    struct DirLightBlock {
+        glm::vec3 direction;
+        float padding0;
+        glm::vec3 ambient;
+        float padding1;
+        glm::vec3 diffuse;
+        float padding2;
+        glm::vec3 specular;
+        float padding3;
+    };
+
+    struct PointLightBlock {
+        glm::vec3 position;
+        float constant;
+        glm::vec3 ambient;
+        float linear;
+        glm::vec3 diffuse;
+        float quadratic;
+        glm::vec3 specular;
+        float padding;
+    };
+
+    struct SpotLightBlock {
+        glm::vec3 position;
+        float cut_off;
+        glm::vec3 direction;
+        float outer_cut_off;
+        glm::vec3 ambient;
+        float constant;
+        glm::vec3 diffuse;
+        float linear;
+        glm::vec3 specular;
+        float quadratic;
+    };
+
+    /**
+     * std140 layout of
+     * ```
+     * struct DirLight {
+     *     vec3 direction;
+     *     vec3 ambient;
+     *     vec3 diffuse;
+     *     vec3 specular;
+     * };
+     *
+     * struct PointLight {
+     *     vec3 position;
+     *     float constant;
+     *     vec3 ambient;
+     *     float linear;
+     *     vec3 diffuse;
+     *     float quadratic;
+     *     vec3 specular;
+     * };
+     *
+     * struct SpotLight {
+     *     vec3 position;
+     *     float cutOff;
+     *     vec3 direction;
+     *     float outerCutOff;
+     *     vec3 ambient;
+     *     float constant;
+     *     vec3 diffuse;
+     *     float linear;
+     *     vec3 specular;
+     *     float quadratic;
+     * };
+     *
+     * layout(std140) uniform Lights {
+     *     DirLight dir_lights[MAX_LIGHTS];
+     *     PointLight point_lights[MAX_LIGHTS];
+     *     SpotLight spot_lights[MAX_LIGHTS];
+     *     int NrDirLights;
+     *     int NrPointLights;
+     *     int NrSpotLights;
+     * };
+     * ```
+     * with MAX_LIGHTS equal to max_lights. Gathered once per frame.
+     */
+    struct LightsBlock {
+        DirLightBlock dir_lights[max_lights];
+        PointLightBlock point_lights[max_lights];
+        SpotLightBlock spot_lights[max_lights];
+        int32_t dir_lights_count;
+        int32_t point_lights_count;
+        int32_t spot_lights_count;
+        int32_t padding;
+    };
+
+    static_assert(sizeof(CameraBlock) == 144);
+    static_assert(sizeof(DirLightBlock) == 64 && sizeof(PointLightBlock) == 64 && sizeof(SpotLightBlock) == 80);
+    static_assert(offsetof(LightsBlock, point_lights) == 640);
+    static_assert(offsetof(LightsBlock, spot_lights) == 1280);
+    static_assert(offsetof(LightsBlock, dir_lights_count) == 2080);
+    static_assert(sizeof(LightsBlock) == 2096);
+}
+
+#endif //HIGH_SHIFT_FRAME_UNIFORMS_H
@@ -0,0 +1,98 @@
+#ifndef HIGH_SHIFT_GL_STATE_CACHE_H
+#define HIGH_SHIFT_GL_STATE_CACHE_H
+
+#include <array>
+#include <cstddef>
+
+namespace render {
+    struct GLStateStats {
+        std::size_t issued = 0; // calls that reached the driver
+        std::size_t elided = 0; // calls that would not change anything
+    };
+
+    /**
+     * Resource: shadows the GL state bound by the engine and skips calls which would not change it.
+     *
+     * All the render code binds programs, VAOs, buffers and textures and toggles depth and blend
+     * state through it. Objects must be deleted through it too, because GL unbinds deleted objects
+     * and reuses their names. Code that changes the state directly must call invalidate() afterwards.
+     *
+     * Makes no GL calls until it is used. Main thread only.
+     */
+    class GLStateCache {
+    public:
+        static constexpr unsigned int texture_units = 32;
+        static constexpr unsigned int uniform_buffer_bindings = 16;
+
+        GLStateCache() { invalidate(); }
+
+        void use_program(unsigned int id);
+        void bind_vertex_array(unsigned int id);
+
+        /**
+         * GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER
+         * and GL_UNIFORM_BUFFER are cached, other targets are passed through.
+         * GL_ELEMENT_ARRAY_BUFFER belongs to the VAO, so it is forgotten when the VAO changes.
+         */
+        void bind_buffer(unsigned int target, unsigned int buffer);
+
+        /**
+         * Binds a range of the buffer to an indexed uniform block binding, and to GL_UNIFORM_BUFFER as GL does.
+         */
+        void bind_uniform_buffer(unsigned int index, unsigned int buffer, std::size_t offset, std::size_t size);
+
+        /**
+         * Binds a GL_TEXTURE_2D to the unit, the active unit is changed only when needed.
+         */
+        void bind_texture(unsigned int unit, unsigned int texture);
+
+        void set_depth_test(bool enabled);
+        void set_depth_write(bool enabled);
+        void set_blend(bool enabled);
+        void set_blend_func(unsigned int source, unsigned int destination);
+
+        void delete_buffer(unsigned int buffer);
+        void delete_vertex_array(unsigned int id);
+        void delete_texture(unsigned int texture);
+
+        /**
+         * Forgets the shadowed state, the next calls reach the driver.
+         */
+        void invalidate();
+
+        const GLStateStats &stats() const { return counters; }
+        void reset_stats() { counters = {}; }
+
+    private:
+        static constexpr unsigned int unknown = 0xFFFFFFFF;
+        static constexpr std::size_t buffer_targets = 5;
+
+        enum class Toggle : unsigned char {
+            unknown, off, on
+        };
+
+        struct BufferRange {
+            unsigned int buffer;
+            std::size_t offset, size;
+
+            bool operator==(const BufferRange &) const = default;
+        };
+
+        unsigned int program;
+        unsigned int vertex_array;
+        std::array<unsigned int, buffer_targets> buffers;
+        std::array<BufferRange, uniform_buffer_bindings> uniform_buffers;
+        unsigned int active_unit;
+        std::array<unsigned int, texture_units> textures;
+        Toggle depth_test, depth_write, blend;
+        unsigned int blend_source, blend_destination;
+
+        GLStateStats counters;
+
+        bool change(unsigned int &shadow, unsigned int value);
+        bool change(Toggle &shadow, bool enabled);
+        void set_capability(unsigned int capability, Toggle &shadow, bool enabled);
+    };
+}
+
+#endif //HIGH_SHIFT_GL_STATE_CACHE_H
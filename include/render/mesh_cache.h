@@ -0,0 +1,82 @@
+#ifndef HIGH_SHIFT_MESH_CACHE_H
+#define HIGH_SHIFT_MESH_CACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <expected.h>
+
+#include "common/bounds.h"
+#include "render/mesh_optimizer.h"
+#include "render/texture_loader.h"
+#include "render/vertex.h"
+
+namespace render {
+    struct TextureRef {
+        std::string path; // relative to the model directory
+        Texture2d::Type type;
+    };
+
+    /**
+     * CPU side geometry of a mesh before it is uploaded to GPU.
+     */
+    struct MeshData {
+        std::span<const std::byte> vertices; // see vertex_format
+        VertexFormat vertex_format;
+        PositionDequantization dequantization;
+        std::span<const std::byte> indices; // uint16_t or uint32_t, see index_size
+        uint32_t index_size = sizeof(unsigned int);
+        std::vector<TextureRef> textures;
+        Bounds bounds; // contains the dequantized positions, computed when the mesh is cooked
+
+        std::size_t vertices_count() const { return vertices.size() / vertex_format.stride(); }
+        std::size_t indices_count() const { return indices.size() / index_size; }
+    };
+
+    /**
+     * Meshes of a model. Spans point into storage, which is either
+     * a mapped cache file or buffers filled by the importer.
+     */
+    struct ModelData {
+        std::vector<MeshData> meshes;
+        std::shared_ptr<const void> storage;
+        MeshOptimizationReport optimization; // of all the meshes, recorded when the model was cooked
+    };
+
+    /**
+     * Cooked models on disk, so that later loads skip the importer.
+     *
+     * Each source file is cooked into one file named by its source_key.
+     * Vertex and index blobs are page aligned and are used right from the mapped file.
+     *
+     * Layout: header, mesh ranges, texture refs, strings, vertices, indices.
+     */
+    class MeshCache {
+    public:
+        explicit MeshCache(std::filesystem::path directory);
+
+        /**
+         * @return cooked model or std::nullopt if the source was not cooked yet,
+         * was changed since then, was cooked with another quantization or the cooked file is corrupted.
+         */
+        std::optional<ModelData> load(const std::filesystem::path &source, const VertexQuantization &quantization) const;
+
+        /**
+         * Cooks the model. Concurrent stores of the same source are safe.
+         */
+        tl::expected<void, std::string> store(const std::filesystem::path &source, const VertexQuantization &quantization,
+                                              const ModelData &model) const;
+
+        const std::filesystem::path &directory() const { return dir; }
+
+    private:
+        std::filesystem::path dir;
+    };
+}
+
+#endif //HIGH_SHIFT_MESH_CACHE_H
@@ -0,0 +1,82 @@
+#ifndef HIGH_SHIFT_MESH_OPTIMIZER_H
+#define HIGH_SHIFT_MESH_OPTIMIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "render/vertex.h"
+
+/**
+ * Offline optimizations of indexed triangle lists, run when models are cooked.
+ * optimize_mesh runs all the stages in order.
+ */
+namespace render {
+    /**
+     * Post-transform cache size the reordering targets and the statistics simulate.
+     * Small enough to suit every GPU, see the Tipsify paper.
+     */
+    constexpr uint32_t vertex_cache_size = 16;
+
+    struct MeshStats {
+        std::size_t vertices_count = 0;
+        std::size_t indices_count = 0;
+        std::size_t bytes = 0; // vertices and indices
+        float acmr = 0.0f; // average cache miss ratio: transformed vertices per triangle, 0.5 at best, 3 at worst
+    };
+
+    struct MeshOptimizationReport {
+        MeshStats before;
+        MeshStats after;
+
+        /**
+         * Accumulates the report of another mesh, ACMR is weighted by triangles.
+         */
+        void add(const MeshOptimizationReport &other);
+    };
+
+    /**
+     * Welds bit-identical vertices and remaps indices.
+     */
+    void deduplicate_vertices(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices);
+
+    /**
+     * Reorders triangles for the post-transform vertex cache (Tipsify, Sander et al. 2007).
+     */
+    void optimize_vertex_cache(std::span<unsigned int> indices, std::size_t vertices_count,
+                               uint32_t cache_size = vertex_cache_size);
+
+    /**
+     * Reorders clusters of triangles which start with a cold cache, so that outer
+     * front-facing clusters are drawn first. Keeps the order within clusters,
+     * so the cache efficiency is preserved.
+     */
+    void optimize_overdraw(std::span<unsigned int> indices, std::span<const Vertex> vertices,
+                           uint32_t cache_size = vertex_cache_size);
+
+    /**
+     * Reorders vertices by their first use and drops unreferenced ones.
+     */
+    void optimize_vertex_fetch(std::vector<Vertex> &vertices, std::span<unsigned int> indices);
+
+    float average_cache_miss_ratio(std::span<const unsigned int> indices, std::size_t vertices_count,
+                                   uint32_t cache_size = vertex_cache_size);
+
+    /**
+     * Smallest index size able to address the vertices, 2 or 4 bytes.
+     */
+    uint32_t index_size(std::size_t vertices_count);
+
+    /**
+     * @return indices as uint16_t or uint32_t, see index_size.
+     */
+    std::vector<std::byte> pack_indices(std::span<const unsigned int> indices, uint32_t index_size);
+
+    /**
+     * Runs all the stages above but packing.
+     */
+    MeshOptimizationReport optimize_mesh(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices);
+}
+
+#endif //HIGH_SHIFT_MESH_OPTIMIZER_H
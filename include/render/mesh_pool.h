@@ -0,0 +1,97 @@
+#ifndef HIGH_SHIFT_MESH_POOL_H
+#define HIGH_SHIFT_MESH_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "common/handle.h"
+#include "render/gl_state_cache.h"
+#include "render/mesh_cache.h"
+#include "render/vertex.h"
+
+namespace render {
+    /**
+     * Location of a mesh in MeshPool, valid until the next add, remove or defragment.
+     */
+    struct PooledMesh {
+        uint32_t arena;
+        int32_t base_vertex;
+        uint32_t vertices_count;
+        uint32_t indices_count;
+        uint64_t index_offset; // bytes
+        unsigned int index_type; // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    };
+
+    struct MeshPoolStats {
+        std::size_t arenas = 0;
+        std::size_t meshes = 0;
+        std::size_t vertex_bytes = 0;
+        std::size_t vertex_capacity = 0; // bytes
+        std::size_t index_bytes = 0;
+        std::size_t index_capacity = 0; // bytes
+    };
+
+    /**
+     * Resource: GPU storage of all the meshes.
+     *
+     * Meshes of each vertex format are suballocated from one vertex and one index buffer
+     * behind one VAO, an arena. Meshes are drawn with base vertex draws, so consecutive
+     * meshes of an arena need no VAO switches. Arenas grow by reallocation and are compacted
+     * when removals fragment them.
+     *
+     * GL resources are created lazily on the first add. Main thread only.
+     */
+    class MeshPool {
+    public:
+        explicit MeshPool(GLStateCache &gl_state);
+        ~MeshPool();
+
+        MeshPool(const MeshPool &) = delete;
+        MeshPool &operator=(const MeshPool &) = delete;
+        MeshPool(MeshPool &&) = delete;
+        MeshPool &operator=(MeshPool &&) = delete;
+
+        /**
+         * Copies the geometry into the arena of its vertex format.
+         */
+        Handle<PooledMesh> add(const MeshData &data);
+
+        /**
+         * Frees the geometry. Compacts the arena if it got fragmented.
+         * @return false if handle is invalid.
+         */
+        bool remove(Handle<PooledMesh> handle);
+
+        [[nodiscard]] const PooledMesh *get(Handle<PooledMesh> handle) const; // nullptr if handle is invalid
+
+        /**
+         * Copies the geometry back from GPU into storage, stalls until the GPU is done with the buffers.
+         * Meant for load time processing of meshes whose CPU copy was released.
+         * @return vertices and indices viewing storage, without textures and dequantization;
+         * std::nullopt if handle is invalid.
+         */
+        std::optional<MeshData> read(Handle<PooledMesh> handle, std::vector<std::byte> &storage) const;
+
+        unsigned int vertex_array(uint32_t arena) const;
+
+        /**
+         * Issues an instanced base vertex draw, the VAO of the arena must be bound.
+         */
+        void draw(const PooledMesh &mesh, uint32_t instances_count = 1) const;
+
+        /**
+         * Compacts all the fragmented arenas.
+         */
+        void defragment();
+
+        MeshPoolStats stats() const;
+
+    private:
+        class Impl;
+        Impl *impl;
+    };
+}
+
+#endif //HIGH_SHIFT_MESH_POOL_H
@@ -5,46 +5,86 @@
 #include <vector>
 #include <filesystem>
 
-#include <glm/glm.hpp>
 #include <expected.h>
 
-#include "common/handle_manager.h"
+#include "common/concurrent_handle_manager.h"
+#include "ecs/jobs.h"
+#include "render/mesh_cache.h"
+#include "render/mesh_optimizer.h"
+#include "render/mesh_pool.h"
+#include "render/upload_budget.h"
+#include "render/vertex.h"
 #include "texture_loader.h"
 
 namespace render {
-    struct Vertex {
-        glm::vec3 position;
-        glm::vec3 normal;
-        glm::vec2 tex_coords;
-    };
-
     struct Mesh {
-        std::vector<Vertex> vertices;
-        std::vector<unsigned int> indices;
+        Handle<PooledMesh> geometry; // in MeshPool
+        PositionDequantization dequantization; // applied to the model matrix
         std::vector<Handle<Texture2d>> textures;
-
-        unsigned int VAO, VBO, EBO;
+        Bounds bounds; // in model space
     };
 
     struct Model {
         std::vector<Mesh> meshes;
+        MeshOptimizationReport optimization; // vertices, indices, memory and ACMR before and after cooking
+        ModelData geometry; // CPU copy of the meshes, empty unless ModelLoader::set_keep_cpu_geometry
+        Bounds bounds; // of all the meshes, in model space
     };
 
     class ModelLoader {
     public:
-        explicit ModelLoader(TextureLoader &texture_loader);
+        ModelLoader(TextureLoader &texture_loader, MeshPool &mesh_pool, ecs::Jobs &jobs);
 
         ModelLoader(const ModelLoader &) = delete;
         ModelLoader &operator=(const ModelLoader &) = delete;
         ModelLoader(ModelLoader &&) = default;
         ModelLoader &operator=(ModelLoader &&) = default;
 
+        /**
+         * Cooked models are stored in the directory and are mapped on later
+         * loads instead of being parsed again, see MeshCache.
+         * Empty path disables the cache. Defaults to default_cache_directory().
+         * Must not be called while models are loading.
+         */
+        void set_cache_directory(const std::filesystem::path &directory);
+
+        /**
+         * Error tolerance of compact vertex formats, which are chosen per mesh and attribute
+         * when models are cooked. Must not be called while models are loading.
+         */
+        void set_vertex_quantization(const VertexQuantization &tolerance);
+
+        /**
+         * Keeps geometry of the models loaded afterwards in Model::geometry after it is
+         * copied to MeshPool, e.g. for picking. Released after upload by default.
+         */
+        void set_keep_cpu_geometry(bool keep);
+
         [[nodiscard]] tl::expected<Handle<Model>, std::string>
         load_model(const std::filesystem::path &path);
 
+        /**
+         * Returns the handle at once. The file is parsed and its meshes are converted
+         * in the background of ecs::Jobs, textures are loaded asynchronously.
+         * Meshes are uploaded to GPU by upload_pending() on the main thread.
+         * The handle is invalid if too many models are loaded.
+         */
+        [[nodiscard]] Handle<Model> load_model_async(const std::filesystem::path &path);
+
+        /**
+         * Uploads parsed models until the budget is exhausted.
+         */
+        void upload_pending(UploadScope &scope);
+
+        /**
+         * Model returned by get_model while a model is loading or if it failed.
+         */
+        void set_placeholder(Handle<Model> handle);
+
         Model *get_model(Handle<Model> handle) const; // nullptr if handle is invalid
+        ResourceState get_state(Handle<Model> handle) const;
         bool unload_model(Handle<Model> handle); // true if handle was valid
-        bool unload_model_and_textures(Handle<Model> handle); // true if handle was valid
+        bool unload_model_and_textures(Handle<Model> handle); // true if handle was valid, may be still loading
 
         ~ModelLoader();
 
@@ -0,0 +1,107 @@
+#ifndef HIGH_SHIFT_RENDER_QUEUE_H
+#define HIGH_SHIFT_RENDER_QUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <span>
+#include <vector>
+
+#include "common/handle.h"
+#include "render/mesh_pool.h"
+#include "render/shader.h"
+#include "render/texture_loader.h"
+#include "render/vertex.h"
+
+namespace render {
+    /**
+     * Everything needed to issue a draw. Textures point into a Model
+     * or a StaticCluster and are valid until the end of the frame.
+     */
+    struct DrawCommand {
+        Handle<ShaderProgram> shader;
+        std::span<const Handle<Texture2d>> textures;
+        PooledMesh geometry;
+        PositionDequantization dequantization;
+        std::size_t instances_offset; // bytes in the instance buffer
+        uint32_t instances_count;
+    };
+
+    /**
+     * Sort key of a draw, from the most significant bits:
+     * - opaque: pass (2), translucency (1), shader (12), material (12), mesh (16), depth (21);
+     * - translucent: pass (2), translucency (1), inverted depth (21), shader (12), material (12), mesh (16).
+     * So opaque draws are grouped by state and go front to back within it,
+     * translucent ones go back to front after all the opaque ones.
+     */
+    struct SortKey {
+        enum Pass : uint32_t {
+            main = 0,
+        };
+
+        static constexpr uint32_t id_bits = 12;
+        static constexpr uint32_t mesh_bits = 16;
+        static constexpr uint32_t depth_bits = 21;
+
+        static uint64_t opaque(Pass pass, uint32_t shader, uint32_t material, uint32_t mesh, float depth);
+        static uint64_t translucent(Pass pass, uint32_t shader, uint32_t material, uint32_t mesh, float depth);
+        static bool is_translucent(uint64_t key);
+
+        /**
+         * Distance to the camera as depth_bits, monotonic for non-negative distances.
+         */
+        static uint32_t quantize_depth(float depth);
+    };
+
+    /**
+     * Resource: draws and state changes of the last frame, of all the cameras.
+     */
+    struct RenderQueueStats {
+        std::size_t draws = 0;
+        std::size_t shader_changes = 0;
+        std::size_t texture_changes = 0; // bindings of texture sets
+        std::size_t vertex_array_changes = 0;
+        std::size_t culled = 0; // entities and static clusters outside the frustum, per camera
+
+        // Compared to changing the state for every draw
+        std::size_t shader_changes_avoided() const { return draws - shader_changes; }
+        std::size_t texture_changes_avoided() const { return draws - texture_changes; }
+        std::size_t vertex_array_changes_avoided() const { return draws - vertex_array_changes; }
+    };
+
+    /**
+     * Draw commands of a frame, sorted by SortKey before submission.
+     */
+    class RenderQueue {
+    public:
+        struct Packet {
+            uint64_t key;
+            uint32_t command;
+        };
+
+        void clear();
+        void push(uint64_t key, const DrawCommand &command);
+
+        /**
+         * Radix sorts the packets by their keys, draws with equal keys keep the order of pushes.
+         */
+        void sort();
+
+        std::span<const Packet> packets() const { return sorted; }
+        const DrawCommand &command(const Packet &packet) const { return commands[packet.command]; }
+
+        /**
+         * Small id of a texture set for SortKey. Ids are reassigned when they run out.
+         */
+        uint32_t material(std::span<const Handle<Texture2d>> textures);
+
+    private:
+        std::vector<Packet> sorted;
+        std::vector<Packet> scratch;
+        std::vector<DrawCommand> commands;
+        std::map<std::vector<uint64_t>, uint32_t> materials; // raw handles of the textures -> id
+        std::vector<uint64_t> material_key; // scratch
+    };
+}
+
+#endif //HIGH_SHIFT_RENDER_QUEUE_H
@@ -5,12 +5,18 @@
 #include "glm/gtx/quaternion.hpp"
 
 #include "ecs/ecs.h"
+#include "common/bounds.h"
 #include "render/window_system.h"
+#include "render/gl_state_cache.h"
 #include "render/model_loader.h"
+#include "render/mesh_pool.h"
+#include "render/render_queue.h"
+#include "render/static_batch.h"
 #include "render/shader.h"
 #include "render/texture_loader.h"
 #include "render/shader_loader.h"
 #include "render/lights.h"
+#include "render/upload_budget.h"
 
 namespace render {
     struct Transform {
@@ -18,11 +24,70 @@ namespace render {
         glm::quat rotation;
     };
 
+    glm::mat4 local_to_world(const Transform &transform);
+
+    /**
+     * Transform at the beginning of the last fixed step.
+     *
+     * Entities that have it are rendered blended between
+     * the previous and the current states by ecs::FixedTime::alpha().
+     * It is maintained by TransformHistorySystem.
+     */
+    struct PreviousTransform {
+        Transform transform;
+    };
+
+    /**
+     * Saves Transform into PreviousTransform before each fixed step.
+     *
+     * Fixed-step systems that move interpolated entities must
+     * depend on it to be updated afterwards.
+     */
+    class TransformHistorySystem {
+    public:
+        using UpdateTag = ecs::FixedUpdateTag;
+
+        void update(ecs::Entities &entities) {
+            entities.foreach([](const Transform &transform, PreviousTransform &previous) {
+                previous.transform = transform;
+            });
+        }
+    };
+
+    static_assert(ecs::FixedStepSystem<TransformHistorySystem>);
+
+    /**
+     * Entities with the same model and shader are drawn instanced, one draw per mesh.
+     * Vertex shaders get the model matrix of the entity as an instance attribute
+     * and the dequantization of the mesh as a uniform:
+     * @code
+     * layout (location = 3) in mat4 aModel;
+     * uniform mat4 dequantization;
+     * // world position = aModel * dequantization * vec4(aPos, 1.0)
+     * @endcode
+     */
+    constexpr unsigned int instance_matrix_location = 3; // takes 4 locations
+
     struct MeshRenderer {
         Handle<Model> model_handle;
         Handle<ShaderProgram> shader_program_handle;
     };
 
+    /**
+     * Marks entities with MeshRenderer that are alpha blended. They are drawn after
+     * the opaque ones, back to front, one by one instead of instanced.
+     */
+    struct Translucent {};
+
+    /**
+     * Bounds of the model of a MeshRenderer entity in world space, at the rendered Transform.
+     * RenderSystem updates it every frame for the entities that have it. Frustum culling
+     * does not need it, it is for other systems, e.g. picking.
+     */
+    struct WorldBounds {
+        Bounds bounds;
+    };
+
     struct Camera {
         glm::mat4 projection;
     };
@@ -39,9 +104,15 @@ namespace render {
                                               const WindowSystem &window_system);
 
         void update(const ShaderLoader &shader_loader,
-                    const TextureLoader &texture_loader,
-                    const ModelLoader &model_loader,
-                    const ecs::Entities &entities);
+                    TextureLoader &texture_loader,
+                    ModelLoader &model_loader,
+                    const MeshPool &mesh_pool,
+                    StaticBatch &static_batch,
+                    const UploadBudget &upload_budget,
+                    const ecs::FixedTime &fixed_time,
+                    ecs::Entities &entities,
+                    GLStateCache &gl_state,
+                    RenderQueueStats &render_stats);
 
         void teardown(ecs::World &world);
 
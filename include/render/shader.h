@@ -1,11 +1,14 @@
 #ifndef HIGH_SHIFT_SHADER_H
 #define HIGH_SHIFT_SHADER_H
 
+#include <array>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include "glm/glm.hpp"
-#include "render/lights.h"
 
 namespace render {
 
@@ -34,6 +37,40 @@ namespace render {
     };
 
 
+    /**
+     * Uniforms set by the engine, their locations are looked up once at link time.
+     */
+    enum class Uniform : uint32_t {
+        dequantization,
+        material_shininess, // "material.shininess"
+        count
+    };
+
+    /**
+     * Name to location table of the active uniforms of a linked program.
+     * Elements of arrays are listed by their own names, and the first one also by the name of the array.
+     */
+    struct UniformTable {
+        struct NameHash {
+            using is_transparent = void;
+            std::size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+        };
+
+        UniformTable() { known.fill(-1); }
+
+        std::unordered_map<std::string, int, NameHash, std::equal_to<>> locations;
+        std::array<int, (std::size_t) Uniform::count> known;
+        std::vector<int> diffuse_samplers; // "material.diffuseN"
+        std::vector<int> specular_samplers; // "material.specularN"
+
+        bool operator==(const UniformTable &) const = default;
+    };
+
+    /**
+     * Setters by location do not touch the table and the ones by name do not allocate.
+     * Unknown names and -1 locations are ignored, as by glUniform*.
+     * The program must be in use, bound with GLStateCache::use_program.
+     */
     class ShaderProgram {
     public:
         explicit ShaderProgram();
@@ -47,7 +84,23 @@ namespace render {
         bool operator==(const ShaderProgram &) const = default;
         bool operator!=(const ShaderProgram &) const = default;
 
-        void use() const;
+        /**
+         * Reads locations of the active uniforms and binds the uniform blocks of frame_uniforms.h.
+         * Called by ShaderLoader after linking.
+         */
+        void reflect();
+
+        int location(std::string_view name) const;
+        int location(Uniform uniform) const { return uniforms.known[(std::size_t) uniform]; }
+
+        // -1 when the program has fewer samplers of the type
+        int diffuse_sampler(unsigned int index) const;
+        int specular_sampler(unsigned int index) const;
+
+        void set_int(int location, int value) const;
+        void set_float(int location, float value) const;
+        void set_mat4(int location, const glm::mat4 &mat) const;
+        void set_vec3(int location, const glm::vec3 &vec) const;
 
         void set_int(std::string_view name, int value) const;
         void set_float(std::string_view name, float value) const;
@@ -55,11 +108,9 @@ namespace render {
         void set_mat4(std::string_view name, const glm::mat4 &mat) const;
         void set_vec3(std::string_view name, float x, float y, float z) const;
         void set_vec3(std::string_view name, const glm::vec3 &vec) const;
-        void set_dir_light(int index, const DirLight &dir_light) const;
-        void set_point_light(int index, const glm::vec3 &position, const PointLight &point_light) const;
-        void set_spot_light(int index, const glm::vec3 &position, const SpotLight &Spot_light) const;
 
         unsigned int id;
+        UniformTable uniforms;
     };
 }
 
@@ -3,7 +3,7 @@
 
 #include "expected.h"
 #include "filesystem"
-#include "common/handle_manager.h"
+#include "common/slot_map.h"
 #include "render/shader.h"
 
 namespace fs = std::filesystem;
@@ -0,0 +1,79 @@
+#ifndef HIGH_SHIFT_STATIC_BATCH_H
+#define HIGH_SHIFT_STATIC_BATCH_H
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "common/handle.h"
+#include "ecs/entities.h"
+#include "render/mesh_pool.h"
+#include "render/model_loader.h"
+#include "render/shader.h"
+
+namespace render {
+    /**
+     * Marks entities with MeshRenderer whose Transform never changes,
+     * they are drawn as a part of StaticBatch instead of one by one.
+     * To move such an entity remove the tag, move it and add the tag again.
+     */
+    struct Static {};
+
+    /**
+     * Meshes of static entities which share a shader and textures and lie in one cell of the grid,
+     * merged in world space. Drawn with one draw call and culled as a whole.
+     */
+    struct StaticCluster {
+        Handle<ShaderProgram> shader;
+        std::vector<Handle<Texture2d>> textures;
+        Handle<PooledMesh> geometry; // in MeshPool
+        PositionDequantization dequantization; // world space
+        glm::vec3 min{0.0f}, max{0.0f}; // world space bounds
+    };
+
+    struct StaticBatchStats {
+        std::size_t entities = 0;
+        std::size_t clusters = 0;
+        std::size_t rebuilt_clusters = 0; // by the last update
+    };
+
+    /**
+     * Resource: merged geometry of the entities tagged Static.
+     *
+     * Entities are assigned to grid cells by their position. Every update finds
+     * added and removed static entities and rebuilds only the clusters they touch.
+     * Entities are added once their models are loaded.
+     *
+     * Geometry is read from Model::geometry if it is kept, from MeshPool otherwise.
+     * Main thread only.
+     */
+    class StaticBatch {
+    public:
+        explicit StaticBatch(MeshPool &mesh_pool);
+        ~StaticBatch();
+
+        StaticBatch(const StaticBatch &) = delete;
+        StaticBatch &operator=(const StaticBatch &) = delete;
+        StaticBatch(StaticBatch &&) = delete;
+        StaticBatch &operator=(StaticBatch &&) = delete;
+
+        /**
+         * Edge of grid cells in world units, 32 by default.
+         * Rebuilds all the clusters on the next update.
+         */
+        void set_cluster_size(float size);
+
+        void update(const ecs::Entities &entities, const ModelLoader &model_loader);
+
+        std::span<const StaticCluster> clusters() const;
+        StaticBatchStats stats() const;
+
+    private:
+        class Impl;
+        Impl *impl;
+    };
+}
+
+#endif //HIGH_SHIFT_STATIC_BATCH_H
@@ -0,0 +1,52 @@
+#ifndef HIGH_SHIFT_STREAM_BUFFER_H
+#define HIGH_SHIFT_STREAM_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "render/gl_state_cache.h"
+
+namespace render {
+    /**
+     * GPU buffer for data rewritten every frame, e.g. instance attributes.
+     *
+     * Writes are appended to a ring with unsynchronized mappings, so the driver
+     * never waits for draws that still read earlier ranges. When the ring is full
+     * the storage is orphaned and writing starts over from the beginning.
+     *
+     * Requires a GL context from construction to destruction.
+     */
+    class StreamBuffer {
+    public:
+        /**
+         * @param target GL_ARRAY_BUFFER, GL_UNIFORM_BUFFER...; the buffer is left bound to it by write().
+         */
+        StreamBuffer(GLStateCache &gl_state, unsigned int target, std::size_t capacity);
+        ~StreamBuffer();
+
+        StreamBuffer(const StreamBuffer &) = delete;
+        StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+        /**
+         * Copies data into the buffer, grows it to at least
+         * twice the size of the data if it does not fit at all.
+         * @param alignment of the returned offset, a power of two.
+         * @return offset of the data in the buffer.
+         */
+        std::size_t write(const void *data, std::size_t bytes, std::size_t alignment = 16);
+
+        unsigned int id() const { return buffer; }
+        std::size_t capacity() const { return buffer_size; }
+
+    private:
+        GLStateCache &gl_state;
+        unsigned int target;
+        unsigned int buffer = 0;
+        std::size_t buffer_size;
+        std::size_t head = 0;
+
+        void orphan();
+    };
+}
+
+#endif //HIGH_SHIFT_STREAM_BUFFER_H
@@ -0,0 +1,83 @@
+#ifndef HIGH_SHIFT_TEXTURE_COOKER_H
+#define HIGH_SHIFT_TEXTURE_COOKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <expected.h>
+
+#include "ecs/jobs.h"
+
+namespace render {
+    /**
+     * Block compressed formats of cooked textures, 4x4 pixel blocks.
+     */
+    enum class TextureFormat : uint32_t {
+        bc1, // RGB, 8 bytes per block
+        bc3, // RGBA, 16 bytes per block
+        bc5, // RG, 16 bytes per block
+    };
+
+    /**
+     * Compressed texture with its whole mip chain, level 0 is the largest.
+     * Levels point into storage, which is either a mapped cache file or cooked buffers.
+     */
+    struct CookedTexture {
+        TextureFormat format;
+        uint32_t width;
+        uint32_t height;
+        std::vector<std::span<const std::byte>> levels;
+        std::shared_ptr<const void> storage;
+    };
+
+    std::size_t block_size(TextureFormat format);
+
+    /**
+     * Generates mips with a box filter and compresses every level.
+     * Format is chosen by channels: 1 and 3 -> BC1, 2 -> BC5, 4 -> BC3 or BC1 if the image is opaque.
+     * Rows of mips and blocks are processed in parallel on jobs.
+     */
+    CookedTexture cook_texture(const uint8_t *pixels, uint32_t width, uint32_t height, int channels, ecs::Jobs &jobs);
+
+    namespace detail {
+        /**
+         * Next mip of RGBA pixels as cook_texture makes it. simd = false forces
+         * the scalar path, which the SSE2 one must match bit for bit.
+         */
+        std::vector<uint8_t> downsample(std::span<const uint8_t> rgba, uint32_t width, uint32_t height, bool simd,
+                                        ecs::Jobs &jobs);
+    }
+
+    /**
+     * Cooked textures on disk, so that later loads skip decoding and compression.
+     *
+     * Each source image is cooked into a KTX-like file named by its source_key:
+     * header, level table and page aligned levels.
+     */
+    class TextureCache {
+    public:
+        explicit TextureCache(std::filesystem::path directory);
+
+        /**
+         * @return cooked texture or std::nullopt if the source was not cooked yet,
+         * was changed since then or the cooked file is corrupted.
+         */
+        std::optional<CookedTexture> load(const std::filesystem::path &source) const;
+
+        /**
+         * Cooks the texture. Concurrent stores of the same source are safe.
+         */
+        tl::expected<void, std::string> store(const std::filesystem::path &source, const CookedTexture &texture) const;
+
+    private:
+        std::filesystem::path dir;
+    };
+}
+
+#endif //HIGH_SHIFT_TEXTURE_COOKER_H
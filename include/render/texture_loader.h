@@ -1,7 +1,10 @@
 #ifndef HIGH_SHIFT_TEXTURE_LOADER_H
 #define HIGH_SHIFT_TEXTURE_LOADER_H
 
-#include "common/handle_manager.h"
+#include "common/concurrent_handle_manager.h"
+#include "ecs/jobs.h"
+#include "render/gl_state_cache.h"
+#include "render/upload_budget.h"
 
 #include <expected.h>
 #include <string>
@@ -18,7 +21,7 @@ namespace render {
 
     class TextureLoader {
     public:
-        TextureLoader();
+        TextureLoader(GLStateCache &gl_state, ecs::Jobs &jobs);
         ~TextureLoader();
 
         TextureLoader(const TextureLoader &) = delete;
@@ -26,11 +29,37 @@ namespace render {
         TextureLoader(TextureLoader &&) = default;
         TextureLoader &operator=(TextureLoader &&) = default;
 
+        /**
+         * Images are cooked into block compressed textures with precomputed mips,
+         * which are stored in the directory and are mapped on later loads, see TextureCache.
+         * Empty path disables the cache. Defaults to default_cache_directory().
+         * Must not be called while textures are loading.
+         */
+        void set_cache_directory(const std::filesystem::path &directory);
+
         [[nodiscard]] tl::expected<Handle<Texture2d>, std::string>
         load_from_file(std::filesystem::path path, Texture2d::Type type);
 
+        /**
+         * Returns the handle at once. The image is decoded and cooked in the background of ecs::Jobs
+         * and uploaded to GPU by upload_pending() on the main thread.
+         * Can be called from any thread.
+         */
+        [[nodiscard]] tl::expected<Handle<Texture2d>, std::string>
+        load_from_file_async(std::filesystem::path path, Texture2d::Type type);
+
+        /**
+         * Uploads cooked textures until the budget is exhausted. Main thread only.
+         */
+        void upload_pending(UploadScope &scope);
+
+        /**
+         * @return texture, or a 1x1 placeholder of the same type while
+         * the texture is loading or if it failed. nullptr if handle is invalid.
+         */
         Texture2d *get_texture(Handle<Texture2d> handle) const;
-        bool unload_texture(Handle<Texture2d> handle);
+        ResourceState get_state(Handle<Texture2d> handle) const;
+        bool unload_texture(Handle<Texture2d> handle); // true if handle was valid
 
     private:
         class Impl;
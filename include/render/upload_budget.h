@@ -0,0 +1,45 @@
+#ifndef HIGH_SHIFT_UPLOAD_BUDGET_H
+#define HIGH_SHIFT_UPLOAD_BUDGET_H
+
+#include <chrono>
+#include <cstddef>
+
+namespace render {
+    /**
+     * Resource: limits GPU uploads of asynchronously loaded assets per frame.
+     * At least one asset is uploaded per frame, so loading always progresses.
+     */
+    struct UploadBudget {
+        float milliseconds = 2.0f;
+        std::size_t bytes = 32 << 20;
+    };
+
+    /**
+     * Tracks the budget spent during a single frame.
+     */
+    class UploadScope {
+    public:
+        explicit UploadScope(const UploadBudget &budget)
+                : budget(budget), start(std::chrono::steady_clock::now()) {}
+
+        bool exhausted() const {
+            if (spent_bytes == 0)
+                return false;
+            if (spent_bytes >= budget.bytes)
+                return true;
+            std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            return elapsed.count() >= budget.milliseconds;
+        }
+
+        void spend(std::size_t bytes) {
+            spent_bytes += bytes == 0 ? 1 : bytes;
+        }
+
+    private:
+        UploadBudget budget;
+        std::chrono::steady_clock::time_point start;
+        std::size_t spent_bytes = 0;
+    };
+}
+
+#endif //HIGH_SHIFT_UPLOAD_BUDGET_H
@@ -0,0 +1,84 @@
+#ifndef HIGH_SHIFT_VERTEX_H
+#define HIGH_SHIFT_VERTEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace render {
+    struct Vertex {
+        glm::vec3 position;
+        glm::vec3 normal;
+        glm::vec2 tex_coords;
+    };
+
+    /**
+     * Layout of vertices in GPU buffers, each attribute is either full floats or compact:
+     * - positions: 3 x int16 and 2 bytes of padding, dequantized by PositionDequantization;
+     * - normals: signed normalized GL_INT_2_10_10_10_REV;
+     * - texture coordinates: 2 x half float.
+     * Attributes follow each other in this order, 32 bytes per vertex at most and 16 at least.
+     */
+    struct VertexFormat {
+        enum Flags : uint32_t {
+            quantized_positions = 1 << 0,
+            packed_normals = 1 << 1,
+            half_tex_coords = 1 << 2,
+        };
+
+        uint32_t flags = 0;
+
+        uint32_t position_size() const { return flags & quantized_positions ? 8 : 12; }
+        uint32_t normal_size() const { return flags & packed_normals ? 4 : 12; }
+        uint32_t tex_coords_size() const { return flags & half_tex_coords ? 4 : 8; }
+
+        uint32_t normal_offset() const { return position_size(); }
+        uint32_t tex_coords_offset() const { return position_size() + normal_size(); }
+        uint32_t stride() const { return position_size() + normal_size() + tex_coords_size(); }
+
+        bool operator==(const VertexFormat &) const = default;
+    };
+
+    /**
+     * Quantized positions are integers, position = offset + quantized * scale.
+     * The scale is uniform, so it is folded into the model matrix without skewing normals.
+     */
+    struct PositionDequantization {
+        glm::vec3 offset{0.0f};
+        float scale = 1.0f;
+    };
+
+    /**
+     * Largest errors an attribute may get when it is stored in a compact format.
+     * Attributes exceeding them stay full floats, zero keeps them lossless.
+     */
+    struct VertexQuantization {
+        float position_error = 1e-4f; // relative to the largest extent of the mesh
+        float normal_error = 2e-3f; // per component of unit normals
+        float tex_coords_error = 1.0f / 2048; // a quarter of a texel of 512x512 textures
+
+        bool operator==(const VertexQuantization &) const = default;
+    };
+
+    struct EncodedVertices {
+        VertexFormat format;
+        PositionDequantization dequantization;
+        std::vector<std::byte> data;
+    };
+
+    /**
+     * Picks the most compact format of each attribute within the tolerance and encodes the vertices.
+     */
+    EncodedVertices encode_vertices(std::span<const Vertex> vertices, const VertexQuantization &tolerance);
+
+    /**
+     * Inverse of encode_vertices, compact attributes come back with their errors.
+     */
+    std::vector<Vertex> decode_vertices(std::span<const std::byte> data, const VertexFormat &format,
+                                        const PositionDequantization &dequantization);
+}
+
+#endif //HIGH_SHIFT_VERTEX_H
@@ -0,0 +1,69 @@
+#include "common/bounds.h"
+
+#include <algorithm>
+
+Bounds Bounds::from_points(std::span<const glm::vec3> points) {
+    Bounds bounds;
+    if (points.empty())
+        return bounds;
+
+    for (const auto &point : points) {
+        bounds.min = glm::min(bounds.min, point);
+        bounds.max = glm::max(bounds.max, point);
+    }
+    bounds.center = (bounds.min + bounds.max) * 0.5f;
+
+    float radius2 = 0.0f;
+    for (const auto &point : points) {
+        glm::vec3 d = point - bounds.center;
+        radius2 = std::max(radius2, glm::dot(d, d));
+    }
+    bounds.radius = std::sqrt(radius2);
+    return bounds;
+}
+
+Bounds Bounds::merge(const Bounds &a, const Bounds &b) {
+    if (a.empty())
+        return b;
+    if (b.empty())
+        return a;
+
+    Bounds bounds;
+    bounds.min = glm::min(a.min, b.min);
+    bounds.max = glm::max(a.max, b.max);
+
+    float distance = glm::length(b.center - a.center);
+    if (distance + b.radius <= a.radius) {
+        bounds.center = a.center; // b is inside a
+        bounds.radius = a.radius;
+    } else if (distance + a.radius <= b.radius) {
+        bounds.center = b.center;
+        bounds.radius = b.radius;
+    } else {
+        // Spans from the far side of a to the far side of b
+        bounds.radius = (distance + a.radius + b.radius) * 0.5f;
+        bounds.center = a.center + (b.center - a.center) * ((bounds.radius - a.radius) / distance);
+    }
+    return bounds;
+}
+
+Bounds Bounds::transformed(const glm::mat4 &matrix) const {
+    if (empty())
+        return *this;
+
+    // Each axis of the new box gets the extreme contributions of the old one (Arvo)
+    Bounds bounds;
+    bounds.min = bounds.max = glm::vec3(matrix[3]);
+    for (int column = 0; column < 3; ++column) {
+        glm::vec3 a = glm::vec3(matrix[column]) * min[column];
+        glm::vec3 b = glm::vec3(matrix[column]) * max[column];
+        bounds.min += glm::min(a, b);
+        bounds.max += glm::max(a, b);
+    }
+
+    float scale = std::max({glm::length(glm::vec3(matrix[0])), glm::length(glm::vec3(matrix[1])),
+                            glm::length(glm::vec3(matrix[2]))});
+    bounds.center = glm::vec3(matrix * glm::vec4(center, 1.0f));
+    bounds.radius = radius * scale;
+    return bounds;
+}
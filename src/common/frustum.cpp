@@ -0,0 +1,109 @@
+#include "common/frustum.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HS_CULL_AVX2
+#include <immintrin.h>
+#endif
+
+Frustum Frustum::from_matrix(const glm::mat4 &view_projection) {
+    // glm is column major, row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+    auto row = [&](int i) {
+        return glm::vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]);
+    };
+
+    Frustum frustum{};
+    frustum.planes[0] = row(3) + row(0);
+    frustum.planes[1] = row(3) - row(0);
+    frustum.planes[2] = row(3) + row(1);
+    frustum.planes[3] = row(3) - row(1);
+    frustum.planes[4] = row(3) + row(2); // clip depth is [-1, 1]
+    frustum.planes[5] = row(3) - row(2);
+    for (auto &plane : frustum.planes)
+        plane /= glm::length(glm::vec3(plane));
+    return frustum;
+}
+
+bool Frustum::intersects_sphere(const glm::vec3 &center, float radius) const {
+    for (const auto &plane : planes)
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+            return false;
+    return true;
+}
+
+bool Frustum::intersects_box(const glm::vec3 &min, const glm::vec3 &max) const {
+    for (const auto &plane : planes) {
+        // Corner farthest along the normal
+        glm::vec3 corner(plane.x >= 0.0f ? max.x : min.x,
+                         plane.y >= 0.0f ? max.y : min.y,
+                         plane.z >= 0.0f ? max.z : min.z);
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+void BoundingSpheres::clear() {
+    x.clear();
+    y.clear();
+    z.clear();
+    radius.clear();
+}
+
+void BoundingSpheres::push_back(const glm::vec3 &center, float sphere_radius) {
+    x.push_back(center.x);
+    y.push_back(center.y);
+    z.push_back(center.z);
+    radius.push_back(sphere_radius);
+}
+
+static void cull_spheres_scalar(const Frustum &frustum, const BoundingSpheres &spheres, uint32_t first,
+                                uint32_t last, std::vector<uint32_t> &visible) {
+    for (uint32_t i = first; i < last; ++i)
+        if (frustum.intersects_sphere(glm::vec3(spheres.x[i], spheres.y[i], spheres.z[i]), spheres.radius[i]))
+            visible.push_back(i);
+}
+
+#ifdef HS_CULL_AVX2
+__attribute__((target("avx2")))
+static void cull_spheres_avx2(const Frustum &frustum, const BoundingSpheres &spheres, uint32_t first,
+                              uint32_t last, std::vector<uint32_t> &visible) {
+    __m256 nx[6], ny[6], nz[6], d[6];
+    for (int p = 0; p < 6; ++p) {
+        nx[p] = _mm256_set1_ps(frustum.planes[p].x);
+        ny[p] = _mm256_set1_ps(frustum.planes[p].y);
+        nz[p] = _mm256_set1_ps(frustum.planes[p].z);
+        d[p] = _mm256_set1_ps(frustum.planes[p].w);
+    }
+
+    uint32_t i = first;
+    for (; i + 8 <= last; i += 8) {
+        __m256 x = _mm256_loadu_ps(spheres.x.data() + i);
+        __m256 y = _mm256_loadu_ps(spheres.y.data() + i);
+        __m256 z = _mm256_loadu_ps(spheres.z.data() + i);
+        __m256 negative_radius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(spheres.radius.data() + i));
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; ++p) {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx[p], x), _mm256_mul_ps(ny[p], y)),
+                                            _mm256_add_ps(_mm256_mul_ps(nz[p], z), d[p]));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negative_radius, _CMP_GE_OQ));
+        }
+
+        for (auto mask = (unsigned int) _mm256_movemask_ps(inside); mask != 0; mask &= mask - 1)
+            visible.push_back(i + (uint32_t) __builtin_ctz(mask));
+    }
+    cull_spheres_scalar(frustum, spheres, i, last, visible);
+}
+#endif
+
+void cull_spheres(const Frustum &frustum, const BoundingSpheres &spheres, uint32_t first, uint32_t last,
+                  std::vector<uint32_t> &visible) {
+#ifdef HS_CULL_AVX2
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    if (has_avx2) {
+        cull_spheres_avx2(frustum, spheres, first, last, visible);
+        return;
+    }
+#endif
+    cull_spheres_scalar(frustum, spheres, first, last, visible);
+}
@@ -0,0 +1,100 @@
+#include "common/mapped_file.h"
+
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+#ifdef _WIN32
+
+tl::expected<MappedFile, std::string> MappedFile::open(const fs::path &path) {
+    std::ifstream fin(path, std::ios::binary | std::ios::ate);
+    if (!fin)
+        return tl::make_unexpected("Failed to open " + path.string());
+
+    MappedFile file;
+    file.buffer.resize((std::size_t) fin.tellg());
+    fin.seekg(0);
+    if (!fin.read(reinterpret_cast<char *>(file.buffer.data()), (std::streamsize) file.buffer.size()))
+        return tl::make_unexpected("Failed to read " + path.string());
+
+    file.ptr = file.buffer.data();
+    file.sz = file.buffer.size();
+    return file;
+}
+
+void MappedFile::close() {
+    buffer.clear();
+    ptr = nullptr;
+    sz = 0;
+}
+
+#else
+
+tl::expected<MappedFile, std::string> MappedFile::open(const fs::path &path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return tl::make_unexpected("Failed to open " + path.string() + ": " + std::strerror(errno));
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0) {
+        int err = errno;
+        ::close(fd);
+        return tl::make_unexpected("Failed to stat " + path.string() + ": " + std::strerror(err));
+    }
+
+    MappedFile file;
+    if (st.st_size > 0) {
+        void *addr = mmap(nullptr, (std::size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            int err = errno;
+            ::close(fd);
+            return tl::make_unexpected("Failed to map " + path.string() + ": " + std::strerror(err));
+        }
+        file.ptr = static_cast<const std::byte *>(addr);
+        file.sz = (std::size_t) st.st_size;
+    }
+
+    // The mapping keeps the file referenced
+    ::close(fd);
+    return file;
+}
+
+void MappedFile::close() {
+    if (ptr)
+        munmap(const_cast<std::byte *>(ptr), sz);
+    ptr = nullptr;
+    sz = 0;
+}
+
+#endif
+
+MappedFile::MappedFile(MappedFile &&other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+        close();
+#ifdef _WIN32
+        buffer = std::move(other.buffer);
+#endif
+        ptr = std::exchange(other.ptr, nullptr);
+        sz = std::exchange(other.sz, 0);
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
@@ -0,0 +1,74 @@
+#include "common/range_allocator.h"
+
+#include <algorithm>
+#include <cassert>
+
+RangeAllocator::RangeAllocator(uint64_t size) {
+    grow(size);
+}
+
+std::optional<uint64_t> RangeAllocator::allocate(uint64_t size, uint64_t alignment) {
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    if (size == 0)
+        return std::nullopt;
+
+    for (auto it = free_ranges.begin(); it != free_ranges.end(); ++it) {
+        auto [range_offset, range_size] = *it;
+        uint64_t offset = (range_offset + alignment - 1) & ~(alignment - 1);
+        if (offset + size > range_offset + range_size)
+            continue;
+
+        // Alignment padding before and the rest after the allocation stay free
+        free_ranges.erase(it);
+        if (offset > range_offset)
+            free_ranges.emplace(range_offset, offset - range_offset);
+        if (offset + size < range_offset + range_size)
+            free_ranges.emplace(offset + size, range_offset + range_size - offset - size);
+        used_size += size;
+        return offset;
+    }
+    return std::nullopt;
+}
+
+void RangeAllocator::free(uint64_t offset, uint64_t size) {
+    if (size == 0)
+        return;
+    assert(offset + size <= total && used_size >= size);
+    used_size -= size;
+
+    auto next = free_ranges.lower_bound(offset);
+    assert(next == free_ranges.end() || next->first >= offset + size);
+    if (next != free_ranges.end() && next->first == offset + size) {
+        size += next->second;
+        next = free_ranges.erase(next);
+    }
+    if (next != free_ranges.begin()) {
+        auto prev = std::prev(next);
+        assert(prev->first + prev->second <= offset);
+        if (prev->first + prev->second == offset) {
+            prev->second += size;
+            return;
+        }
+    }
+    free_ranges.emplace_hint(next, offset, size);
+}
+
+void RangeAllocator::grow(uint64_t new_size) {
+    if (new_size <= total)
+        return;
+    uint64_t old_size = total;
+    total = new_size;
+    used_size += new_size - old_size; // free() takes it back
+    free(old_size, new_size - old_size);
+}
+
+float RangeAllocator::fragmentation() const {
+    uint64_t free_size = total - used_size;
+    if (free_size == 0)
+        return 0.0f;
+
+    uint64_t largest = 0;
+    for (auto [offset, size] : free_ranges)
+        largest = std::max(largest, size);
+    return 1.0f - (float) largest / (float) free_size;
+}
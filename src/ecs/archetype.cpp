@@ -4,21 +4,19 @@ namespace ecs {
     bool EntityChunkMapping::insert(Id id, EntityPosInChunk entity_pos) {
         if (!present.contains(id)) {
             present.insert(id);
-            sparse.resize(present.capacity());
-
-            sparse[id] = dense.size();
+            sparse_slot(id) = dense.size();
             dense.push_back(entity_pos);
             dense_ids.push_back(id);
             return true;
         } else {
-            dense[sparse[id]] = entity_pos;
+            dense[sparse_at(id)] = entity_pos;
             return false;
         }
     }
 
     void EntityChunkMapping::insert_unsafe(Id id, EntityPosInChunk entity_pos) {
-        present.insert_unsafe(id);
-        sparse[id] = dense.size();
+        present.insert(id);
+        sparse_slot(id) = dense.size();
         dense.push_back(entity_pos);
         dense_ids.push_back(id);
     }
@@ -30,18 +28,15 @@ namespace ecs {
         dense_ids.resize(dense_sz + entities_count);
 
         for (std::size_t i = 0; i < entities_count; ++i) {
-            present.insert_unsafe(entities[i].id);
-            sparse[entities[i].id] = dense_sz + i;
+            present.insert(entities[i].id);
+            sparse_slot(entities[i].id) = dense_sz + i;
             dense[dense_sz + i] = starting_pos;
             dense_ids[dense_sz + i] = entities[i].id;
             ++starting_pos.index_in_chunk;
         }
     }
 
-    void EntityChunkMapping::reserve(Id max_id, std::size_t additional_count) {
-        present.reserve(max_id);
-        sparse.resize(present.capacity());
-
+    void EntityChunkMapping::reserve(std::size_t additional_count) {
         std::size_t next_capacity = 1;
         while (next_capacity < dense.size() + additional_count)
             next_capacity *= 2;
@@ -49,14 +44,45 @@ namespace ecs {
         dense_ids.reserve(next_capacity);
     }
 
+    uint32_t &EntityChunkMapping::sparse_slot(Id id) {
+        std::size_t dir_ind = id >> (sparse_page_shift + sparse_dir_shift);
+        if (dir_ind >= sparse.size())
+            sparse.resize(dir_ind + 1);
+        if (!sparse[dir_ind])
+            sparse[dir_ind] = std::make_unique<SparseDir>();
+
+        std::unique_ptr<SparsePage> &page = (*sparse[dir_ind])[(id >> sparse_page_shift) & sparse_dir_mask];
+        if (!page)
+            page = std::make_unique<SparsePage>();
+        return (*page)[id & sparse_page_mask];
+    }
+
+    std::size_t EntityChunkMapping::memory_usage() const {
+        std::size_t bytes = dense.capacity() * sizeof(EntityPosInChunk) +
+                            dense_ids.capacity() * sizeof(uint32_t) +
+                            sparse.capacity() * sizeof(std::unique_ptr<SparseDir>) +
+                            present.memory_usage();
+        for (const auto &dir : sparse) {
+            if (!dir)
+                continue;
+            bytes += sizeof(SparseDir);
+            for (const auto &page : *dir)
+                if (page)
+                    bytes += sizeof(SparsePage);
+        }
+        return bytes;
+    }
+
     bool EntityChunkMapping::erase(Id id) {
         if (present.erase(id)) {
-            std::swap(dense.back(), dense[sparse[id]]);
-            std::swap(dense_ids.back(), dense_ids[sparse[id]]);
+            uint32_t pos = sparse_at(id);
+            std::swap(dense.back(), dense[pos]);
+            std::swap(dense_ids.back(), dense_ids[pos]);
             dense.pop_back();
             dense_ids.pop_back();
 
-            sparse[dense_ids[sparse[id]]] = sparse[id];
+            if (pos < dense.size())
+                sparse_slot(dense_ids[pos]) = pos;
             return true;
         }
         return false;
@@ -76,11 +102,7 @@ namespace ecs {
                                       SharedComponentsData shared_components,
                                       const Entity *entities) {
 
-        Id max_id = 0;
-        for (std::size_t i = 0; i < entities_count; ++i)
-            max_id = std::max(max_id, entities[i].id);
-
-        entities_mapping->reserve(max_id, entities_count);
+        entities_mapping->reserve(entities_count);
 
         std::vector<std::size_t> comp_indices(components.components_count);
         _layout.get_component_indices(components.components_count,
@@ -204,13 +226,20 @@ namespace ecs {
     -> Storage::iterator {
         DynamicIdSetAnd sets_and = query_mask(components_count,
                                               types);
-
-        Id id = find_if(sets_and, [&](Id id) {
+        auto matches = [&](Id id) {
             return storage[id]->components_count() == components_count;
-        });
+        };
+
+        std::optional<Id> id;
+        if (components_count) {
+            sets_and.materialize(query_scratch);
+            id = find_if(query_scratch, matches);
+        } else {
+            id = find_if(sets_and, matches);
+        }
 
-        if (id != IdSet::max_size)
-            return storage.begin() + id;
+        if (id)
+            return storage.begin() + *id;
         else
             return storage.end();
     }
@@ -0,0 +1,59 @@
+#include "ecs/concurrent_id_set.h"
+
+namespace ecs {
+    ConcurrentIdSet::ConcurrentIdSet(std::size_t capacity) {
+        assert(capacity <= IdSet::max_size);
+
+        cp = 1;
+        while (cp < capacity) cp <<= 1;
+
+        std::size_t total = 0;
+        for (std::size_t i = 0; i + 1 < levels_num; ++i) {
+            lvl_cp[i] = std::max<std::size_t>(1, cp >> (IdSet::shift * (i + 1)));
+            total += lvl_cp[i];
+        }
+
+        words = std::make_unique<std::atomic<uint64_t>[]>(total); // value-initialized to zero
+        std::size_t offset = 0;
+        for (std::size_t i = 0; i + 1 < levels_num; ++i) {
+            levels[i] = words.get() + offset;
+            offset += lvl_cp[i];
+        }
+    }
+
+    void ConcurrentIdSet::merge_into(IdSet &result) const {
+        result.reserve(cp);
+        foreach_block(*this, [&result](Id base, uint64_t mask) {
+            std::size_t ind = base >> IdSet::shift;
+            uint64_t &word = result.levels[0][ind];
+            result.sz += __builtin_popcountll(mask & ~word);
+            word |= mask;
+
+            for (std::size_t lvl = 1; lvl < levels_num; ++lvl) {
+                uint32_t pos = ind & IdSet::lower_bits;
+                ind >>= IdSet::shift;
+                detail::set_bit(result.levels[lvl][ind], pos);
+            }
+        });
+    }
+
+    void ConcurrentIdSet::clear() {
+        uint64_t lvl3_data = level3.exchange(0, std::memory_order_relaxed);
+        while (lvl3_data) {
+            std::size_t lvl2 = __builtin_ctzll(lvl3_data);
+            uint64_t lvl2_data = levels[2][lvl2].exchange(0, std::memory_order_relaxed);
+            while (lvl2_data) {
+                std::size_t lvl1 = (lvl2 << IdSet::shift) | __builtin_ctzll(lvl2_data);
+                uint64_t lvl1_data = levels[1][lvl1].exchange(0, std::memory_order_relaxed);
+                while (lvl1_data) {
+                    std::size_t lvl0 = (lvl1 << IdSet::shift) | __builtin_ctzll(lvl1_data);
+                    levels[0][lvl0].store(0, std::memory_order_relaxed);
+                    lvl1_data &= lvl1_data - 1;
+                }
+                lvl2_data &= lvl2_data - 1;
+            }
+            lvl3_data &= lvl3_data - 1;
+        }
+        sz.store(0, std::memory_order_relaxed);
+    }
+}
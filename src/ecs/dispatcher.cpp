@@ -1,4 +1,8 @@
 #include "ecs/dispatcher.h"
+#include "common/trace.h"
+
+#include <algorithm>
+#include <map>
 
 namespace ecs {
     namespace detail {
@@ -102,13 +106,198 @@ namespace ecs {
             }
         }
 
+        stagger_groups();
+
         successfully_created = true;
         return {};
     }
 
+    void Dispatcher::stagger_groups() {
+        // Systems of all the groups sharing a rate are spread together
+        std::map<uint32_t, uint32_t> next_frame_phase;
+        std::map<float, uint32_t> time_rate_size;
+        std::map<float, uint32_t> next_time_phase;
+
+        for (auto &i_system : systems) {
+            const auto &criteria = groups[schedules[i_system.id()].group].criteria;
+            if (criteria.stagger && criteria.every_seconds > 0.0f)
+                ++time_rate_size[criteria.every_seconds];
+        }
+
+        for (auto &i_system : systems) {
+            auto &schedule = schedules[i_system.id()];
+            const auto &criteria = groups[schedule.group].criteria;
+            schedule.frames_left = 0;
+            schedule.time_left = 0.0f;
+            schedule.elapsed = 0.0f;
+            if (schedule.group == detail::default_group || !criteria.stagger)
+                continue;
+
+            if (criteria.every_frames > 1)
+                schedule.frames_left = next_frame_phase[criteria.every_frames]++ % criteria.every_frames;
+
+            if (criteria.every_seconds > 0.0f) {
+                uint32_t phase = next_time_phase[criteria.every_seconds]++;
+                schedule.time_left = criteria.every_seconds * (float) phase /
+                                     (float) time_rate_size[criteria.every_seconds];
+            }
+        }
+    }
+
+    bool Dispatcher::is_due(detail::SystemSchedule &schedule, float pass_delta_time) {
+        schedule.elapsed += pass_delta_time;
+        bool due = is_due_now(schedule);
+        schedule.time_left -= pass_delta_time;
+        return due;
+    }
+
+    bool Dispatcher::is_due_now(detail::SystemSchedule &schedule) {
+        if (schedule.frames_left > 0) {
+            --schedule.frames_left;
+            return false;
+        }
+        if (schedule.time_left > 0.0f)
+            return false;
+
+        auto &group = groups[schedule.group];
+        const auto &criteria = group.criteria;
+        if (criteria.condition) {
+            if (group.evaluated_pass != pass_index) {
+                group.condition_met = criteria.condition(*world);
+                group.evaluated_pass = pass_index;
+            }
+            if (!group.condition_met)
+                return false;
+        }
+
+        schedule.frames_left = criteria.every_frames > 0 ? criteria.every_frames - 1 : 0;
+        schedule.time_left += criteria.every_seconds;
+        if (schedule.time_left < 0.0f) // more than a period behind, do not burst
+            schedule.time_left = criteria.every_seconds;
+        return true;
+    }
+
+    std::optional<uint32_t> Dispatcher::find_group(std::string_view name) const {
+        for (uint32_t i = 1; i < groups.size(); ++i)
+            if (groups[i].name == name)
+                return i;
+        return std::nullopt;
+    }
+
     void Dispatcher::update() {
-        for (auto &i_system : systems)
-            i_system.update(*world);
+        auto &delta_time = world->get<DeltaTime>();
+        auto &fixed_time = world->get<FixedTime>();
+
+        uint32_t steps = fixed_time.advance(delta_time());
+        if (steps) {
+            float frame_delta_time = delta_time();
+            delta_time.set(fixed_time.step());
+            for (uint32_t i = 0; i < steps; ++i)
+                update_fixed_step();
+            delta_time.set(frame_delta_time);
+        }
+
+        update_frame();
+    }
+
+    void Dispatcher::update(float delta_time) {
+        world->get<DeltaTime>().set(delta_time);
+        update();
+    }
+
+    void Dispatcher::loop(const HeadlessLoop &headless) {
+        auto &game_loop_control = world->get<GameLoopControl>();
+        for (uint64_t frame = 0; headless.frames == 0 || frame < headless.frames; ++frame) {
+            if (game_loop_control.stopped())
+                break;
+            update(headless.delta_time);
+        }
+    }
+
+    void Dispatcher::update_fixed_step() {
+        update_systems(true);
+    }
+
+    void Dispatcher::update_frame() {
+        update_systems(false);
+    }
+
+    void Dispatcher::update_systems(bool fixed_step) {
+        ++pass_index;
+        auto &delta_time = world->get<DeltaTime>();
+        float pass_delta_time = delta_time();
+
+        for (auto &i_system : systems) {
+            if (i_system.fixed_step() != fixed_step)
+                continue;
+
+            auto &schedule = schedules[i_system.id()];
+            if (schedule.group == detail::default_group && i_system.parallel()) {
+                add_to_parallel_batch(i_system);
+                continue;
+            }
+
+            run_parallel_batch();
+
+            if (schedule.group == detail::default_group) {
+                HS_ZONE(i_system.name().c_str());
+                i_system.update(*world);
+                continue;
+            }
+
+            // Grouped systems run on the main thread because DeltaTime is altered for them
+            if (!is_due(schedule, pass_delta_time))
+                continue;
+
+            // Grouped systems see the time elapsed since their previous update
+            delta_time.set(schedule.elapsed);
+            schedule.elapsed = 0.0f;
+            {
+                HS_ZONE(i_system.name().c_str());
+                i_system.update(*world);
+            }
+            delta_time.set(pass_delta_time);
+        }
+
+        run_parallel_batch();
+    }
+
+    void Dispatcher::add_to_parallel_batch(detail::ISystem &i_system) {
+        bool depends_on_batch = std::any_of(
+                i_system.dependencies().begin(), i_system.dependencies().end(),
+                [this](uint32_t dependency) { return batch_systems[dependency]; });
+        bool conflicts = (i_system.writes() & (batch_reads | batch_writes)).any() ||
+                         (i_system.reads() & batch_writes).any();
+        if (depends_on_batch || conflicts)
+            run_parallel_batch();
+
+        parallel_batch.push_back(&i_system);
+        batch_reads |= i_system.reads();
+        batch_writes |= i_system.writes();
+        batch_systems.set(i_system.id());
+    }
+
+    void Dispatcher::run_parallel_batch() {
+        if (parallel_batch.empty())
+            return;
+
+        auto &jobs = world->get<Jobs>();
+        JobCounter counter;
+        for (std::size_t i = 1; i < parallel_batch.size(); ++i)
+            jobs.spawn(counter, [this, i_system = parallel_batch[i]] {
+                HS_ZONE(i_system->name().c_str());
+                i_system->update(*world);
+            });
+        {
+            HS_ZONE(parallel_batch[0]->name().c_str());
+            parallel_batch[0]->update(*world);
+        }
+        jobs.wait(counter);
+
+        parallel_batch.clear();
+        batch_reads.reset();
+        batch_writes.reset();
+        batch_systems.reset();
     }
 
     Dispatcher::~Dispatcher() {
@@ -130,7 +319,26 @@ namespace ecs {
         return *world;
     }
 
+    DispatcherBuilder &&DispatcherBuilder::add_group(std::string name, RunCriteria criteria) && {
+        if (dispatcher.find_group(name) || name.empty()) {
+            if (!group_error)
+                group_error = Dispatcher::GroupError{
+                        .group_name = name,
+                        .message = "Group \"" + name + "\" is added twice or has an empty name."
+                };
+        } else {
+            dispatcher.groups.push_back(detail::SystemGroup{
+                    .name = std::move(name),
+                    .criteria = std::move(criteria)
+            });
+        }
+        return std::move(*this);
+    }
+
     tl::expected<Dispatcher, Dispatcher::DispatcherError> DispatcherBuilder::build() && {
+        if (group_error)
+            return tl::make_unexpected(std::move(*group_error));
+
         if (auto result = dispatcher.setup())
             return std::move(dispatcher);
         else
@@ -0,0 +1,125 @@
+#include "ecs/id_set.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace ecs {
+    namespace detail {
+        using AndWordsFn = void (*)(uint64_t *dst, const uint64_t *const *srcs, std::size_t srcs_count,
+                                    std::size_t offset, std::size_t count);
+
+        /**
+         * dst[i] = srcs[0][offset + i] & ... & srcs[srcs_count - 1][offset + i]
+         */
+        static void and_words_scalar(uint64_t *dst, const uint64_t *const *srcs, std::size_t srcs_count,
+                                     std::size_t offset, std::size_t count) {
+            for (std::size_t i = 0; i < count; ++i) {
+                uint64_t word = srcs[0][offset + i];
+                for (std::size_t j = 1; j < srcs_count; ++j)
+                    word &= srcs[j][offset + i];
+                dst[i] = word;
+            }
+        }
+
+#if defined(__x86_64__) || defined(__i386__)
+        __attribute__((target("sse2")))
+        static void and_words_sse2(uint64_t *dst, const uint64_t *const *srcs, std::size_t srcs_count,
+                                   std::size_t offset, std::size_t count) {
+            std::size_t i = 0;
+            for (; i + 2 <= count; i += 2) {
+                __m128i word = _mm_loadu_si128((const __m128i *) (srcs[0] + offset + i));
+                for (std::size_t j = 1; j < srcs_count; ++j)
+                    word = _mm_and_si128(word, _mm_loadu_si128((const __m128i *) (srcs[j] + offset + i)));
+                _mm_storeu_si128((__m128i *) (dst + i), word);
+            }
+            and_words_scalar(dst + i, srcs, srcs_count, offset + i, count - i);
+        }
+
+        __attribute__((target("avx2")))
+        static void and_words_avx2(uint64_t *dst, const uint64_t *const *srcs, std::size_t srcs_count,
+                                   std::size_t offset, std::size_t count) {
+            std::size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                __m256i word = _mm256_loadu_si256((const __m256i *) (srcs[0] + offset + i));
+                for (std::size_t j = 1; j < srcs_count; ++j)
+                    word = _mm256_and_si256(word, _mm256_loadu_si256((const __m256i *) (srcs[j] + offset + i)));
+                _mm256_storeu_si256((__m256i *) (dst + i), word);
+            }
+            and_words_scalar(dst + i, srcs, srcs_count, offset + i, count - i);
+        }
+#endif
+
+        static AndWordsFn select_and_words() {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+                return and_words_avx2;
+            if (__builtin_cpu_supports("sse2"))
+                return and_words_sse2;
+#endif
+            return and_words_scalar;
+        }
+
+        static void and_words(uint64_t *dst, const uint64_t *const *srcs, std::size_t srcs_count,
+                              std::size_t offset, std::size_t count) {
+            static const AndWordsFn impl = select_and_words();
+            impl(dst, srcs, srcs_count, offset, count);
+        }
+    }
+
+    void DynamicIdSetAnd::materialize(IdSet &result) const {
+        assert(!sets.empty());
+
+        result.clear();
+        result.reserve(capacity());
+
+        std::size_t words = level_capacity(0);
+        std::size_t blocks = (words + IdSet::lower_bits) >> IdSet::shift;
+        std::size_t super_blocks = (blocks + IdSet::lower_bits) >> IdSet::shift;
+
+        static const std::size_t max_stack_sets = 32;
+        const uint64_t *srcs_stack[max_stack_sets];
+        std::vector<const uint64_t *> srcs_heap;
+        const uint64_t **srcs = srcs_stack;
+        if (sets.size() > max_stack_sets) {
+            srcs_heap.resize(sets.size());
+            srcs = srcs_heap.data();
+        }
+        for (std::size_t i = 0; i < sets.size(); ++i)
+            srcs[i] = sets[i]->levels[0];
+
+        // The sparsest set drives: only its non-empty blocks are visited
+        const IdSet &driver = *sets[0];
+        for (std::size_t super_block = 0; super_block < super_blocks; ++super_block) {
+            uint64_t driver_blocks = driver.level_data(2, super_block);
+            while (driver_blocks) {
+                std::size_t block = (super_block << IdSet::shift) | __builtin_ctzll(driver_blocks);
+                driver_blocks &= driver_blocks - 1;
+                if (block >= blocks)
+                    break;
+
+                if (!level_data(1, block))
+                    continue;
+
+                std::size_t begin = block << IdSet::shift;
+                std::size_t count = std::min<std::size_t>(IdSet::bits_num, words - begin);
+                uint64_t *dst = result.levels[0] + begin;
+                detail::and_words(dst, srcs, sets.size(), begin, count);
+
+                uint64_t block_mask = 0;
+                for (std::size_t i = 0; i < count; ++i)
+                    if (dst[i]) {
+                        block_mask |= 1ull << i;
+                        result.sz += __builtin_popcountll(dst[i]);
+                    }
+                if (!block_mask)
+                    continue;
+
+                result.levels[1][block] = block_mask;
+                detail::set_bit(result.levels[2][block >> IdSet::shift], block & IdSet::lower_bits);
+                detail::set_bit(result.level3, block >> IdSet::shift);
+            }
+        }
+    }
+}
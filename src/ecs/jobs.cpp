@@ -0,0 +1,214 @@
+#include "ecs/jobs.h"
+#include "common/trace.h"
+
+#include <cassert>
+#include <string>
+#include <utility>
+
+namespace ecs {
+    namespace detail {
+        struct JobsThreadState {
+            const Jobs *owner = nullptr;
+            uint32_t queue_index = 0;
+            const Jobs *running_background = nullptr; // Jobs whose background task the thread runs
+        };
+
+        static thread_local JobsThreadState jobs_thread_state;
+    }
+
+    Jobs::Jobs(uint32_t workers_count) : _workers_count(workers_count) {
+        for (uint32_t i = 0; i <= workers_count; ++i)
+            queues.push_back(std::make_unique<Queue>());
+    }
+
+    Jobs::~Jobs() {
+        {
+            std::lock_guard lock(sleep_mutex);
+            stopping = true;
+        }
+        sleep_cv.notify_all();
+        for (auto &worker : workers)
+            worker.join();
+    }
+
+    uint32_t Jobs::default_workers_count() {
+        uint32_t cores = std::thread::hardware_concurrency();
+        return cores > 1 ? cores - 1 : 0;
+    }
+
+    void Jobs::start() {
+        for (uint32_t i = 1; i <= _workers_count; ++i)
+            workers.emplace_back([this, i] { worker_loop(i); });
+        if (_workers_count == 0)
+            workers.emplace_back([this] { background_loop(); });
+    }
+
+    void Jobs::spawn(JobCounter &counter, Task task) {
+        if (detail::jobs_thread_state.running_background == this) {
+            spawn_background(counter, std::move(task));
+            return;
+        }
+        std::call_once(started, [this] { start(); });
+
+        counter.pending.fetch_add(1, std::memory_order_relaxed);
+        auto &queue = *queues[this_thread_queue()];
+        {
+            std::lock_guard lock(queue.mutex);
+            queue.tasks.push_back([&counter, task = std::move(task)] {
+                task();
+                counter.pending.fetch_sub(1, std::memory_order_release);
+            });
+        }
+        queued.fetch_add(1, std::memory_order_release);
+        notify();
+    }
+
+    void Jobs::spawn_background(JobCounter &counter, Task task) {
+        std::call_once(started, [this] { start(); });
+
+        counter.pending.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard lock(background_mutex);
+            background.push_back(BackgroundTask{&counter, [this, &counter, task = std::move(task)] {
+                auto &state = detail::jobs_thread_state;
+                const Jobs *running = std::exchange(state.running_background, this);
+                task();
+                state.running_background = running;
+                counter.pending.fetch_sub(1, std::memory_order_release);
+            }});
+        }
+        background_queued.fetch_add(1, std::memory_order_release);
+        notify();
+    }
+
+    void Jobs::notify() {
+        { std::lock_guard lock(sleep_mutex); } // a worker is either awake or already waiting
+        sleep_cv.notify_one();
+    }
+
+    void Jobs::wait(JobCounter &counter) {
+        uint32_t queue_index = this_thread_queue();
+        while (!counter.done())
+            if (!try_run_one(queue_index) && !try_run_background(&counter))
+                std::this_thread::yield();
+    }
+
+    void Jobs::run(const TaskGraph &graph) {
+        std::size_t size = graph.nodes.size();
+        auto pending_dependencies = std::make_unique<std::atomic<uint32_t>[]>(size);
+        for (std::size_t i = 0; i < size; ++i)
+            pending_dependencies[i].store(graph.nodes[i].dependencies_count, std::memory_order_relaxed);
+
+        JobCounter counter;
+        // Successors are spawned before the task is counted as finished,
+        // so the counter drops to zero only when the whole graph is done.
+        std::function<void(TaskGraph::TaskId)> spawn_node = [&](TaskGraph::TaskId id) {
+            spawn(counter, [&, id] {
+                const auto &node = graph.nodes[id];
+                node.task();
+                for (TaskGraph::TaskId successor : node.successors)
+                    if (pending_dependencies[successor].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                        spawn_node(successor);
+            });
+        };
+
+        bool has_roots = false;
+        for (std::size_t i = 0; i < size; ++i)
+            if (graph.nodes[i].dependencies_count == 0) {
+                spawn_node((TaskGraph::TaskId) i);
+                has_roots = true;
+            }
+        assert(has_roots || size == 0); // cyclic graph would never finish
+        wait(counter);
+    }
+
+    void Jobs::worker_loop(uint32_t queue_index) {
+        detail::jobs_thread_state = {this, queue_index};
+        trace::set_thread_name("ecs::Jobs worker " + std::to_string(queue_index));
+
+        while (true) {
+            if (try_run_one(queue_index) || try_run_background(nullptr))
+                continue;
+
+            std::unique_lock lock(sleep_mutex);
+            sleep_cv.wait(lock, [this] {
+                return stopping || queued.load(std::memory_order_acquire) > 0 ||
+                       background_queued.load(std::memory_order_acquire) > 0;
+            });
+            if (stopping)
+                return;
+        }
+    }
+
+    void Jobs::background_loop() {
+        trace::set_thread_name("ecs::Jobs background");
+
+        while (true) {
+            if (try_run_background(nullptr))
+                continue;
+
+            std::unique_lock lock(sleep_mutex);
+            sleep_cv.wait(lock, [this] {
+                return stopping || background_queued.load(std::memory_order_acquire) > 0;
+            });
+            if (stopping)
+                return;
+        }
+    }
+
+    uint32_t Jobs::this_thread_queue() const {
+        const auto &state = detail::jobs_thread_state;
+        return state.owner == this ? state.queue_index : 0;
+    }
+
+    bool Jobs::try_run_one(uint32_t queue_index) {
+        Task task;
+
+        // Own tasks are taken LIFO for locality, stolen ones FIFO
+        {
+            auto &queue = *queues[queue_index];
+            std::lock_guard lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }
+        }
+
+        for (std::size_t i = 1; !task && i < queues.size(); ++i) {
+            auto &queue = *queues[(queue_index + i) % queues.size()];
+            std::lock_guard lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+        }
+
+        if (!task)
+            return false;
+
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        task();
+        return true;
+    }
+
+    bool Jobs::try_run_background(const JobCounter *counter) {
+        if (background_queued.load(std::memory_order_acquire) == 0)
+            return false;
+
+        Task task;
+        {
+            std::lock_guard lock(background_mutex);
+            auto it = counter ? std::find_if(background.begin(), background.end(), [&](const BackgroundTask &t) {
+                return t.counter == counter;
+            }) : background.begin();
+            if (it == background.end())
+                return false;
+            task = std::move(it->task);
+            background.erase(it);
+        }
+
+        background_queued.fetch_sub(1, std::memory_order_relaxed);
+        task();
+        return true;
+    }
+}
@@ -0,0 +1,138 @@
+#include "ecs/paged_id_set.h"
+
+#include <cassert>
+
+namespace ecs {
+    PagedIdSet::PagedIdSet() : pool(page_words, 0) {}
+
+    void PagedIdSet::insert(Id id) {
+        assert(id < max_size);
+        while (id >= capacity())
+            grow_levels();
+
+        for (std::size_t lvl = 0; lvl < lvl_num; ++lvl) {
+            std::size_t ind = (std::size_t) id >> (IdSet::shift * (lvl + 1));
+            uint32_t bit = (id >> (IdSet::shift * lvl)) & IdSet::lower_bits;
+
+            uint64_t &data = word(lvl, ind);
+            if (lvl == 0 && (data >> bit) & 1ull)
+                return; // already present
+            bool was_empty = data == 0;
+            detail::set_bit(data, bit);
+            if (!was_empty)
+                break; // upper levels already mark this word
+        }
+        ++sz;
+    }
+
+    bool PagedIdSet::erase(Id id) {
+        if (!contains(id))
+            return false;
+
+        for (std::size_t lvl = 0; lvl < lvl_num; ++lvl) {
+            std::size_t ind = (std::size_t) id >> (IdSet::shift * (lvl + 1));
+            uint32_t bit = (id >> (IdSet::shift * lvl)) & IdSet::lower_bits;
+
+            std::size_t page = ind >> page_shift;
+            uint64_t *words = pool.data() + ((std::size_t) find_page(lvl, page) << page_shift);
+            uint64_t &data = words[ind & (page_words - 1)];
+            detail::reset_bit(data, bit);
+            if (data != 0)
+                break; // the word still has bits, upper levels stay
+
+            bool page_empty = true;
+            for (std::size_t i = 0; i < page_words && page_empty; ++i)
+                page_empty = words[i] == 0;
+            if (page_empty)
+                release_page(lvl, page);
+        }
+        --sz;
+        return true;
+    }
+
+    void PagedIdSet::clear() {
+        pool.resize(page_words);
+        free_pages.clear();
+        std::fill(slots.begin(), slots.end(), Slot{});
+        used_slots = 0;
+        lvl_num = 1;
+        sz = 0;
+    }
+
+    std::size_t PagedIdSet::memory_usage() const {
+        return pool.capacity() * sizeof(uint64_t) +
+               free_pages.capacity() * sizeof(uint32_t) +
+               slots.capacity() * sizeof(Slot);
+    }
+
+    uint64_t &PagedIdSet::word(std::size_t lvl, std::size_t ind) {
+        std::size_t page_ind = ind >> page_shift;
+        uint32_t page = find_page(lvl, page_ind);
+        if (!page) {
+            if (free_pages.empty()) {
+                page = (uint32_t) (pool.size() >> page_shift);
+                pool.resize(pool.size() + page_words, 0);
+            } else {
+                page = free_pages.back(); // released pages are zeroed
+                free_pages.pop_back();
+            }
+
+            if ((used_slots + 1) * 2 > slots.size())
+                grow_slots();
+            uint32_t key = page_key(lvl, page_ind);
+            std::size_t mask = slots.size() - 1;
+            std::size_t i = slot_index(key);
+            while (slots[i].key != empty_key)
+                i = (i + 1) & mask;
+            slots[i] = Slot{.key = key, .page = page};
+            ++used_slots;
+        }
+        return pool[((std::size_t) page << page_shift) | (ind & (page_words - 1))];
+    }
+
+    void PagedIdSet::release_page(std::size_t lvl, std::size_t page) {
+        uint32_t key = page_key(lvl, page);
+        std::size_t mask = slots.size() - 1;
+        std::size_t i = slot_index(key);
+        while (slots[i].key != key)
+            i = (i + 1) & mask;
+        free_pages.push_back(slots[i].page);
+
+        // Backward shift deletion: pull up the following entries
+        // which would become unreachable through the hole
+        for (std::size_t j = (i + 1) & mask; slots[j].key != empty_key; j = (j + 1) & mask) {
+            std::size_t home = slot_index(slots[j].key);
+            if (((j - home) & mask) >= ((j - i) & mask)) {
+                slots[i] = slots[j];
+                i = j;
+            }
+        }
+        slots[i] = Slot{};
+        --used_slots;
+    }
+
+    void PagedIdSet::grow_slots() {
+        std::vector<Slot> old = std::move(slots);
+        slots_shift = old.empty() ? 4 : slots_shift + 1;
+        slots.assign(std::size_t(1) << slots_shift, Slot{});
+
+        std::size_t mask = slots.size() - 1;
+        for (const Slot &slot : old) {
+            if (slot.key == empty_key)
+                continue;
+            std::size_t i = slot_index(slot.key);
+            while (slots[i].key != empty_key)
+                i = (i + 1) & mask;
+            slots[i] = slot;
+        }
+    }
+
+    void PagedIdSet::grow_levels() {
+        assert(lvl_num < max_levels);
+        // The old top word becomes the word 0 of the level below the new top
+        bool was_empty = sz == 0;
+        ++lvl_num;
+        if (!was_empty)
+            detail::set_bit(word(lvl_num - 1, 0), 0);
+    }
+}
@@ -0,0 +1,91 @@
+#include "render/cooked_file.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace render {
+    static uint64_t fnv1a(uint64_t hash, const void *data, std::size_t size) {
+        auto bytes = static_cast<const unsigned char *>(data);
+        for (std::size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    std::optional<uint64_t> source_key(const fs::path &source) {
+        std::error_code ec;
+        fs::path canonical = fs::canonical(source, ec);
+        if (ec) return std::nullopt;
+        uintmax_t size = fs::file_size(canonical, ec);
+        if (ec) return std::nullopt;
+        auto mtime = fs::last_write_time(canonical, ec).time_since_epoch().count();
+        if (ec) return std::nullopt;
+
+        std::string path_str = canonical.string();
+        uint64_t key = fnv1a(0xcbf29ce484222325ull, path_str.data(), path_str.size());
+        key = fnv1a(key, &size, sizeof(size));
+        key = fnv1a(key, &mtime, sizeof(mtime));
+        return key;
+    }
+
+    fs::path default_cache_directory() {
+        std::error_code ec;
+        fs::path temp = fs::temp_directory_path(ec);
+        return ec ? fs::path() : temp / "high_shift" / "cache";
+    }
+
+    fs::path cooked_path(const fs::path &directory, uint64_t key, const char *extension) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx", (unsigned long long) key);
+        return directory / (name + std::string(extension));
+    }
+
+    CookedFileWriter::CookedFileWriter(fs::path path) : path(std::move(path)) {
+        std::error_code ec;
+        fs::create_directories(this->path.parent_path(), ec);
+
+        // Concurrent cooks of the same source write their own temporary files
+        static std::atomic<uint32_t> temp_counter{0};
+        temp_path = this->path;
+        temp_path += "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) +
+                     "." + std::to_string(temp_counter.fetch_add(1)) + ".tmp";
+        fout.open(temp_path, std::ios::binary);
+    }
+
+    CookedFileWriter::~CookedFileWriter() {
+        if (committed)
+            return;
+        fout.close();
+        std::error_code ec;
+        fs::remove(temp_path, ec);
+    }
+
+    void CookedFileWriter::write(const void *data, std::size_t size) {
+        fout.write(static_cast<const char *>(data), (std::streamsize) size);
+        written += size;
+    }
+
+    void CookedFileWriter::pad_to(uint64_t offset) {
+        static const char zeros[4096]{};
+        while (written < offset)
+            write(zeros, std::min<uint64_t>(offset - written, sizeof(zeros)));
+    }
+
+    tl::expected<void, std::string> CookedFileWriter::commit() {
+        fout.close();
+        if (!fout)
+            return tl::make_unexpected("Failed to write " + temp_path.string());
+
+        std::error_code ec;
+        fs::rename(temp_path, path, ec);
+        if (ec)
+            return tl::make_unexpected("Failed to write " + path.string() + ": " + ec.message());
+        committed = true;
+        return {};
+    }
+}
@@ -0,0 +1,153 @@
+#include "render/gl_state_cache.h"
+
+#include <glad/glad.h>
+
+namespace render {
+    static int buffer_slot(unsigned int target) {
+        switch (target) {
+            case GL_ARRAY_BUFFER: return 0;
+            case GL_ELEMENT_ARRAY_BUFFER: return 1;
+            case GL_COPY_READ_BUFFER: return 2;
+            case GL_COPY_WRITE_BUFFER: return 3;
+            case GL_UNIFORM_BUFFER: return 4;
+            default: return -1;
+        }
+    }
+
+    bool GLStateCache::change(unsigned int &shadow, unsigned int value) {
+        if (shadow == value) {
+            ++counters.elided;
+            return false;
+        }
+        shadow = value;
+        ++counters.issued;
+        return true;
+    }
+
+    bool GLStateCache::change(Toggle &shadow, bool enabled) {
+        Toggle value = enabled ? Toggle::on : Toggle::off;
+        if (shadow == value) {
+            ++counters.elided;
+            return false;
+        }
+        shadow = value;
+        ++counters.issued;
+        return true;
+    }
+
+    void GLStateCache::use_program(unsigned int id) {
+        if (change(program, id))
+            glUseProgram(id);
+    }
+
+    void GLStateCache::bind_vertex_array(unsigned int id) {
+        if (change(vertex_array, id)) {
+            glBindVertexArray(id);
+            buffers[buffer_slot(GL_ELEMENT_ARRAY_BUFFER)] = unknown;
+        }
+    }
+
+    void GLStateCache::bind_buffer(unsigned int target, unsigned int buffer) {
+        int slot = buffer_slot(target);
+        if (slot < 0) {
+            ++counters.issued;
+            glBindBuffer(target, buffer);
+        } else if (change(buffers[slot], buffer)) {
+            glBindBuffer(target, buffer);
+        }
+    }
+
+    void GLStateCache::bind_uniform_buffer(unsigned int index, unsigned int buffer, std::size_t offset,
+                                           std::size_t size) {
+        BufferRange range{buffer, offset, size};
+        if (uniform_buffers[index] == range) {
+            ++counters.elided;
+            return;
+        }
+        uniform_buffers[index] = range;
+        buffers[buffer_slot(GL_UNIFORM_BUFFER)] = buffer;
+        ++counters.issued;
+        glBindBufferRange(GL_UNIFORM_BUFFER, index, buffer, (GLintptr) offset, (GLsizeiptr) size);
+    }
+
+    void GLStateCache::bind_texture(unsigned int unit, unsigned int texture) {
+        if (textures[unit] == texture) {
+            ++counters.elided;
+            return;
+        }
+        if (change(active_unit, unit))
+            glActiveTexture(GL_TEXTURE0 + unit);
+        change(textures[unit], texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+    }
+
+    void GLStateCache::set_capability(unsigned int capability, Toggle &shadow, bool enabled) {
+        if (!change(shadow, enabled))
+            return;
+        if (enabled)
+            glEnable(capability);
+        else
+            glDisable(capability);
+    }
+
+    void GLStateCache::set_depth_test(bool enabled) {
+        set_capability(GL_DEPTH_TEST, depth_test, enabled);
+    }
+
+    void GLStateCache::set_depth_write(bool enabled) {
+        if (change(depth_write, enabled))
+            glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+    }
+
+    void GLStateCache::set_blend(bool enabled) {
+        set_capability(GL_BLEND, blend, enabled);
+    }
+
+    void GLStateCache::set_blend_func(unsigned int source, unsigned int destination) {
+        if (blend_source == source && blend_destination == destination) {
+            ++counters.elided;
+            return;
+        }
+        blend_source = source;
+        blend_destination = destination;
+        ++counters.issued;
+        glBlendFunc(source, destination);
+    }
+
+    // GL unbinds deleted objects, the shadow follows it
+    void GLStateCache::delete_buffer(unsigned int buffer) {
+        for (auto &bound : buffers)
+            if (bound == buffer)
+                bound = 0;
+        for (auto &range : uniform_buffers)
+            if (range.buffer == buffer)
+                range.buffer = unknown; // whether indexed bindings are reset differs between drivers
+        glDeleteBuffers(1, &buffer);
+    }
+
+    void GLStateCache::delete_vertex_array(unsigned int id) {
+        if (vertex_array == id) {
+            vertex_array = 0;
+            buffers[buffer_slot(GL_ELEMENT_ARRAY_BUFFER)] = unknown;
+        }
+        glDeleteVertexArrays(1, &id);
+    }
+
+    void GLStateCache::delete_texture(unsigned int texture) {
+        for (auto &bound : textures)
+            if (bound == texture)
+                bound = 0;
+        glDeleteTextures(1, &texture);
+    }
+
+    void GLStateCache::invalidate() {
+        program = unknown;
+        vertex_array = unknown;
+        buffers.fill(unknown);
+        uniform_buffers.fill(BufferRange{unknown, 0, 0});
+        active_unit = unknown;
+        textures.fill(unknown);
+        depth_test = depth_write = blend = Toggle::unknown;
+        blend_source = blend_destination = unknown;
+    }
+}
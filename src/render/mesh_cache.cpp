@@ -0,0 +1,236 @@
+#include "render/mesh_cache.h"
+#include "render/cooked_file.h"
+#include "common/mapped_file.h"
+#include "common/trace.h"
+
+#include <cstring>
+
+namespace fs = std::filesystem;
+
+namespace render {
+    namespace {
+        constexpr char magic[4] = {'H', 'S', 'M', 'C'};
+        constexpr uint32_t format_version = 4;
+        constexpr uint64_t blob_alignment = 4096;
+        constexpr uint32_t known_vertex_flags = VertexFormat::quantized_positions | VertexFormat::packed_normals |
+                                                VertexFormat::half_tex_coords;
+
+        struct StatsRecord {
+            uint64_t vertices_count;
+            uint64_t indices_count;
+            uint64_t bytes;
+            float acmr;
+            uint32_t padding;
+        };
+
+        struct Header {
+            char magic[4];
+            uint32_t version;
+            uint64_t source_key;
+            VertexQuantization quantization; // cooked with
+            uint32_t meshes_count;
+            uint32_t textures_count;
+            uint32_t padding;
+            uint64_t strings_offset;
+            uint64_t strings_size;
+            uint64_t vertices_offset;
+            uint64_t vertices_size; // bytes
+            uint64_t indices_offset;
+            uint64_t indices_size; // bytes
+            StatsRecord before_optimization;
+            StatsRecord after_optimization;
+        };
+
+        struct MeshRange {
+            uint64_t vertices_offset; // bytes in the vertices blob
+            uint64_t vertices_count;
+            uint64_t indices_offset; // bytes in the indices blob
+            uint64_t indices_count;
+            uint32_t vertex_flags; // VertexFormat::flags
+            uint32_t index_size;
+            float position_offset[3];
+            float position_scale;
+            uint32_t first_texture;
+            uint32_t textures_count;
+            float bounds_min[3];
+            float bounds_max[3];
+            float sphere[4]; // center, radius
+        };
+
+        struct TextureRecord {
+            uint32_t type;
+            uint32_t path_offset; // in strings
+            uint32_t path_size;
+            uint32_t padding;
+        };
+    }
+
+    static uint64_t align_up(uint64_t value, uint64_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    static StatsRecord to_record(const MeshStats &stats) {
+        return StatsRecord{stats.vertices_count, stats.indices_count, stats.bytes, stats.acmr, 0};
+    }
+
+    static MeshStats from_record(const StatsRecord &record) {
+        return MeshStats{record.vertices_count, record.indices_count, record.bytes, record.acmr};
+    }
+
+    MeshCache::MeshCache(fs::path directory) : dir(std::move(directory)) {}
+
+    std::optional<ModelData> MeshCache::load(const fs::path &source, const VertexQuantization &quantization) const {
+        HS_ZONE("render::MeshCache::load");
+        auto key = source_key(source);
+        if (!key)
+            return std::nullopt;
+
+        auto file = MappedFile::open(cooked_path(dir, *key, ".hsmesh"));
+        if (!file)
+            return std::nullopt;
+
+        const std::byte *base = file->data();
+        const uint64_t file_size = file->size();
+        auto in_file = [&](uint64_t offset, uint64_t count, uint64_t elem_size) {
+            return offset <= file_size && count <= (file_size - offset) / elem_size;
+        };
+
+        Header header;
+        if (!in_file(0, 1, sizeof(Header)))
+            return std::nullopt;
+        std::memcpy(&header, base, sizeof(Header));
+        if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != format_version ||
+            header.source_key != *key || header.quantization != quantization)
+            return std::nullopt;
+
+        uint64_t ranges_offset = sizeof(Header);
+        uint64_t textures_offset = ranges_offset + (uint64_t) header.meshes_count * sizeof(MeshRange);
+        if (!in_file(ranges_offset, header.meshes_count, sizeof(MeshRange)) ||
+            !in_file(textures_offset, header.textures_count, sizeof(TextureRecord)) ||
+            !in_file(header.strings_offset, header.strings_size, 1) ||
+            !in_file(header.vertices_offset, header.vertices_size, 1) ||
+            !in_file(header.indices_offset, header.indices_size, 1))
+            return std::nullopt;
+
+        const std::byte *vertices = base + header.vertices_offset;
+        const std::byte *indices = base + header.indices_offset;
+        auto strings = reinterpret_cast<const char *>(base + header.strings_offset);
+
+        ModelData model;
+        model.meshes.resize(header.meshes_count);
+        for (uint32_t i = 0; i < header.meshes_count; ++i) {
+            MeshRange range;
+            std::memcpy(&range, base + ranges_offset + i * sizeof(MeshRange), sizeof(MeshRange));
+            VertexFormat format{range.vertex_flags};
+            if ((range.vertex_flags & ~known_vertex_flags) != 0 ||
+                range.vertices_offset % 4 != 0 || range.vertices_offset > header.vertices_size ||
+                range.vertices_count > (header.vertices_size - range.vertices_offset) / format.stride() ||
+                (range.index_size != sizeof(uint16_t) && range.index_size != sizeof(uint32_t)) ||
+                range.indices_offset % range.index_size != 0 || range.indices_offset > header.indices_size ||
+                range.indices_count > (header.indices_size - range.indices_offset) / range.index_size ||
+                range.first_texture > header.textures_count ||
+                range.textures_count > header.textures_count - range.first_texture)
+                return std::nullopt;
+
+            MeshData &mesh = model.meshes[i];
+            mesh.vertices = {vertices + range.vertices_offset, range.vertices_count * format.stride()};
+            mesh.vertex_format = format;
+            mesh.dequantization.offset = glm::vec3(range.position_offset[0], range.position_offset[1],
+                                                   range.position_offset[2]);
+            mesh.dequantization.scale = range.position_scale;
+            mesh.indices = {indices + range.indices_offset, range.indices_count * range.index_size};
+            mesh.index_size = range.index_size;
+            mesh.bounds.min = glm::vec3(range.bounds_min[0], range.bounds_min[1], range.bounds_min[2]);
+            mesh.bounds.max = glm::vec3(range.bounds_max[0], range.bounds_max[1], range.bounds_max[2]);
+            mesh.bounds.center = glm::vec3(range.sphere[0], range.sphere[1], range.sphere[2]);
+            mesh.bounds.radius = range.sphere[3];
+            for (uint32_t t = range.first_texture; t < range.first_texture + range.textures_count; ++t) {
+                TextureRecord record;
+                std::memcpy(&record, base + textures_offset + t * sizeof(TextureRecord), sizeof(TextureRecord));
+                if ((uint64_t) record.path_offset + record.path_size > header.strings_size)
+                    return std::nullopt;
+                mesh.textures.push_back(TextureRef{
+                        .path = std::string(strings + record.path_offset, record.path_size),
+                        .type = (Texture2d::Type) record.type
+                });
+            }
+        }
+
+        model.optimization.before = from_record(header.before_optimization);
+        model.optimization.after = from_record(header.after_optimization);
+        model.storage = std::make_shared<MappedFile>(std::move(*file));
+        return model;
+    }
+
+    tl::expected<void, std::string> MeshCache::store(const fs::path &source, const VertexQuantization &quantization,
+                                                     const ModelData &model) const {
+        HS_ZONE("render::MeshCache::store");
+        auto key = source_key(source);
+        if (!key)
+            return tl::make_unexpected("Failed to stat " + source.string());
+
+        Header header{};
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = format_version;
+        header.source_key = *key;
+        header.quantization = quantization;
+        header.meshes_count = (uint32_t) model.meshes.size();
+        header.before_optimization = to_record(model.optimization.before);
+        header.after_optimization = to_record(model.optimization.after);
+
+        std::vector<MeshRange> ranges;
+        std::vector<TextureRecord> textures;
+        std::string strings;
+        ranges.reserve(model.meshes.size());
+        for (const auto &mesh : model.meshes) {
+            const glm::vec3 &offset = mesh.dequantization.offset;
+            const Bounds &bounds = mesh.bounds;
+            ranges.push_back(MeshRange{
+                    .vertices_offset = header.vertices_size, // strides are multiples of 4
+                    .vertices_count = mesh.vertices_count(),
+                    .indices_offset = align_up(header.indices_size, sizeof(uint32_t)),
+                    .indices_count = mesh.indices_count(),
+                    .vertex_flags = mesh.vertex_format.flags,
+                    .index_size = mesh.index_size,
+                    .position_offset = {offset.x, offset.y, offset.z},
+                    .position_scale = mesh.dequantization.scale,
+                    .first_texture = (uint32_t) textures.size(),
+                    .textures_count = (uint32_t) mesh.textures.size(),
+                    .bounds_min = {bounds.min.x, bounds.min.y, bounds.min.z},
+                    .bounds_max = {bounds.max.x, bounds.max.y, bounds.max.z},
+                    .sphere = {bounds.center.x, bounds.center.y, bounds.center.z, bounds.radius}
+            });
+            header.vertices_size += mesh.vertices.size();
+            header.indices_size = ranges.back().indices_offset + mesh.indices.size();
+
+            for (const auto &texture : mesh.textures) {
+                textures.push_back(TextureRecord{
+                        .type = (uint32_t) texture.type,
+                        .path_offset = (uint32_t) strings.size(),
+                        .path_size = (uint32_t) texture.path.size()
+                });
+                strings += texture.path;
+            }
+        }
+        header.textures_count = (uint32_t) textures.size();
+        header.strings_offset = sizeof(Header) + ranges.size() * sizeof(MeshRange) +
+                                textures.size() * sizeof(TextureRecord);
+        header.strings_size = strings.size();
+        header.vertices_offset = align_up(header.strings_offset + header.strings_size, blob_alignment);
+        header.indices_offset = align_up(header.vertices_offset + header.vertices_size, blob_alignment);
+
+        CookedFileWriter writer(cooked_path(dir, *key, ".hsmesh"));
+        writer.write(&header, sizeof(header));
+        writer.write(ranges.data(), ranges.size() * sizeof(MeshRange));
+        writer.write(textures.data(), textures.size() * sizeof(TextureRecord));
+        writer.write(strings.data(), strings.size());
+        writer.pad_to(header.vertices_offset);
+        for (const auto &mesh : model.meshes)
+            writer.write(mesh.vertices.data(), mesh.vertices.size());
+        for (std::size_t i = 0; i < model.meshes.size(); ++i) {
+            writer.pad_to(header.indices_offset + ranges[i].indices_offset);
+            writer.write(model.meshes[i].indices.data(), model.meshes[i].indices.size());
+        }
+        return writer.commit();
+    }
+}
@@ -0,0 +1,281 @@
+#include "render/mesh_optimizer.h"
+#include "common/trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+#include <glm/geometric.hpp>
+
+namespace render {
+    void MeshOptimizationReport::add(const MeshOptimizationReport &other) {
+        auto add_stats = [](MeshStats &to, const MeshStats &from) {
+            std::size_t triangles = to.indices_count / 3 + from.indices_count / 3;
+            if (triangles > 0)
+                to.acmr = (to.acmr * (to.indices_count / 3) + from.acmr * (from.indices_count / 3)) / triangles;
+            to.vertices_count += from.vertices_count;
+            to.indices_count += from.indices_count;
+            to.bytes += from.bytes;
+        };
+        add_stats(before, other.before);
+        add_stats(after, other.after);
+    }
+
+    void deduplicate_vertices(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices) {
+        HS_ZONE("render::deduplicate_vertices");
+        struct VertexHash {
+            std::size_t operator()(const Vertex &v) const {
+                // FNV-1a over the bytes, Vertex has no padding
+                uint64_t hash = 0xcbf29ce484222325ull;
+                auto bytes = reinterpret_cast<const unsigned char *>(&v);
+                for (std::size_t i = 0; i < sizeof(Vertex); ++i)
+                    hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+                return hash;
+            }
+        };
+        struct VertexEqual {
+            bool operator()(const Vertex &a, const Vertex &b) const {
+                return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+            }
+        };
+
+        std::unordered_map<Vertex, unsigned int, VertexHash, VertexEqual> unique;
+        unique.reserve(vertices.size());
+        std::vector<unsigned int> remap(vertices.size());
+        std::size_t unique_count = 0;
+        for (std::size_t i = 0; i < vertices.size(); ++i) {
+            auto [it, inserted] = unique.try_emplace(vertices[i], (unsigned int) unique_count);
+            if (inserted)
+                vertices[unique_count++] = vertices[i];
+            remap[i] = it->second;
+        }
+        vertices.resize(unique_count);
+
+        for (auto &index : indices)
+            index = remap[index];
+    }
+
+    void optimize_vertex_cache(std::span<unsigned int> indices, std::size_t vertices_count, uint32_t cache_size) {
+        HS_ZONE("render::optimize_vertex_cache");
+        std::size_t triangles_count = indices.size() / 3;
+        if (triangles_count == 0)
+            return;
+
+        // Triangles adjacent to each vertex
+        std::vector<uint32_t> live(vertices_count, 0);
+        for (unsigned int index : indices)
+            ++live[index];
+        std::vector<uint32_t> offsets(vertices_count + 1, 0);
+        std::partial_sum(live.begin(), live.end(), offsets.begin() + 1);
+        std::vector<uint32_t> adjacency(indices.size());
+        {
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (std::size_t i = 0; i < indices.size(); ++i)
+                adjacency[fill[indices[i]]++] = (uint32_t) (i / 3);
+        }
+
+        std::vector<uint32_t> cache_time(vertices_count, 0);
+        std::vector<bool> emitted(triangles_count, false);
+        std::vector<unsigned int> dead_end;
+        std::vector<unsigned int> candidates;
+        std::vector<unsigned int> result;
+        result.reserve(indices.size());
+        uint32_t time = cache_size + 1;
+        std::size_t cursor = 0;
+
+        auto skip_dead_end = [&]() -> int64_t {
+            while (!dead_end.empty()) {
+                unsigned int v = dead_end.back();
+                dead_end.pop_back();
+                if (live[v] > 0)
+                    return v;
+            }
+            for (; cursor < vertices_count; ++cursor)
+                if (live[cursor] > 0)
+                    return (int64_t) cursor;
+            return -1;
+        };
+
+        int64_t fan = skip_dead_end();
+        while (fan >= 0) {
+            candidates.clear();
+            for (uint32_t a = offsets[fan]; a < offsets[fan + 1]; ++a) {
+                uint32_t t = adjacency[a];
+                if (emitted[t])
+                    continue;
+                emitted[t] = true;
+                for (int k = 0; k < 3; ++k) {
+                    unsigned int v = indices[t * 3 + k];
+                    result.push_back(v);
+                    dead_end.push_back(v);
+                    candidates.push_back(v);
+                    --live[v];
+                    if (time - cache_time[v] > cache_size)
+                        cache_time[v] = time++;
+                }
+            }
+
+            // Prefer the oldest vertex which is still in cache once its remaining triangles are emitted
+            int64_t best = -1;
+            int64_t best_priority = -1;
+            for (unsigned int v : candidates) {
+                if (live[v] == 0)
+                    continue;
+                int64_t priority = 0;
+                if (time - cache_time[v] + 2 * live[v] <= cache_size)
+                    priority = time - cache_time[v];
+                if (priority > best_priority) {
+                    best_priority = priority;
+                    best = v;
+                }
+            }
+            fan = best >= 0 ? best : skip_dead_end();
+        }
+
+        std::copy(result.begin(), result.end(), indices.begin());
+    }
+
+    void optimize_overdraw(std::span<unsigned int> indices, std::span<const Vertex> vertices, uint32_t cache_size) {
+        HS_ZONE("render::optimize_overdraw");
+        std::size_t triangles_count = indices.size() / 3;
+        if (triangles_count == 0)
+            return;
+
+        // Clusters start where all the vertices of a triangle miss the cache,
+        // so moving them around costs nothing but their first triangle
+        constexpr std::size_t min_cluster_size = 32;
+        std::vector<std::size_t> cluster_starts{0};
+        std::vector<uint32_t> cache_time(vertices.size(), 0);
+        uint32_t time = cache_size + 1;
+        for (std::size_t t = 0; t < triangles_count; ++t) {
+            int misses = 0;
+            for (int k = 0; k < 3; ++k) {
+                unsigned int v = indices[t * 3 + k];
+                if (time - cache_time[v] > cache_size) {
+                    cache_time[v] = time++;
+                    ++misses;
+                }
+            }
+            if (misses == 3 && t - cluster_starts.back() >= min_cluster_size)
+                cluster_starts.push_back(t);
+        }
+        if (cluster_starts.size() == 1)
+            return;
+        cluster_starts.push_back(triangles_count);
+
+        glm::vec3 mesh_center(0.0f);
+        for (const auto &vertex : vertices)
+            mesh_center += vertex.position / (float) vertices.size();
+
+        struct Cluster {
+            std::size_t begin, end;
+            float sort_key;
+        };
+        std::vector<Cluster> clusters;
+        for (std::size_t c = 0; c + 1 < cluster_starts.size(); ++c) {
+            glm::vec3 center(0.0f), normal(0.0f);
+            float area = 0.0f;
+            for (std::size_t t = cluster_starts[c]; t < cluster_starts[c + 1]; ++t) {
+                const glm::vec3 &p0 = vertices[indices[t * 3]].position;
+                const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].position;
+                const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].position;
+                glm::vec3 n = glm::cross(p1 - p0, p2 - p0); // length is twice the area
+                float a = glm::length(n);
+                center += (p0 + p1 + p2) / 3.0f * a;
+                normal += n;
+                area += a;
+            }
+            if (area > 0.0f)
+                center /= area;
+            float normal_len = glm::length(normal);
+            float key = normal_len > 0.0f ? glm::dot(center - mesh_center, normal / normal_len) : 0.0f;
+            clusters.push_back(Cluster{cluster_starts[c], cluster_starts[c + 1], key});
+        }
+
+        // Outermost clusters occlude the rest, draw them first
+        std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster &a, const Cluster &b) {
+            return a.sort_key > b.sort_key;
+        });
+
+        std::vector<unsigned int> result;
+        result.reserve(indices.size());
+        for (const auto &cluster : clusters)
+            result.insert(result.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+        std::copy(result.begin(), result.end(), indices.begin());
+    }
+
+    void optimize_vertex_fetch(std::vector<Vertex> &vertices, std::span<unsigned int> indices) {
+        HS_ZONE("render::optimize_vertex_fetch");
+        constexpr unsigned int unused = UINT32_MAX;
+        std::vector<unsigned int> remap(vertices.size(), unused);
+        std::vector<Vertex> result;
+        result.reserve(vertices.size());
+        for (auto &index : indices) {
+            if (remap[index] == unused) {
+                remap[index] = (unsigned int) result.size();
+                result.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+        vertices = std::move(result);
+    }
+
+    float average_cache_miss_ratio(std::span<const unsigned int> indices, std::size_t vertices_count,
+                                   uint32_t cache_size) {
+        if (indices.size() < 3)
+            return 0.0f;
+
+        // FIFO cache: a vertex is cached while less than cache_size misses happened after its own
+        std::vector<uint32_t> cache_time(vertices_count, 0);
+        uint32_t time = cache_size + 1;
+        std::size_t misses = 0;
+        for (unsigned int index : indices) {
+            if (time - cache_time[index] > cache_size) {
+                cache_time[index] = time++;
+                ++misses;
+            }
+        }
+        return (float) misses / (float) (indices.size() / 3);
+    }
+
+    uint32_t index_size(std::size_t vertices_count) {
+        return vertices_count <= UINT16_MAX + 1 ? sizeof(uint16_t) : sizeof(uint32_t);
+    }
+
+    std::vector<std::byte> pack_indices(std::span<const unsigned int> indices, uint32_t index_size) {
+        std::vector<std::byte> result(indices.size() * index_size);
+        if (index_size == sizeof(uint16_t)) {
+            for (std::size_t i = 0; i < indices.size(); ++i) {
+                auto index = (uint16_t) indices[i];
+                std::memcpy(result.data() + i * sizeof(uint16_t), &index, sizeof(uint16_t));
+            }
+        } else {
+            std::memcpy(result.data(), indices.data(), indices.size_bytes());
+        }
+        return result;
+    }
+
+    MeshOptimizationReport optimize_mesh(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices) {
+        HS_ZONE("render::optimize_mesh");
+        auto stats = [&](uint32_t bytes_per_index) {
+            return MeshStats{
+                    .vertices_count = vertices.size(),
+                    .indices_count = indices.size(),
+                    .bytes = vertices.size() * sizeof(Vertex) + indices.size() * bytes_per_index,
+                    .acmr = average_cache_miss_ratio(indices, vertices.size())
+            };
+        };
+
+        MeshOptimizationReport report;
+        report.before = stats(sizeof(unsigned int));
+
+        deduplicate_vertices(vertices, indices);
+        optimize_vertex_cache(indices, vertices.size());
+        optimize_overdraw(indices, vertices);
+        optimize_vertex_fetch(vertices, indices);
+
+        report.after = stats(index_size(vertices.size()));
+        return report;
+    }
+}
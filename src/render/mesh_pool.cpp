@@ -0,0 +1,337 @@
+#include "render/mesh_pool.h"
+#include "common/range_allocator.h"
+#include "common/slot_map.h"
+#include "common/trace.h"
+
+#include <algorithm>
+#include <optional>
+#include <vector>
+
+#include <glad/glad.h>
+
+namespace render {
+    static constexpr uint64_t initial_vertices_capacity = 65536;
+    static constexpr uint64_t initial_indices_capacity = 1 << 20; // bytes
+    static constexpr float defragment_threshold = 0.5f;
+
+    static void setup_vertex_attributes(const VertexFormat &format) {
+        // vertex positions, quantized ones are converted to floats as is and dequantized by the model matrix
+        glEnableVertexAttribArray(0);
+        if (format.flags & VertexFormat::quantized_positions)
+            glVertexAttribPointer(0, 3, GL_SHORT, GL_FALSE, format.stride(), (void *) 0);
+        else
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, format.stride(), (void *) 0);
+        // vertex normals
+        glEnableVertexAttribArray(1);
+        if (format.flags & VertexFormat::packed_normals)
+            glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, format.stride(),
+                                  (void *) (uintptr_t) format.normal_offset());
+        else
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, format.stride(), (void *) (uintptr_t) format.normal_offset());
+        // vertex texture coords
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, format.flags & VertexFormat::half_tex_coords ? GL_HALF_FLOAT : GL_FLOAT, GL_FALSE,
+                              format.stride(), (void *) (uintptr_t) format.tex_coords_offset());
+    }
+
+    static unsigned int create_buffer(GLStateCache &gl_state, uint64_t bytes) {
+        unsigned int buffer;
+        glGenBuffers(1, &buffer);
+        gl_state.bind_buffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr) bytes, nullptr, GL_STATIC_DRAW);
+        return buffer;
+    }
+
+    static void copy_buffer(GLStateCache &gl_state, unsigned int from, unsigned int to, uint64_t from_offset,
+                            uint64_t to_offset, uint64_t bytes) {
+        gl_state.bind_buffer(GL_COPY_READ_BUFFER, from);
+        gl_state.bind_buffer(GL_COPY_WRITE_BUFFER, to);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr) from_offset, (GLintptr) to_offset,
+                            (GLsizeiptr) bytes);
+    }
+
+    // Empty meshes take no space and sit at offset zero
+    static std::optional<uint64_t> allocate(RangeAllocator &allocator, uint64_t size, uint64_t alignment = 1) {
+        if (size == 0)
+            return 0;
+        return allocator.allocate(size, alignment);
+    }
+
+    class MeshPool::Impl {
+    public:
+        explicit Impl(GLStateCache &gl_state) : gl_state(gl_state) {}
+
+        ~Impl() {
+            for (auto &arena : arenas) {
+                gl_state.delete_vertex_array(arena.VAO);
+                gl_state.delete_buffer(arena.VBO);
+                gl_state.delete_buffer(arena.EBO);
+            }
+        }
+
+        Handle<PooledMesh> add(const MeshData &data) {
+            HS_ZONE("render::MeshPool::add");
+            uint32_t arena_index = find_arena(data.vertex_format);
+            Arena &arena = arenas[arena_index];
+            const uint32_t stride = data.vertex_format.stride();
+            const uint64_t vertices_count = data.vertices_count();
+
+            auto first_vertex = allocate(arena.vertices, vertices_count);
+            if (!first_vertex) {
+                resize_vertices(arena, std::max(arena.vertices.size() * 2, arena.vertices.size() + vertices_count));
+                first_vertex = allocate(arena.vertices, vertices_count);
+            }
+            auto index_offset = allocate(arena.indices, data.indices.size(), data.index_size);
+            if (!index_offset) {
+                // The tail is padded so that the new range stays aligned
+                resize_indices(arena, std::max(arena.indices.size() * 2,
+                                               arena.indices.size() + data.indices.size() + data.index_size));
+                index_offset = allocate(arena.indices, data.indices.size(), data.index_size);
+            }
+
+            // Uploads go through the copy targets to leave bindings of VAOs intact
+            gl_state.bind_buffer(GL_COPY_WRITE_BUFFER, arena.VBO);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr) (*first_vertex * stride), (GLsizeiptr) data.vertices.size(),
+                            data.vertices.data());
+            gl_state.bind_buffer(GL_COPY_WRITE_BUFFER, arena.EBO);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr) *index_offset, (GLsizeiptr) data.indices.size(),
+                            data.indices.data());
+
+            return meshes.insert(PooledMesh{
+                    .arena = arena_index,
+                    .base_vertex = (int32_t) *first_vertex,
+                    .vertices_count = (uint32_t) vertices_count,
+                    .indices_count = (uint32_t) data.indices_count(),
+                    .index_offset = *index_offset,
+                    .index_type = (unsigned int) (data.index_size == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT)
+            });
+        }
+
+        bool remove(Handle<PooledMesh> handle) {
+            auto mesh = meshes.erase(handle);
+            if (!mesh)
+                return false;
+
+            Arena &arena = arenas[mesh->arena];
+            arena.vertices.free((uint64_t) mesh->base_vertex, mesh->vertices_count);
+            arena.indices.free(mesh->index_offset, indices_bytes(*mesh));
+            if (is_fragmented(arena))
+                compact(mesh->arena);
+            return true;
+        }
+
+        const PooledMesh *get(Handle<PooledMesh> handle) const {
+            return meshes.get(handle);
+        }
+
+        std::optional<MeshData> read(Handle<PooledMesh> handle, std::vector<std::byte> &storage) const {
+            HS_ZONE("render::MeshPool::read");
+            const PooledMesh *mesh = meshes.get(handle);
+            if (!mesh)
+                return std::nullopt;
+
+            const Arena &arena = arenas[mesh->arena];
+            const uint64_t vertex_bytes = (uint64_t) mesh->vertices_count * arena.format.stride();
+            const uint64_t index_bytes = indices_bytes(*mesh);
+            storage.resize(vertex_bytes + index_bytes);
+            gl_state.bind_buffer(GL_COPY_READ_BUFFER, arena.VBO);
+            glGetBufferSubData(GL_COPY_READ_BUFFER, (GLintptr) ((uint64_t) mesh->base_vertex * arena.format.stride()),
+                               (GLsizeiptr) vertex_bytes, storage.data());
+            gl_state.bind_buffer(GL_COPY_READ_BUFFER, arena.EBO);
+            glGetBufferSubData(GL_COPY_READ_BUFFER, (GLintptr) mesh->index_offset, (GLsizeiptr) index_bytes,
+                               storage.data() + vertex_bytes);
+
+            MeshData data;
+            data.vertices = {storage.data(), vertex_bytes};
+            data.vertex_format = arena.format;
+            data.indices = {storage.data() + vertex_bytes, index_bytes};
+            data.index_size = (uint32_t) index_size(*mesh);
+            return data;
+        }
+
+        unsigned int vertex_array(uint32_t arena) const {
+            return arenas[arena].VAO;
+        }
+
+        void defragment() {
+            for (uint32_t i = 0; i < arenas.size(); ++i)
+                if (arenas[i].vertices.fragmentation() > 0.0f || arenas[i].indices.fragmentation() > 0.0f)
+                    compact(i);
+        }
+
+        MeshPoolStats stats() const {
+            MeshPoolStats result;
+            result.arenas = arenas.size();
+            result.meshes = meshes.size();
+            for (const auto &arena : arenas) {
+                const uint32_t stride = arena.format.stride();
+                result.vertex_bytes += arena.vertices.used() * stride;
+                result.vertex_capacity += arena.vertices.size() * stride;
+                result.index_bytes += arena.indices.used();
+                result.index_capacity += arena.indices.size();
+            }
+            return result;
+        }
+
+    private:
+        struct Arena {
+            VertexFormat format;
+            unsigned int VAO, VBO, EBO;
+            RangeAllocator vertices; // in vertices
+            RangeAllocator indices; // in bytes
+        };
+
+        GLStateCache &gl_state;
+        std::vector<Arena> arenas;
+        SlotMap<PooledMesh> meshes;
+
+        static uint64_t index_size(const PooledMesh &mesh) {
+            return mesh.index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+        }
+
+        static uint64_t indices_bytes(const PooledMesh &mesh) {
+            return mesh.indices_count * index_size(mesh);
+        }
+
+        static bool is_fragmented(const Arena &arena) {
+            return arena.vertices.fragmentation() > defragment_threshold ||
+                   arena.indices.fragmentation() > defragment_threshold;
+        }
+
+        uint32_t find_arena(const VertexFormat &format) {
+            for (uint32_t i = 0; i < arenas.size(); ++i)
+                if (arenas[i].format == format)
+                    return i;
+
+            Arena arena{
+                    .format = format,
+                    .VBO = create_buffer(gl_state, initial_vertices_capacity * format.stride()),
+                    .EBO = create_buffer(gl_state, initial_indices_capacity),
+                    .vertices = RangeAllocator(initial_vertices_capacity),
+                    .indices = RangeAllocator(initial_indices_capacity)
+            };
+            glGenVertexArrays(1, &arena.VAO);
+            bind_buffers(arena);
+            arenas.push_back(std::move(arena));
+            return (uint32_t) arenas.size() - 1;
+        }
+
+        void bind_buffers(const Arena &arena) {
+            gl_state.bind_vertex_array(arena.VAO);
+            gl_state.bind_buffer(GL_ARRAY_BUFFER, arena.VBO);
+            setup_vertex_attributes(arena.format);
+            gl_state.bind_buffer(GL_ELEMENT_ARRAY_BUFFER, arena.EBO);
+        }
+
+        void resize_vertices(Arena &arena, uint64_t capacity) {
+            HS_ZONE("render::MeshPool::resize_vertices");
+            const uint32_t stride = arena.format.stride();
+            unsigned int buffer = create_buffer(gl_state, capacity * stride);
+            copy_buffer(gl_state, arena.VBO, buffer, 0, 0, arena.vertices.size() * stride);
+            gl_state.delete_buffer(arena.VBO);
+            arena.VBO = buffer;
+            arena.vertices.grow(capacity);
+            bind_buffers(arena);
+        }
+
+        void resize_indices(Arena &arena, uint64_t capacity) {
+            HS_ZONE("render::MeshPool::resize_indices");
+            unsigned int buffer = create_buffer(gl_state, capacity);
+            copy_buffer(gl_state, arena.EBO, buffer, 0, 0, arena.indices.size());
+            gl_state.delete_buffer(arena.EBO);
+            arena.EBO = buffer;
+            arena.indices.grow(capacity);
+            bind_buffers(arena);
+        }
+
+        /**
+         * Packs live meshes of the arena to the beginning of new buffers of the same size.
+         */
+        void compact(uint32_t arena_index) {
+            HS_ZONE("render::MeshPool::compact");
+            Arena &arena = arenas[arena_index];
+            const uint32_t stride = arena.format.stride();
+
+            std::vector<PooledMesh *> live;
+            for (auto &mesh : meshes)
+                if (mesh.arena == arena_index)
+                    live.push_back(&mesh);
+
+            // Ranges are packed in the order of their old offsets, so each one moves towards the beginning:
+            // its aligned old offset is past the end of the previous packed range, so allocation succeeds
+            RangeAllocator vertices(arena.vertices.size());
+            unsigned int VBO = create_buffer(gl_state, vertices.size() * stride);
+            std::sort(live.begin(), live.end(), [](const PooledMesh *a, const PooledMesh *b) {
+                return a->base_vertex < b->base_vertex;
+            });
+            for (PooledMesh *mesh : live) {
+                uint64_t first_vertex = *allocate(vertices, mesh->vertices_count);
+                copy_buffer(gl_state, arena.VBO, VBO, (uint64_t) mesh->base_vertex * stride, first_vertex * stride,
+                            (uint64_t) mesh->vertices_count * stride);
+                mesh->base_vertex = (int32_t) first_vertex;
+            }
+
+            RangeAllocator indices(arena.indices.size());
+            unsigned int EBO = create_buffer(gl_state, indices.size());
+            std::sort(live.begin(), live.end(), [](const PooledMesh *a, const PooledMesh *b) {
+                return a->index_offset < b->index_offset;
+            });
+            for (PooledMesh *mesh : live) {
+                const uint64_t index_bytes = indices_bytes(*mesh);
+                uint64_t index_offset = *allocate(indices, index_bytes, index_size(*mesh));
+                copy_buffer(gl_state, arena.EBO, EBO, mesh->index_offset, index_offset, index_bytes);
+                mesh->index_offset = index_offset;
+            }
+
+            gl_state.delete_buffer(arena.VBO);
+            gl_state.delete_buffer(arena.EBO);
+            arena.VBO = VBO;
+            arena.EBO = EBO;
+            arena.vertices = std::move(vertices);
+            arena.indices = std::move(indices);
+            bind_buffers(arena);
+        }
+    };
+
+    MeshPool::MeshPool(GLStateCache &gl_state) {
+        impl = new Impl(gl_state);
+    }
+
+    MeshPool::~MeshPool() {
+        delete impl;
+    }
+
+    Handle<PooledMesh> MeshPool::add(const MeshData &data) {
+        return impl->add(data);
+    }
+
+    bool MeshPool::remove(Handle<PooledMesh> handle) {
+        return impl->remove(handle);
+    }
+
+    const PooledMesh *MeshPool::get(Handle<PooledMesh> handle) const {
+        return impl->get(handle);
+    }
+
+    std::optional<MeshData> MeshPool::read(Handle<PooledMesh> handle, std::vector<std::byte> &storage) const {
+        return impl->read(handle, storage);
+    }
+
+    unsigned int MeshPool::vertex_array(uint32_t arena) const {
+        return impl->vertex_array(arena);
+    }
+
+    void MeshPool::draw(const PooledMesh &mesh, uint32_t instances_count) const {
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei) mesh.indices_count, mesh.index_type,
+                                          (void *) (uintptr_t) mesh.index_offset, (GLsizei) instances_count,
+                                          mesh.base_vertex);
+    }
+
+    void MeshPool::defragment() {
+        impl->defragment();
+    }
+
+    MeshPoolStats MeshPool::stats() const {
+        return impl->stats();
+    }
+}
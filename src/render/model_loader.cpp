@@ -1,6 +1,14 @@
 #include "render/model_loader.h"
+#include "render/cooked_file.h"
+#include "common/trace.h"
 #include "iostream"
 
+#include <cmath>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <unordered_set>
+
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
@@ -11,106 +19,308 @@
 namespace fs = std::filesystem;
 
 namespace render {
-    static void setup_mesh(Mesh *mesh) {
-        glGenVertexArrays(1, &mesh->VAO);
-        glGenBuffers(1, &mesh->VBO);
-        glGenBuffers(1, &mesh->EBO);
-
-        glBindVertexArray(mesh->VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, mesh->VBO);
-
-        glBufferData(GL_ARRAY_BUFFER, mesh->vertices.size() * sizeof(Vertex), &mesh->vertices[0], GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh->indices.size() * sizeof(unsigned int),
-                     &mesh->indices[0], GL_STATIC_DRAW);
-
-        // vertex positions
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *) offsetof(Vertex, position));
-        // vertex normals
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *) offsetof(Vertex, normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *) offsetof(Vertex, tex_coords));
-
-        glBindVertexArray(0);
-    }
-
     class ModelLoader::Impl {
     public:
-        explicit Impl(TextureLoader &texture_loader)
-                : texture_loader(texture_loader) {}
+        Impl(TextureLoader &texture_loader, MeshPool &mesh_pool, ecs::Jobs &jobs)
+                : texture_loader(texture_loader), mesh_pool(mesh_pool), jobs(jobs) {
+            set_cache_directory(default_cache_directory());
+        }
 
         ~Impl() {
-            foreach(handle_manager, [](Model *model) {
+            jobs.wait(pending_jobs);
+            models.foreach([this](Handle<Model>, Model &model) {
                 unload_model_raw(model);
             });
         }
 
         tl::expected<Handle<Model>, std::string> load_model(const fs::path &path) {
-            Assimp::Importer import;
-            const aiScene *scene = import.ReadFile(path, aiProcess_Triangulate);
+            HS_ZONE("render::ModelLoader::load_model");
+            auto handle = models.create();
+            if (!models.is_valid(handle))
+                return tl::make_unexpected<std::string>("Too many models loaded");
+
+            auto data = read_model(path, false);
+            if (!data) {
+                std::lock_guard lock(mutex);
+                models.erase(handle);
+                return tl::make_unexpected(data.error());
+            }
 
-            if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
-                return tl::make_unexpected(import.GetErrorString());
+            Model model = create_model(*data, path.parent_path(), false);
+            upload_meshes(model, std::move(*data));
+            models.set_ready(handle, std::move(model));
+            return handle;
+        }
+
+        Handle<Model> load_model_async(const fs::path &path) {
+            auto handle = models.create();
+            if (!models.is_valid(handle))
+                return handle;
+
+            jobs.spawn_background(pending_jobs, [this, handle, path] {
+                HS_ZONE("render::ModelLoader::load_model_async");
+                auto data = read_model(path, true);
+                Model model;
+                if (data)
+                    model = create_model(*data, path.parent_path(), true);
+
+                std::lock_guard lock(mutex);
+                if (data) {
+                    parsed.push_back(ParsedModel{handle, std::move(*data), std::move(model)});
+                } else {
+                    models.set_failed(handle);
+                    unload_textures_of.erase(handle.raw);
+                }
+            });
+            return handle;
+        }
+
+        void upload_pending(UploadScope &scope) {
+            while (!scope.exhausted()) {
+                ParsedModel item;
+                {
+                    std::lock_guard lock(mutex);
+                    if (parsed.empty())
+                        return;
+                    item = std::move(parsed.front());
+                    parsed.pop_front();
+                }
+
+                // The model might have been unloaded while parsing
+                if (models.state(item.handle) != ResourceState::loading) {
+                    std::lock_guard lock(mutex);
+                    if (unload_textures_of.erase(item.handle.raw))
+                        unload_textures(item.model);
+                    continue;
+                }
+
+                std::size_t bytes = upload_meshes(item.model, std::move(item.data));
+                models.set_ready(item.handle, std::move(item.model));
+                scope.spend(bytes);
+            }
+        }
+
+        void set_cache_directory(const fs::path &directory) {
+            if (directory.empty())
+                cache.reset();
+            else
+                cache.emplace(directory);
+        }
+
+        void set_vertex_quantization(const VertexQuantization &tolerance) {
+            quantization = tolerance;
+        }
 
-            std::filesystem::path directory = path.parent_path();
-            Model *model = new Model();
-            process_node(model, directory, scene->mRootNode, scene);
+        void set_keep_cpu_geometry(bool keep) {
+            keep_cpu_geometry = keep;
+        }
 
-            return handle_manager.insert(model);
+        void set_placeholder(Handle<Model> handle) {
+            placeholder = handle;
         }
 
         Model *get_model(Handle<Model> handle) {
-            return handle_manager.get(handle);
+            if (Model *model = models.get(handle))
+                return model;
+            if (!models.is_valid(handle))
+                return nullptr;
+            return models.get(placeholder);
+        }
+
+        ResourceState get_state(Handle<Model> handle) const {
+            return models.state(handle);
         }
 
         bool unload_model(Handle<Model> handle) {
-            if (Model *model = handle_manager.erase(handle)) {
-                unload_model_raw(model);
-                return true;
-            }
-            return false;
+            std::lock_guard lock(mutex);
+            if (!models.is_valid(handle))
+                return false;
+            if (auto model = models.erase(handle))
+                unload_model_raw(*model);
+            return true;
         }
 
         bool unload_model_and_textures(Handle<Model> handle) {
-            if (Model *model = handle_manager.erase(handle)) {
-                for (auto& mesh : model->meshes)
-                    for (auto& texture : mesh.textures)
-                        texture_loader.unload_texture(texture);
-                unload_model_raw(model);
-                return true;
+            std::lock_guard lock(mutex);
+            ResourceState state = models.state(handle);
+            if (state == ResourceState::invalid)
+                return false;
+            if (auto model = models.erase(handle)) {
+                unload_textures(*model);
+                unload_model_raw(*model);
+            } else if (state == ResourceState::loading) {
+                // Textures are known once the model is parsed, upload_pending releases them
+                unload_textures_of.insert(handle.raw);
             }
-            return false;
+            return true;
         }
 
     private:
-        Assimp::Importer importer;
-        HandleManager<Model> handle_manager;
+        struct ParsedModel {
+            Handle<Model> handle;
+            ModelData data; // keeps the geometry until upload
+            Model model;
+        };
+
+        // Owns geometry of a model read by the importer
+        struct ImportedGeometry {
+            std::vector<std::vector<std::byte>> vertices;
+            std::vector<std::vector<std::byte>> indices;
+        };
+
         TextureLoader &texture_loader;
+        MeshPool &mesh_pool;
+        ecs::Jobs &jobs;
+        ecs::JobCounter pending_jobs;
+
+        ConcurrentHandleManager<Model> models;
+        Handle<Model> placeholder{.raw = UINT64_MAX};
+
+        std::mutex mutex; // guards parsed queue and failing or erasing handles
+        std::deque<ParsedModel> parsed;
+        std::unordered_set<uint64_t> unload_textures_of; // raw handles unloaded with textures while loading
+
+        std::optional<MeshCache> cache;
+        VertexQuantization quantization;
+        bool keep_cpu_geometry = false;
+
+        /**
+         * Maps the cooked model or imports the file and cooks it.
+         */
+        tl::expected<ModelData, std::string> read_model(const fs::path &path, bool async) {
+            if (cache) {
+                if (auto cooked = cache->load(path, quantization))
+                    return std::move(*cooked);
+            }
 
-        void process_node(Model *model, const fs::path &directory,
-                          aiNode *node, const aiScene *scene) {
-            // Process all the node's meshes (if any)
-            for (unsigned int i = 0; i < node->mNumMeshes; i++) {
-                aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-                model->meshes.push_back(process_mesh(mesh, scene, directory));
+            auto model = import_model(path, async);
+            if (model && cache)
+                (void) cache->store(path, quantization, *model); // the cache is best effort, the model is loaded anyway
+            return model;
+        }
+
+        /**
+         * Reads the file with Assimp, converts, optimizes and quantizes its meshes.
+         * In async mode meshes are processed in parallel.
+         */
+        tl::expected<ModelData, std::string> import_model(const fs::path &path, bool async) {
+            Assimp::Importer import;
+            const aiScene *scene;
+            {
+                HS_ZONE("Assimp::Importer::ReadFile");
+                scene = import.ReadFile(path, aiProcess_Triangulate);
             }
 
-            // Then do the same for each of its children
-            for (unsigned int i = 0; i < node->mNumChildren; i++) {
-                process_node(model, directory, node->mChildren[i], scene);
+            if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+                return tl::make_unexpected(import.GetErrorString());
+
+            std::vector<const aiMesh *> meshes;
+            collect_meshes(scene->mRootNode, scene, meshes);
+
+            auto geometry = std::make_shared<ImportedGeometry>();
+            geometry->vertices.resize(meshes.size());
+            geometry->indices.resize(meshes.size());
+
+            ModelData model;
+            model.meshes.resize(meshes.size());
+            std::vector<MeshOptimizationReport> reports(meshes.size());
+            auto process_meshes = [&](uint32_t begin, uint32_t end) {
+                for (uint32_t i = begin; i < end; ++i) {
+                    std::vector<Vertex> vertices;
+                    std::vector<unsigned int> indices;
+                    process_mesh(meshes[i], scene, vertices, indices, model.meshes[i].textures);
+                    reports[i] = optimize_mesh(vertices, indices);
+
+                    MeshData &mesh = model.meshes[i];
+                    std::vector<glm::vec3> positions(vertices.size());
+                    for (std::size_t v = 0; v < vertices.size(); ++v)
+                        positions[v] = vertices[v].position;
+                    mesh.bounds = Bounds::from_points(positions);
+                    EncodedVertices encoded = encode_vertices(vertices, quantization);
+                    mesh.vertex_format = encoded.format;
+                    mesh.dequantization = encoded.dequantization;
+                    if (!mesh.bounds.empty() && (encoded.format.flags & VertexFormat::quantized_positions)) {
+                        // Rounding moves positions by up to half a step
+                        float error = encoded.dequantization.scale * 0.5f;
+                        mesh.bounds.min -= error;
+                        mesh.bounds.max += error;
+                        mesh.bounds.radius += error * std::sqrt(3.0f);
+                    }
+                    geometry->vertices[i] = std::move(encoded.data);
+                    mesh.index_size = index_size(vertices.size());
+                    geometry->indices[i] = pack_indices(indices, mesh.index_size);
+                    mesh.vertices = geometry->vertices[i];
+                    mesh.indices = geometry->indices[i];
+                    reports[i].after.bytes = mesh.vertices.size() + mesh.indices.size();
+                }
+            };
+
+            if (async)
+                jobs.parallel_for(0, (uint32_t) meshes.size(), 1, process_meshes);
+            else
+                process_meshes(0, (uint32_t) meshes.size());
+
+            for (const auto &report : reports)
+                model.optimization.add(report);
+            model.storage = std::move(geometry);
+            return model;
+        }
+
+        /**
+         * Loads textures of the meshes, synchronously or asynchronously.
+         * Geometry is uploaded separately by upload_meshes.
+         */
+        Model create_model(const ModelData &data, const fs::path &directory, bool async) {
+            Model model;
+            model.meshes.resize(data.meshes.size());
+            model.optimization = data.optimization;
+            for (std::size_t i = 0; i < data.meshes.size(); ++i) {
+                Mesh &mesh = model.meshes[i];
+                mesh.dequantization = data.meshes[i].dequantization;
+                mesh.bounds = data.meshes[i].bounds;
+                model.bounds = Bounds::merge(model.bounds, mesh.bounds);
+                for (const auto &ref : data.meshes[i].textures) {
+                    auto texture = async ? texture_loader.load_from_file_async(directory / ref.path, ref.type)
+                                         : texture_loader.load_from_file(directory / ref.path, ref.type);
+                    if (texture) // missing textures are skipped
+                        mesh.textures.push_back(*texture);
+                }
             }
+            return model;
         }
 
-        Mesh process_mesh(aiMesh *mesh, const aiScene *scene,
-                          const fs::path &directory) {
-            Mesh result;
+        /**
+         * Copies the meshes to MeshPool, the CPU copy is released unless it is kept.
+         * @return uploaded bytes.
+         */
+        std::size_t upload_meshes(Model &model, ModelData data) {
+            HS_ZONE("render::ModelLoader::upload_meshes");
+            std::size_t bytes = 0;
+            for (std::size_t i = 0; i < model.meshes.size(); ++i) {
+                model.meshes[i].geometry = mesh_pool.add(data.meshes[i]);
+                bytes += data.meshes[i].vertices.size() + data.meshes[i].indices.size();
+            }
+            if (keep_cpu_geometry)
+                model.geometry = std::move(data);
+            return bytes;
+        }
+
+        static void collect_meshes(const aiNode *node, const aiScene *scene, std::vector<const aiMesh *> &meshes) {
+            // Process all the node's meshes (if any)
+            for (unsigned int i = 0; i < node->mNumMeshes; i++)
+                meshes.push_back(scene->mMeshes[node->mMeshes[i]]);
+
+            // Then do the same for each of its children
+            for (unsigned int i = 0; i < node->mNumChildren; i++)
+                collect_meshes(node->mChildren[i], scene, meshes);
+        }
+
+        static void process_mesh(const aiMesh *mesh, const aiScene *scene, std::vector<Vertex> &vertices,
+                                 std::vector<unsigned int> &indices, std::vector<TextureRef> &textures) {
+            HS_ZONE("render::ModelLoader::process_mesh");
 
             // Process vertices
-            result.vertices.reserve(mesh->mNumVertices);
+            vertices.reserve(mesh->mNumVertices);
             for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
                 Vertex vertex;
 
@@ -129,56 +339,50 @@ namespace render {
                     vertex.tex_coords = glm::vec2(0.0f, 0.0f);
                 }
 
-                result.vertices.push_back(vertex);
+                vertices.push_back(vertex);
             }
 
             // Process indices
-            result.indices.reserve(mesh->mNumFaces * 3);
+            indices.reserve(mesh->mNumFaces * 3);
             for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
                 aiFace face = mesh->mFaces[i];
 
                 // Due to aiProcess_Triangulate option should be always 3
                 for (unsigned int j = 0; j < face.mNumIndices; j++)
-                    result.indices.push_back(face.mIndices[j]);
+                    indices.push_back(face.mIndices[j]);
             }
 
             // Process material
             if (mesh->mMaterialIndex >= 0) {
                 aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
-                load_material_textures(result.textures, directory, material, aiTextureType_DIFFUSE, Texture2d::diffuse);
-                load_material_textures(result.textures, directory, material, aiTextureType_SPECULAR, Texture2d::specular);
+                collect_material_textures(textures, material, aiTextureType_DIFFUSE, Texture2d::diffuse);
+                collect_material_textures(textures, material, aiTextureType_SPECULAR, Texture2d::specular);
             }
-
-            setup_mesh(&result);
-
-            return result;
         }
 
-        void load_material_textures(std::vector<Handle<Texture2d>> &textures,
-                                    const fs::path &directory,
-                                    aiMaterial *mat, aiTextureType ai_type, Texture2d::Type type) {
+        static void collect_material_textures(std::vector<TextureRef> &textures, aiMaterial *mat,
+                                              aiTextureType ai_type, Texture2d::Type type) {
             for (unsigned int i = 0; i < mat->GetTextureCount(ai_type); i++) {
                 aiString str;
                 mat->GetTexture(ai_type, i, &str);
-
-                textures.push_back(
-                        texture_loader.load_from_file(directory / str.C_Str(), type).value()
-                );
+                textures.push_back(TextureRef{.path = str.C_Str(), .type = type});
             }
         }
 
-        static void unload_model_raw(Model *model) {
-            for (auto& mesh : model->meshes) {
-                glDeleteVertexArrays(1, &mesh.VAO);
-                glDeleteBuffers(1, &mesh.VBO);
-                glDeleteBuffers(1, &mesh.EBO);
-            }
-            delete model;
+        void unload_textures(const Model &model) {
+            for (const auto &mesh : model.meshes)
+                for (auto texture : mesh.textures)
+                    texture_loader.unload_texture(texture);
+        }
+
+        void unload_model_raw(Model &model) {
+            for (auto& mesh : model.meshes)
+                mesh_pool.remove(mesh.geometry);
         }
     };
 
-    ModelLoader::ModelLoader(TextureLoader &texture_loader) {
-        impl = new Impl(texture_loader);
+    ModelLoader::ModelLoader(TextureLoader &texture_loader, MeshPool &mesh_pool, ecs::Jobs &jobs) {
+        impl = new Impl(texture_loader, mesh_pool, jobs);
     }
 
     ModelLoader::~ModelLoader() {
@@ -189,10 +393,38 @@ namespace render {
         return impl->load_model(path);
     }
 
+    Handle<Model> ModelLoader::load_model_async(const std::filesystem::path &path) {
+        return impl->load_model_async(path);
+    }
+
+    void ModelLoader::upload_pending(UploadScope &scope) {
+        impl->upload_pending(scope);
+    }
+
+    void ModelLoader::set_cache_directory(const std::filesystem::path &directory) {
+        impl->set_cache_directory(directory);
+    }
+
+    void ModelLoader::set_vertex_quantization(const VertexQuantization &tolerance) {
+        impl->set_vertex_quantization(tolerance);
+    }
+
+    void ModelLoader::set_keep_cpu_geometry(bool keep) {
+        impl->set_keep_cpu_geometry(keep);
+    }
+
+    void ModelLoader::set_placeholder(Handle<Model> handle) {
+        impl->set_placeholder(handle);
+    }
+
     Model *ModelLoader::get_model(Handle<Model> handle) const {
         return impl->get_model(handle);
     }
 
+    ResourceState ModelLoader::get_state(Handle<Model> handle) const {
+        return impl->get_state(handle);
+    }
+
     bool ModelLoader::unload_model(Handle<Model> handle) {
         return impl->unload_model(handle);
     }
@@ -0,0 +1,71 @@
+#include "render/render_queue.h"
+#include "common/radix_sort.h"
+#include "common/trace.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace render {
+    static constexpr uint64_t mask(uint32_t bits) {
+        return (uint64_t(1) << bits) - 1;
+    }
+
+    static constexpr uint32_t translucency_shift = 61;
+    static constexpr uint32_t pass_shift = 62;
+
+    uint64_t SortKey::opaque(Pass pass, uint32_t shader, uint32_t material, uint32_t mesh, float depth) {
+        return (uint64_t) pass << pass_shift |
+               (shader & mask(id_bits)) << (mesh_bits + depth_bits + id_bits) |
+               (material & mask(id_bits)) << (mesh_bits + depth_bits) |
+               (mesh & mask(mesh_bits)) << depth_bits |
+               quantize_depth(depth);
+    }
+
+    uint64_t SortKey::translucent(Pass pass, uint32_t shader, uint32_t material, uint32_t mesh, float depth) {
+        uint64_t inverted_depth = mask(depth_bits) - quantize_depth(depth);
+        return (uint64_t) pass << pass_shift |
+               uint64_t(1) << translucency_shift |
+               inverted_depth << (mesh_bits + 2 * id_bits) |
+               (shader & mask(id_bits)) << (mesh_bits + id_bits) |
+               (material & mask(id_bits)) << mesh_bits |
+               (mesh & mask(mesh_bits));
+    }
+
+    bool SortKey::is_translucent(uint64_t key) {
+        return (key >> translucency_shift) & 1;
+    }
+
+    uint32_t SortKey::quantize_depth(float depth) {
+        // Bits of non-negative floats are ordered as the floats, the top ones carry the exponent
+        uint32_t bits = std::bit_cast<uint32_t>(std::max(depth, 0.0f));
+        return (uint32_t) (bits >> (31 - depth_bits));
+    }
+
+    void RenderQueue::clear() {
+        sorted.clear();
+        commands.clear();
+    }
+
+    void RenderQueue::push(uint64_t key, const DrawCommand &command) {
+        sorted.push_back(Packet{key, (uint32_t) commands.size()});
+        commands.push_back(command);
+    }
+
+    void RenderQueue::sort() {
+        HS_ZONE("render::RenderQueue::sort");
+        radix_sort(sorted, scratch, [](const Packet &packet) { return packet.key; });
+    }
+
+    uint32_t RenderQueue::material(std::span<const Handle<Texture2d>> textures) {
+        material_key.resize(textures.size());
+        for (std::size_t i = 0; i < textures.size(); ++i)
+            material_key[i] = textures[i].raw;
+
+        auto it = materials.find(material_key);
+        if (it != materials.end())
+            return it->second;
+        if (materials.size() > mask(SortKey::id_bits))
+            materials.clear();
+        return materials.emplace(material_key, (uint32_t) materials.size()).first->second;
+    }
+}
@@ -4,143 +4,578 @@
 #include <GLFW/glfw3.h>
 
 #include "window_data.h"
-
+#include "render/frame_uniforms.h"
+#include "common/frustum.h"
+#include "render/stream_buffer.h"
+#include "common/trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <iostream>
+#include <map>
+#include <optional>
+#include <unordered_map>
 
 namespace render {
-    static void setup_GL() {
-        glEnable(GL_DEPTH_TEST);
+    static constexpr std::size_t initial_instances_capacity = 4 << 20; // bytes, 65536 matrices
+    static constexpr std::size_t initial_uniforms_capacity = 64 << 10; // bytes
+    static constexpr uint32_t culling_grain = 2048; // spheres per job
+
+    static void setup_GL(GLStateCache &gl_state) {
+        gl_state.set_depth_test(true);
+        gl_state.set_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // used by translucent draws
     }
 
-    static void render_mesh(const Mesh &mesh,
-                            const TextureLoader &texture_loader,
-                            const ShaderProgram &shader) {
+    static void bind_textures(std::span<const Handle<Texture2d>> textures,
+                              const TextureLoader &texture_loader,
+                              const ShaderProgram &shader,
+                              GLStateCache &gl_state) {
         unsigned int diffuseNr = 0;
         unsigned int specularNr = 0;
-        for (unsigned int i = 0; i < mesh.textures.size(); i++) {
-            glActiveTexture(GL_TEXTURE0 + i); // activate proper texture unit before binding
-            glBindTexture(GL_TEXTURE_2D, 0);
-            Texture2d *tex = texture_loader.get_texture(mesh.textures[i]);
-
-            // retrieve texture number (the N in diffuse_textureN)
-            std::string number;
-            std::string name;
+        for (unsigned int i = 0; i < textures.size(); i++) {
+            Texture2d *tex = texture_loader.get_texture(textures[i]);
+            if (!tex) {
+                gl_state.bind_texture(i, 0); // unloaded texture
+                continue;
+            }
+
+            // sampler of the texture number (the N in material.diffuseN)
+            int sampler;
             switch (tex->type) {
                 case Texture2d::diffuse:
-                    name = "material.diffuse";
-                    number = std::to_string(diffuseNr++);
+                    sampler = shader.diffuse_sampler(diffuseNr++);
                     break;
                 case Texture2d::specular:
-                    name = "material.specular";
-                    number = std::to_string(specularNr++);
-
+                    sampler = shader.specular_sampler(specularNr++);
                     break;
                 default:
                     continue; // unsupported texture type
             }
 
-            shader.set_int((name + number).c_str(), i);
-            glBindTexture(GL_TEXTURE_2D, tex->id);
+            shader.set_int(sampler, (int) i);
+            gl_state.bind_texture(i, tex->id);
         }
-        glActiveTexture(GL_TEXTURE0);
+    }
+
+    static bool same_textures(std::span<const Handle<Texture2d>> a, std::span<const Handle<Texture2d>> b) {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](Handle<Texture2d> x, Handle<Texture2d> y) {
+            return x.raw == y.raw;
+        });
+    }
+
+    // Meshes sharing a VAO get adjacent ids
+    static uint32_t mesh_id(const PooledMesh &geometry, Handle<PooledMesh> handle) {
+        return geometry.arena << SortKey::id_bits | (handle.index & ((1 << SortKey::id_bits) - 1));
+    }
+
+    static float distance_to_box(const glm::vec3 &point, const glm::vec3 &min, const glm::vec3 &max) {
+        return glm::length(point - glm::clamp(point, min, max));
+    }
+
+    /**
+     * Packs the lights of all the entities into the std140 block, see frame_uniforms.h.
+     */
+    static void gather_lights(const ecs::Entities &entities, LightsBlock &block) {
+        HS_ZONE("render::gather_lights");
+        block.dir_lights_count = 0;
+        entities.foreach([&](const DirLight &light) {
+            if ((std::size_t) block.dir_lights_count == max_lights)
+                return;
+            block.dir_lights[block.dir_lights_count++] = DirLightBlock{
+                    .direction = light.direction,
+                    .ambient = light.ambient,
+                    .diffuse = light.diffuse,
+                    .specular = light.specular
+            };
+        });
+
+        block.point_lights_count = 0;
+        entities.foreach([&](const Transform &transform, const PointLight &light) {
+            if ((std::size_t) block.point_lights_count == max_lights)
+                return;
+            block.point_lights[block.point_lights_count++] = PointLightBlock{
+                    .position = transform.position,
+                    .constant = light.constant,
+                    .ambient = light.ambient,
+                    .linear = light.linear,
+                    .diffuse = light.diffuse,
+                    .quadratic = light.quadratic,
+                    .specular = light.specular
+            };
+        });
+
+        block.spot_lights_count = 0;
+        entities.foreach([&](const Transform &transform, const SpotLight &light) {
+            if ((std::size_t) block.spot_lights_count == max_lights)
+                return;
+            block.spot_lights[block.spot_lights_count++] = SpotLightBlock{
+                    .position = transform.position,
+                    .cut_off = light.cutOff,
+                    .direction = light.direction,
+                    .outer_cut_off = light.outerCutOff,
+                    .ambient = light.ambient,
+                    .constant = light.constant,
+                    .diffuse = light.diffuse,
+                    .linear = light.linear,
+                    .specular = light.specular,
+                    .quadratic = light.quadratic
+            };
+        });
+    }
 
-        // draw mesh
-        glBindVertexArray(mesh.VAO);
-        glDrawElements(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+    glm::mat4 local_to_world(const Transform &transform) {
+        glm::mat4 result = glm::mat4(1.0f);
+        result = glm::translate(result, transform.position);
+        result = result * glm::toMat4(transform.rotation);
+        return result;
+    }
+
+    static glm::mat4 dequantization_matrix(const PositionDequantization &dequantization) {
+        glm::mat4 result = glm::translate(glm::mat4(1.0f), dequantization.offset);
+        return glm::scale(result, glm::vec3(dequantization.scale));
+    }
+
+    static Transform interpolate(const Transform &previous, const Transform &current, float alpha) {
+        return {
+                glm::mix(previous.position, current.position, alpha),
+                glm::slerp(previous.rotation, current.rotation, alpha)
+        };
     }
 
     class RenderSystem::Impl {
     public:
         tl::expected<void, std::string> setup(ecs::World &world,
                                               const WindowSystem &window_system) {
-            setup_GL();
+            world.emplace<GLStateCache>();
+            auto &gl_state = world.get<GLStateCache>();
+            setup_GL(gl_state);
 
             window = window_system.get_window_data().window;
+            jobs = &world.get<ecs::Jobs>();
+            instances.emplace(gl_state, GL_ARRAY_BUFFER, initial_instances_capacity);
+            uniforms.emplace(gl_state, GL_UNIFORM_BUFFER, initial_uniforms_capacity);
+            int alignment = 0;
+            glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+            uniform_alignment = std::max<std::size_t>(alignment, 16);
 
             world.emplace<ShaderLoader>();
-            world.emplace<TextureLoader>();
-            world.emplace<ModelLoader>(world.get<TextureLoader>());
+            world.emplace<TextureLoader>(gl_state, world.get<ecs::Jobs>());
+            world.emplace<MeshPool>(gl_state);
+            world.emplace<ModelLoader>(world.get<TextureLoader>(), world.get<MeshPool>(), world.get<ecs::Jobs>());
+            world.emplace<StaticBatch>(world.get<MeshPool>());
 
             return {};
         }
 
         void update(const ShaderLoader &shader_loader,
-                    const TextureLoader &texture_loader,
-                    const ModelLoader &model_loader,
-                    const ecs::Entities &entities) {
+                    TextureLoader &texture_loader,
+                    ModelLoader &model_loader,
+                    const MeshPool &mesh_pool,
+                    StaticBatch &static_batch,
+                    const UploadBudget &upload_budget,
+                    const ecs::FixedTime &fixed_time,
+                    ecs::Entities &entities,
+                    GLStateCache &gl_state,
+                    RenderQueueStats &render_stats) {
+            HS_ZONE("render::RenderSystem::update");
+            render_stats = {};
+            gl_state.reset_stats();
+            ++frame;
+
+            {
+                HS_ZONE("render::upload_pending");
+                UploadScope upload_scope(upload_budget);
+                texture_loader.upload_pending(upload_scope);
+                model_loader.upload_pending(upload_scope);
+            }
+            static_batch.update(entities, model_loader);
 
             glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-            entities.foreach([&](const Transform &cam_transform, const Camera &camera) {
-                glm::mat4 projection = camera.projection;
-
-                glm::mat4 view = glm::mat4(1.0f);
-                view = glm::translate(view, -cam_transform.position);
-                view = glm::toMat4(glm::inverse(cam_transform.rotation)) * view;
-
-                entities.foreach([&](const Transform &ent_transform,
-                                                               const MeshRenderer &renderer) {
-                    glm::mat4 local_to_world = glm::mat4(1.0f);
-                    local_to_world = glm::translate(local_to_world, ent_transform.position);
-                    local_to_world = local_to_world * glm::toMat4(ent_transform.rotation);
-
-                    auto *shader_program = shader_loader.get_shader_program(renderer.shader_program_handle);
-
-                    shader_program->use();
-                    shader_program->set_mat4("projection", projection);
-                    shader_program->set_mat4("view", view);
-                    shader_program->set_mat4("model", local_to_world);
-                    shader_program->set_vec3("viewPos", cam_transform.position);
-
-                    int index = 0;
-                    entities.foreach([&] (const DirLight &dir_light) {
-                        shader_program->set_dir_light(index, dir_light);
-                        ++index;
-                    });
-                    shader_program->set_int("NrDirLights", index);
-
-                    index = 0;
-                    entities.foreach([&] (const Transform &light_transform,
-                            const PointLight &point_light) {
-                        shader_program->set_point_light(index, light_transform.position, point_light);
-                        ++index;
-                    });
-                    shader_program->set_int("NrPointLights", index);
-
-                    index = 0;
-                    entities.foreach([&] (const Transform &light_transform,
-                            const SpotLight &spot_light) {
-                        shader_program->set_spot_light(index, light_transform.position, spot_light);
-                        ++index;
-                    });
-                    shader_program->set_int("NrSpotLights", index);
-
-                    shader_program->set_float("material.shininess", 64.0f);
-
-                    //glm::mat4 mapping = projection * view * local_to_world;
-                    //shader_program->set_mat4("mapping", mapping);
-
-                    Model *model = model_loader.get_model(renderer.model_handle);
-                    if (model)
-                        for (auto &mesh : model->meshes)
-                            render_mesh(mesh, texture_loader, *shader_program);
-                });
-            });
+            collect_candidates(fixed_time, entities, model_loader);
+
+            std::size_t cameras_offset = write_frame_uniforms(entities, gl_state);
+            for (std::size_t i = 0; i < cameras.size(); ++i) {
+                const CameraBlock &camera = cameras[i].block;
+                gl_state.bind_uniform_buffer(camera_block_binding, uniforms->id(), cameras_offset + i * camera_stride(),
+                                             sizeof(CameraBlock));
+
+                glm::mat4 view_projection = camera.projection * camera.view;
+                const std::vector<uint32_t> &visible = cull(cameras[i].key, view_projection);
+                render_stats.culled += candidates.size() - visible.size();
+                collect_instances(visible);
+                fill_queue(camera.view_pos, Frustum::from_matrix(view_projection), shader_loader, model_loader,
+                           mesh_pool, static_batch, render_stats);
+                submit_queue(shader_loader, texture_loader, mesh_pool, gl_state, render_stats);
+            }
+            std::erase_if(visibility, [this](const auto &item) { return item.second.frame != frame; });
 
-            glfwSwapBuffers(window);
+            {
+                HS_ZONE("glfwSwapBuffers");
+                glfwSwapBuffers(window);
+            }
             glfwPollEvents();
         }
 
         void teardown(ecs::World &world) {
+            instances.reset();
+            uniforms.reset();
             world.erase<ShaderLoader>();
-            world.erase<ModelLoader>(); // must be deleted before TextureLoader
+            world.erase<StaticBatch>();
+            world.erase<ModelLoader>(); // must be deleted before TextureLoader and MeshPool
+            world.erase<MeshPool>();
             world.erase<TextureLoader>();
+            world.erase<GLStateCache>(); // objects above are deleted through it
         }
 
     private:
+        // Instances of one model drawn with one shader
+        struct InstanceGroup {
+            Handle<Model> model;
+            Handle<ShaderProgram> shader;
+            std::vector<glm::mat4> matrices; // capacity is kept between frames
+            std::size_t offset = 0; // bytes in the instance buffer
+        };
+
+        // Translucent entities are drawn one by one to be sorted back to front
+        struct TranslucentInstance {
+            Handle<Model> model;
+            Handle<ShaderProgram> shader;
+            glm::vec3 position;
+            std::size_t offset = 0; // bytes in the instance buffer
+        };
+
+        // MeshRenderer entity drawn this frame, if it is in view
+        struct Candidate {
+            Handle<Model> model;
+            Handle<ShaderProgram> shader;
+            glm::mat4 matrix;
+            bool translucent;
+        };
+
+        // Visible candidates of a camera, reused while neither the camera nor the bounds change
+        struct CameraVisibility {
+            glm::mat4 view_projection;
+            uint64_t generation = UINT64_MAX; // of the spheres
+            uint64_t frame = 0; // last used, entries of removed cameras are dropped
+            std::vector<uint32_t> visible; // indices of candidates
+        };
+
+        struct CameraView {
+            uint64_t key; // entity
+            CameraBlock block;
+        };
+
         GLFWwindow *window = nullptr;
+        ecs::Jobs *jobs = nullptr;
+        uint64_t frame = 0;
+        std::optional<StreamBuffer> instances;
+        std::optional<StreamBuffer> uniforms; // camera and lights blocks
+        std::size_t uniform_alignment = 16;
+        LightsBlock lights{};
+        std::vector<CameraView> cameras;
+        std::vector<std::byte> frame_uniforms; // lights, then the cameras
+        std::map<std::pair<uint64_t, uint64_t>, InstanceGroup> groups; // by shader, then by model
+        std::vector<glm::mat4> frame_matrices;
+        std::size_t identity_offset = 0; // bytes in the instance buffer, of the matrix of static geometry
+        std::vector<TranslucentInstance> translucent_instances;
+        RenderQueue queue;
+
+        std::vector<Candidate> candidates;
+        BoundingSpheres spheres; // of candidates
+        BoundingSpheres previous_spheres;
+        uint64_t spheres_generation = 0; // changes with the spheres
+        std::unordered_map<uint64_t, CameraVisibility> visibility; // by camera entity
+        std::vector<std::vector<uint32_t>> chunk_visible; // per culling job
+
+        /**
+         * Computes model matrices and world bounds of the MeshRenderer entities, once per frame for all the cameras.
+         * Updates WorldBounds of the entities that have it.
+         */
+        void collect_candidates(const ecs::FixedTime &fixed_time, ecs::Entities &entities,
+                                const ModelLoader &model_loader) {
+            HS_ZONE("render::RenderSystem::collect_candidates");
+            candidates.clear();
+            std::swap(previous_spheres, spheres);
+            spheres.clear();
+
+            entities.foreach([&](const Transform &ent_transform,
+                                 const PreviousTransform *prev_transform,
+                                 const MeshRenderer &renderer,
+                                 const Static *is_static,
+                                 const Translucent *translucent,
+                                 WorldBounds *world_bounds) {
+                const Model *model = model_loader.get_model(renderer.model_handle);
+                glm::mat4 model_matrix = prev_transform
+                        ? local_to_world(interpolate(prev_transform->transform, ent_transform,
+                                                     fixed_time.alpha()))
+                        : local_to_world(ent_transform);
+                Bounds bounds = model ? model->bounds.transformed(model_matrix) : Bounds{};
+                if (world_bounds)
+                    world_bounds->bounds = bounds;
+
+                if (!model || (is_static && !translucent))
+                    return; // not loaded or drawn by StaticBatch
+                candidates.push_back(Candidate{renderer.model_handle, renderer.shader_program_handle, model_matrix,
+                                               translucent != nullptr});
+                spheres.push_back(bounds.center, bounds.radius);
+            });
+
+            if (spheres != previous_spheres)
+                ++spheres_generation;
+        }
+
+        /**
+         * Tests the spheres of the candidates against the frustum in parallel chunks.
+         * @return indices of the visible candidates, ascending.
+         */
+        const std::vector<uint32_t> &cull(uint64_t camera_key, const glm::mat4 &view_projection) {
+            HS_ZONE("render::RenderSystem::cull");
+            CameraVisibility &cached = visibility[camera_key];
+            cached.frame = frame;
+            if (cached.generation == spheres_generation && cached.view_projection == view_projection)
+                return cached.visible;
+
+            cached.generation = spheres_generation;
+            cached.view_projection = view_projection;
+            cached.visible.clear();
+
+            const Frustum frustum = Frustum::from_matrix(view_projection);
+            const auto count = (uint32_t) spheres.size();
+            chunk_visible.resize((count + culling_grain - 1) / culling_grain);
+            jobs->parallel_for(0, count, culling_grain, [&](uint32_t begin, uint32_t end) {
+                std::vector<uint32_t> &visible = chunk_visible[begin / culling_grain];
+                visible.clear();
+                cull_spheres(frustum, spheres, begin, end, visible);
+            });
+            for (const auto &visible : chunk_visible)
+                cached.visible.insert(cached.visible.end(), visible.begin(), visible.end());
+            return cached.visible;
+        }
+
+        /**
+         * Groups the visible candidates by model and shader and streams their model matrices
+         * into the instance buffer. Called per camera, the draws of the previous camera are issued by then.
+         */
+        void collect_instances(const std::vector<uint32_t> &visible) {
+            HS_ZONE("render::RenderSystem::collect_instances");
+            for (auto &[key, group] : groups)
+                group.matrices.clear();
+            translucent_instances.clear();
+            std::vector<glm::mat4> translucent_matrices;
+
+            InstanceGroup *group = nullptr;
+            for (uint32_t index : visible) {
+                const Candidate &candidate = candidates[index];
+                if (candidate.translucent) {
+                    translucent_instances.push_back(TranslucentInstance{
+                            candidate.model, candidate.shader, glm::vec3(candidate.matrix[3])});
+                    translucent_matrices.push_back(candidate.matrix);
+                    continue;
+                }
+
+                // Consecutive entities often share the model, the lookup is skipped then
+                if (!group || group->model.raw != candidate.model.raw || group->shader.raw != candidate.shader.raw) {
+                    group = &groups[{candidate.shader.raw, candidate.model.raw}];
+                    group->model = candidate.model;
+                    group->shader = candidate.shader;
+                }
+                group->matrices.push_back(candidate.matrix);
+            }
+            std::erase_if(groups, [](const auto &item) { return item.second.matrices.empty(); });
+
+            frame_matrices.assign(1, glm::mat4(1.0f));
+            for (auto &[key, group] : groups) {
+                group.offset = frame_matrices.size() * sizeof(glm::mat4);
+                frame_matrices.insert(frame_matrices.end(), group.matrices.begin(), group.matrices.end());
+            }
+            for (std::size_t i = 0; i < translucent_instances.size(); ++i) {
+                translucent_instances[i].offset = frame_matrices.size() * sizeof(glm::mat4);
+                frame_matrices.push_back(translucent_matrices[i]);
+            }
+            std::size_t base = instances->write(frame_matrices.data(), frame_matrices.size() * sizeof(glm::mat4));
+            identity_offset = base;
+            for (auto &[key, group] : groups)
+                group.offset += base;
+            for (auto &instance : translucent_instances)
+                instance.offset += base;
+        }
+
+        std::size_t camera_stride() const {
+            return (sizeof(CameraBlock) + uniform_alignment - 1) & ~(uniform_alignment - 1);
+        }
+
+        /**
+         * Gathers the lights and the cameras once per frame and streams them into the uniform buffer
+         * in a single write, so orphaning the buffer cannot separate them. Binds the lights block.
+         * @return offset of the block of the first camera.
+         */
+        std::size_t write_frame_uniforms(const ecs::Entities &entities, GLStateCache &gl_state) {
+            HS_ZONE("render::RenderSystem::write_frame_uniforms");
+            cameras.clear();
+            entities.foreach([&](ecs::Entity entity, const Transform &cam_transform, const Camera &camera) {
+                cameras.push_back(CameraView{
+                        .key = (uint64_t) entity.id << 32 | entity.version,
+                        .block = CameraBlock{
+                                .projection = camera.projection,
+                                .view = glm::toMat4(glm::inverse(cam_transform.rotation)) *
+                                        glm::translate(glm::mat4(1.0f), -cam_transform.position),
+                                .view_pos = cam_transform.position
+                        }
+                });
+            });
+
+            const std::size_t lights_size = (sizeof(LightsBlock) + uniform_alignment - 1) & ~(uniform_alignment - 1);
+            frame_uniforms.assign(lights_size + cameras.size() * camera_stride(), std::byte{0});
+            gather_lights(entities, lights);
+            std::memcpy(frame_uniforms.data(), &lights, sizeof(LightsBlock));
+            for (std::size_t i = 0; i < cameras.size(); ++i)
+                std::memcpy(frame_uniforms.data() + lights_size + i * camera_stride(), &cameras[i].block,
+                            sizeof(CameraBlock));
+
+            std::size_t offset = uniforms->write(frame_uniforms.data(), frame_uniforms.size(), uniform_alignment);
+            gl_state.bind_uniform_buffer(lights_block_binding, uniforms->id(), offset, sizeof(LightsBlock));
+            return offset + lights_size;
+        }
+
+        /**
+         * Turns the instance groups, translucent entities and static clusters in view into sorted draw commands.
+         */
+        void fill_queue(const glm::vec3 &camera_position,
+                        const Frustum &frustum,
+                        const ShaderLoader &shader_loader,
+                        const ModelLoader &model_loader,
+                        const MeshPool &mesh_pool,
+                        const StaticBatch &static_batch,
+                        RenderQueueStats &stats) {
+            HS_ZONE("render::RenderSystem::fill_queue");
+            queue.clear();
+
+            auto push_model = [&](Handle<ShaderProgram> shader, Handle<Model> model_handle, float depth,
+                                  bool translucent, std::size_t instances_offset, uint32_t instances_count) {
+                const Model *model = model_loader.get_model(model_handle);
+                if (!model || !shader_loader.get_shader_program(shader))
+                    return;
+                for (const auto &mesh : model->meshes) {
+                    const PooledMesh *geometry = mesh_pool.get(mesh.geometry);
+                    if (!geometry)
+                        continue;
+                    uint32_t material = queue.material(mesh.textures);
+                    uint32_t id = mesh_id(*geometry, mesh.geometry);
+                    uint64_t key = translucent
+                            ? SortKey::translucent(SortKey::main, shader.index, material, id, depth)
+                            : SortKey::opaque(SortKey::main, shader.index, material, id, depth);
+                    queue.push(key, DrawCommand{shader, mesh.textures, *geometry, mesh.dequantization,
+                                                instances_offset, instances_count});
+                }
+            };
+
+            for (const auto &[key, group] : groups) {
+                // The nearest instance orders the whole group
+                float depth = INFINITY;
+                for (const auto &matrix : group.matrices)
+                    depth = std::min(depth, glm::distance(camera_position, glm::vec3(matrix[3])));
+                push_model(group.shader, group.model, depth, false, group.offset, (uint32_t) group.matrices.size());
+            }
+
+            for (const auto &instance : translucent_instances)
+                push_model(instance.shader, instance.model, glm::distance(camera_position, instance.position), true,
+                           instance.offset, 1);
+
+            // Static geometry is in world space already
+            for (const auto &cluster : static_batch.clusters()) {
+                if (!frustum.intersects_box(cluster.min, cluster.max)) {
+                    ++stats.culled;
+                    continue;
+                }
+                const PooledMesh *geometry = mesh_pool.get(cluster.geometry);
+                if (!geometry || !shader_loader.get_shader_program(cluster.shader))
+                    continue;
+                uint64_t key = SortKey::opaque(SortKey::main, cluster.shader.index, queue.material(cluster.textures),
+                                               mesh_id(*geometry, cluster.geometry),
+                                               distance_to_box(camera_position, cluster.min, cluster.max));
+                queue.push(key, DrawCommand{cluster.shader, cluster.textures, *geometry, cluster.dequantization,
+                                            identity_offset, 1});
+            }
+
+            queue.sort();
+        }
+
+        /**
+         * Issues the queued draws in order and changes only the state that differs from the previous draw.
+         */
+        void submit_queue(const ShaderLoader &shader_loader,
+                          const TextureLoader &texture_loader,
+                          const MeshPool &mesh_pool,
+                          GLStateCache &gl_state,
+                          RenderQueueStats &stats) {
+            HS_ZONE("render::RenderSystem::submit_queue");
+            uint64_t bound_shader = UINT64_MAX;
+            uint32_t bound_arena = UINT32_MAX;
+            std::size_t bound_instances = SIZE_MAX;
+            std::span<const Handle<Texture2d>> bound_textures;
+
+            for (const auto &packet : queue.packets()) {
+                const DrawCommand &command = queue.command(packet);
+                const ShaderProgram &shader_program = *shader_loader.get_shader_program(command.shader);
+
+                // Translucent draws come last, so this toggles once per camera
+                bool translucent = SortKey::is_translucent(packet.key);
+                gl_state.set_blend(translucent);
+                gl_state.set_depth_write(!translucent);
+
+                bool shader_changed = command.shader.raw != bound_shader;
+                if (shader_changed) {
+                    bound_shader = command.shader.raw;
+                    gl_state.use_program(shader_program.id); // camera and lights are in uniform blocks
+                    shader_program.set_float(shader_program.location(Uniform::material_shininess), 64.0f);
+                    ++stats.shader_changes;
+                }
+
+                // Meshes of one vertex format share a VAO
+                if (command.geometry.arena != bound_arena) {
+                    gl_state.bind_vertex_array(mesh_pool.vertex_array(command.geometry.arena));
+                    bound_arena = command.geometry.arena;
+                    bound_instances = SIZE_MAX; // instance attributes are state of the VAO
+                    ++stats.vertex_array_changes;
+                }
+                if (command.instances_offset != bound_instances) {
+                    bind_instances(command.instances_offset, gl_state);
+                    bound_instances = command.instances_offset;
+                }
+
+                // Sampler uniforms belong to the program, so a new program needs them again
+                if (shader_changed || !same_textures(command.textures, bound_textures)) {
+                    bind_textures(command.textures, texture_loader, shader_program, gl_state);
+                    bound_textures = command.textures;
+                    ++stats.texture_changes;
+                }
+
+                shader_program.set_mat4(shader_program.location(Uniform::dequantization),
+                                        dequantization_matrix(command.dequantization));
+                mesh_pool.draw(command.geometry, command.instances_count);
+                ++stats.draws;
+            }
+
+            gl_state.set_blend(false);
+            gl_state.set_depth_write(true); // glClear writes depth only through the mask
+        }
+
+        /**
+         * Points the instance attributes of the bound VAO to the matrices at the offset.
+         */
+        void bind_instances(std::size_t offset, GLStateCache &gl_state) const {
+            gl_state.bind_buffer(GL_ARRAY_BUFFER, instances->id());
+            for (unsigned int column = 0; column < 4; ++column) {
+                unsigned int location = instance_matrix_location + column;
+                glEnableVertexAttribArray(location);
+                glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                                      (void *) (uintptr_t) (offset + column * sizeof(glm::vec4)));
+                glVertexAttribDivisor(location, 1);
+            }
+        }
     };
 
     RenderSystem::RenderSystem() {
@@ -157,10 +592,17 @@ namespace render {
     }
 
     void RenderSystem::update(const ShaderLoader &shader_loader,
-                              const TextureLoader &texture_loader,
-                              const ModelLoader &model_loader,
-                              const ecs::Entities &entities) {
-        impl->update(shader_loader, texture_loader, model_loader, entities);
+                              TextureLoader &texture_loader,
+                              ModelLoader &model_loader,
+                              const MeshPool &mesh_pool,
+                              StaticBatch &static_batch,
+                              const UploadBudget &upload_budget,
+                              const ecs::FixedTime &fixed_time,
+                              ecs::Entities &entities,
+                              GLStateCache &gl_state,
+                              RenderQueueStats &render_stats) {
+        impl->update(shader_loader, texture_loader, model_loader, mesh_pool, static_batch, upload_budget, fixed_time,
+                     entities, gl_state, render_stats);
     }
 
     void RenderSystem::teardown(ecs::World &world) {
@@ -1,39 +1,120 @@
 #include "render/shader.h"
+#include "render/frame_uniforms.h"
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 
 namespace render {
-    void ShaderProgram::use() const {
-        glUseProgram(id);
+    static constexpr std::array<std::string_view, (std::size_t) Uniform::count> uniform_names{
+            "dequantization",
+            "material.shininess",
+    };
+
+    void ShaderProgram::reflect() {
+        uniforms = UniformTable{};
+
+        int count = 0;
+        int max_length = 0;
+        glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+        std::vector<char> buffer(std::max(max_length, 1));
+        for (int i = 0; i < count; ++i) {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type;
+            glGetActiveUniform(id, (GLuint) i, (GLsizei) buffer.size(), &length, &size, &type, buffer.data());
+            std::string name(buffer.data(), length);
+            int location = glGetUniformLocation(id, name.c_str());
+            if (location < 0)
+                continue; // in a uniform block
+
+            uniforms.locations.emplace(name, location);
+            if (!name.ends_with("[0]"))
+                continue;
+            // Arrays of basic types are listed once, by the name of the first element
+            std::string array = name.substr(0, name.size() - 3);
+            uniforms.locations.emplace(array, location);
+            for (int element = 1; element < size; ++element) {
+                std::string element_name = array + "[" + std::to_string(element) + "]";
+                uniforms.locations.emplace(element_name, glGetUniformLocation(id, element_name.c_str()));
+            }
+        }
+
+        for (std::size_t i = 0; i < uniform_names.size(); ++i)
+            uniforms.known[i] = location(uniform_names[i]);
+
+        auto samplers = [this](const std::string &prefix, std::vector<int> &result) {
+            for (int n = 0, sampler; (sampler = location(prefix + std::to_string(n))) >= 0; ++n)
+                result.push_back(sampler);
+        };
+        samplers("material.diffuse", uniforms.diffuse_samplers);
+        samplers("material.specular", uniforms.specular_samplers);
+
+        auto bind_block = [this](const char *name, unsigned int binding) {
+            unsigned int index = glGetUniformBlockIndex(id, name);
+            if (index != GL_INVALID_INDEX)
+                glUniformBlockBinding(id, index, binding);
+        };
+        bind_block("Camera", camera_block_binding);
+        bind_block("Lights", lights_block_binding);
+    }
+
+    int ShaderProgram::location(std::string_view name) const {
+        auto it = uniforms.locations.find(name);
+        return it != uniforms.locations.end() ? it->second : -1;
+    }
+
+    int ShaderProgram::diffuse_sampler(unsigned int index) const {
+        return index < uniforms.diffuse_samplers.size() ? uniforms.diffuse_samplers[index] : -1;
+    }
+
+    int ShaderProgram::specular_sampler(unsigned int index) const {
+        return index < uniforms.specular_samplers.size() ? uniforms.specular_samplers[index] : -1;
+    }
+
+    void ShaderProgram::set_int(int location, int value) const {
+        glUniform1i(location, value);
+    }
+
+    void ShaderProgram::set_float(int location, float value) const {
+        glUniform1f(location, value);
+    }
+
+    void ShaderProgram::set_mat4(int location, const glm::mat4 &mat) const {
+        glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat));
+    }
+
+    void ShaderProgram::set_vec3(int location, const glm::vec3 &vec) const {
+        glUniform3f(location, vec.x, vec.y, vec.z);
     }
 
     void ShaderProgram::set_int(std::string_view name, int value) const {
-        glUniform1i(glGetUniformLocation(id, name.data()), value);
+        set_int(location(name), value);
     }
 
     void ShaderProgram::set_float(std::string_view name, float value) const {
-        glUniform1f(glGetUniformLocation(id, name.data()), value);
+        set_float(location(name), value);
     }
 
     void ShaderProgram::set_bool(std::string_view name, bool value) const {
-        glUniform1i(glGetUniformLocation(id, name.data()), (int) value);
+        set_int(location(name), (int) value);
     }
 
     void ShaderProgram::set_mat4(std::string_view name, const glm::mat4 &mat) const {
-        glUniformMatrix4fv(glGetUniformLocation(id, name.data()), 1, GL_FALSE, glm::value_ptr(mat));
+        set_mat4(location(name), mat);
     }
 
     void ShaderProgram::set_vec3(std::string_view name, float x, float y, float z) const {
-        glUniform3f(glGetUniformLocation(id, name.data()), x, y, z);
+        set_vec3(location(name), glm::vec3(x, y, z));
     }
 
     void ShaderProgram::set_vec3(std::string_view name, const glm::vec3 &vec) const {
-        glUniform3f(glGetUniformLocation(id, name.data()), vec.x, vec.y, vec.z);
+        set_vec3(location(name), vec);
     }
 
     Shader::Shader(Shader::Type type) {
@@ -72,42 +153,12 @@ namespace render {
     ShaderProgram::ShaderProgram(ShaderProgram &&other) noexcept {
         id = other.id;
         other.id = 0;
+        uniforms = std::move(other.uniforms);
     }
 
     ShaderProgram &ShaderProgram::operator=(ShaderProgram &&other) noexcept {
         std::swap(id, other.id);
+        std::swap(uniforms, other.uniforms);
         return *this;
     }
-
-    void ShaderProgram::set_dir_light(int index, const DirLight &dir_light) const {
-        set_vec3("dir_lights[" + std::to_string(index) + "].direction", dir_light.direction);
-        set_vec3("dir_lights[" + std::to_string(index) + "].ambient", dir_light.ambient);
-        set_vec3("dir_lights[" + std::to_string(index) + "].diffuse", dir_light.diffuse);
-        set_vec3("dir_lights[" + std::to_string(index) + "].specular", dir_light.specular);
-    }
-
-    void ShaderProgram::set_point_light(int index, const glm::vec3 &position, const PointLight &point_light) const {
-        set_vec3("point_lights[" + std::to_string(index) + "].position", position);
-        set_float("point_lights[" + std::to_string(index) + "].constant", point_light.constant);
-        set_float("point_lights[" + std::to_string(index) + "].linear", point_light.linear);
-        set_float("point_lights[" + std::to_string(index) + "].quadratic", point_light.quadratic);
-        set_vec3("point_lights[" + std::to_string(index) + "].ambient", point_light.ambient);
-        set_vec3("point_lights[" + std::to_string(index) + "].diffuse", point_light.diffuse);
-        set_vec3("point_lights[" + std::to_string(index) + "].specular", point_light.specular);
-    }
-
-    void ShaderProgram::set_spot_light(int index, const glm::vec3 &position, const SpotLight &spot_light) const {
-        set_vec3("spot_lights[" + std::to_string(index) + "].position", position);
-        set_vec3("spot_lights[" + std::to_string(index) + "].direction", spot_light.direction);
-        set_float("spot_lights[" + std::to_string(index) + "].cutOff", spot_light.cutOff);
-        set_float("spot_lights[" + std::to_string(index) + "].outerCutOff", spot_light.outerCutOff);
-        set_float("spot_lights[" + std::to_string(index) + "].constant", spot_light.constant);
-        set_float("spot_lights[" + std::to_string(index) + "].linear", spot_light.linear);
-        set_float("spot_lights[" + std::to_string(index) + "].quadratic", spot_light.quadratic);
-        set_vec3("spot_lights[" + std::to_string(index) + "].ambient", spot_light.ambient);
-        set_vec3("spot_lights[" + std::to_string(index) + "].diffuse", spot_light.diffuse);
-        set_vec3("spot_lights[" + std::to_string(index) + "].specular", spot_light.specular);
-    }
-
-
 }
\ No newline at end of file
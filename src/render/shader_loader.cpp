@@ -12,12 +12,6 @@ namespace render {
     class ShaderLoader::Impl {
     public:
 
-        ~Impl() {
-            foreach(program_handle_manager, [](ShaderProgram *program) {
-                delete program;
-            });
-        }
-
         [[nodiscard]] tl::expected<Shader, std::string>
         load_shader_from_file(fs::path &path, Shader::Type type) {
 
@@ -44,46 +38,42 @@ namespace render {
 
         [[nodiscard]] tl::expected<Handle<ShaderProgram>, std::string>
         create_program(const std::vector<ShaderPath> &paths) {
-            auto shader_program = std::make_unique<ShaderProgram>();
+            ShaderProgram shader_program;
 
             std::vector<Shader> shaders;
             for (auto path : paths) {
                 if (auto result = load_shader_from_file(path.path, path.texture_type)) {
                     Shader &shader = result.value();
-                    glAttachShader(shader_program->id, shader.id);
+                    glAttachShader(shader_program.id, shader.id);
                     shaders.push_back(std::move(shader));
                 }
                 else return tl::make_unexpected(result.error());
             }
 
-            glLinkProgram(shader_program->id);
+            glLinkProgram(shader_program.id);
             int success;
-            glGetProgramiv(shader_program->id, GL_LINK_STATUS, &success);
+            glGetProgramiv(shader_program.id, GL_LINK_STATUS, &success);
             if (!success) {
                 char info_log[512];
-                glGetProgramInfoLog(shader_program->id, sizeof(info_log), nullptr, info_log);
+                glGetProgramInfoLog(shader_program.id, sizeof(info_log), nullptr, info_log);
                 return tl::make_unexpected(std::string(info_log));
             }
+            shader_program.reflect();
 
-            auto handle = program_handle_manager.insert(shader_program.release());
-            return handle;
+            return programs.insert(std::move(shader_program));
         }
 
 
-        ShaderProgram *get_shader_program(Handle<ShaderProgram> handle) const {
-            return program_handle_manager.get(handle);
+        ShaderProgram *get_shader_program(Handle<ShaderProgram> handle) {
+            return programs.get(handle);
         }
 
         bool unload_shader_program(Handle<ShaderProgram> handle) {
-            if (auto *program = program_handle_manager.erase(handle)) {
-                delete program;
-                return true;
-            }
-            return false;
+            return programs.erase(handle).has_value();
         }
 
     private:
-        HandleManager<ShaderProgram> program_handle_manager;
+        SlotMap<ShaderProgram> programs;
     };
 
     ShaderProgram *ShaderLoader::get_shader_program(Handle<ShaderProgram> handle) const {
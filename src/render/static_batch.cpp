@@ -0,0 +1,278 @@
+#include "render/static_batch.h"
+#include "render/render_system.h"
+#include "common/slot_map.h"
+#include "common/trace.h"
+
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+
+namespace render {
+    static constexpr float default_cluster_size = 32.0f;
+
+    namespace {
+        struct ClusterKey {
+            uint64_t shader;
+            uint32_t texture_set;
+            glm::ivec3 cell;
+
+            bool operator<(const ClusterKey &other) const {
+                return std::tie(shader, texture_set, cell.x, cell.y, cell.z) <
+                       std::tie(other.shader, other.texture_set, other.cell.x, other.cell.y, other.cell.z);
+            }
+        };
+
+        struct Member {
+            uint64_t entity;
+            uint32_t mesh; // index in Model::meshes
+        };
+
+        struct Cluster {
+            std::vector<Member> members;
+            std::vector<Handle<Texture2d>> textures;
+            Handle<StaticCluster> built{.raw = UINT64_MAX};
+            bool dirty = false;
+        };
+
+        struct TrackedEntity {
+            Handle<Model> model;
+            Handle<ShaderProgram> shader;
+            glm::mat4 transform;
+            std::vector<ClusterKey> clusters; // one per mesh
+            uint64_t seen; // last update
+        };
+    }
+
+    static uint64_t entity_key(ecs::Entity entity) {
+        return (uint64_t) entity.id << 32 | entity.version;
+    }
+
+    class StaticBatch::Impl {
+    public:
+        explicit Impl(MeshPool &mesh_pool) : mesh_pool(mesh_pool) {}
+
+        ~Impl() {
+            for (const auto &cluster : built)
+                mesh_pool.remove(cluster.geometry);
+        }
+
+        void set_cluster_size(float size) {
+            cluster_size = size;
+            rebuild_all = true;
+        }
+
+        void update(const ecs::Entities &entities, const ModelLoader &model_loader) {
+            HS_ZONE("render::StaticBatch::update");
+            ++frame;
+            rebuilt = 0;
+            if (rebuild_all) {
+                // Entities are added again below, with the new cells
+                for (auto &[key, entity] : tracked)
+                    remove_from_clusters(key, entity);
+                tracked.clear();
+                rebuild_all = false;
+            }
+
+            entities.foreach([&](ecs::Entity entity, const Transform &transform, const MeshRenderer &renderer,
+                                 const Static &, const Translucent *translucent) {
+                if (translucent)
+                    return; // must be sorted with other translucent entities, see RenderSystem
+                uint64_t key = entity_key(entity);
+                auto it = tracked.find(key);
+                if (it != tracked.end()) {
+                    if (it->second.model.raw == renderer.model_handle.raw &&
+                        it->second.shader.raw == renderer.shader_program_handle.raw) {
+                        it->second.seen = frame;
+                        return;
+                    }
+                    remove_from_clusters(key, it->second); // the renderer was changed
+                    tracked.erase(it);
+                }
+
+                if (model_loader.get_state(renderer.model_handle) == ResourceState::ready)
+                    add(key, renderer, local_to_world(transform), *model_loader.get_model(renderer.model_handle));
+            });
+
+            for (auto it = tracked.begin(); it != tracked.end();) {
+                if (it->second.seen != frame) {
+                    remove_from_clusters(it->first, it->second); // destroyed or untagged
+                    it = tracked.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+
+            for (auto it = clusters.begin(); it != clusters.end();) {
+                if (it->second.dirty)
+                    rebuild(it->second, it->first, model_loader);
+                if (it->second.members.empty())
+                    it = clusters.erase(it);
+                else
+                    ++it;
+            }
+        }
+
+        std::span<const StaticCluster> get_clusters() const {
+            return {built.begin(), built.end()};
+        }
+
+        StaticBatchStats stats() const {
+            return StaticBatchStats{
+                    .entities = tracked.size(),
+                    .clusters = built.size(),
+                    .rebuilt_clusters = rebuilt
+            };
+        }
+
+    private:
+        MeshPool &mesh_pool;
+        float cluster_size = default_cluster_size;
+        bool rebuild_all = false;
+        uint64_t frame = 0;
+        std::size_t rebuilt = 0;
+
+        std::unordered_map<uint64_t, TrackedEntity> tracked; // by entity_key
+        std::map<ClusterKey, Cluster> clusters;
+        std::map<std::vector<uint64_t>, uint32_t> texture_sets; // raw handles -> id
+        SlotMap<StaticCluster> built;
+
+        uint32_t texture_set(const std::vector<Handle<Texture2d>> &textures) {
+            std::vector<uint64_t> raw(textures.size());
+            for (std::size_t i = 0; i < textures.size(); ++i)
+                raw[i] = textures[i].raw;
+            return texture_sets.try_emplace(std::move(raw), (uint32_t) texture_sets.size()).first->second;
+        }
+
+        void add(uint64_t key, const MeshRenderer &renderer, const glm::mat4 &transform, const Model &model) {
+            TrackedEntity entity{
+                    .model = renderer.model_handle,
+                    .shader = renderer.shader_program_handle,
+                    .transform = transform,
+                    .seen = frame
+            };
+            glm::ivec3 cell(glm::floor(glm::vec3(transform[3]) / cluster_size));
+            for (uint32_t i = 0; i < model.meshes.size(); ++i) {
+                ClusterKey cluster_key{renderer.shader_program_handle.raw, texture_set(model.meshes[i].textures), cell};
+                Cluster &cluster = clusters[cluster_key];
+                if (cluster.members.empty())
+                    cluster.textures = model.meshes[i].textures;
+                cluster.members.push_back(Member{key, i});
+                cluster.dirty = true;
+                entity.clusters.push_back(cluster_key);
+            }
+            tracked.emplace(key, std::move(entity));
+        }
+
+        void remove_from_clusters(uint64_t key, const TrackedEntity &entity) {
+            for (const auto &cluster_key : entity.clusters) {
+                Cluster &cluster = clusters[cluster_key];
+                std::erase_if(cluster.members, [key](const Member &member) { return member.entity == key; });
+                cluster.dirty = true;
+            }
+        }
+
+        /**
+         * Merges the meshes of the members in world space and replaces the geometry of the cluster.
+         */
+        void rebuild(Cluster &cluster, const ClusterKey &key, const ModelLoader &model_loader) {
+            HS_ZONE("render::StaticBatch::rebuild");
+            cluster.dirty = false;
+            ++rebuilt;
+
+            std::vector<Vertex> vertices;
+            std::vector<unsigned int> indices;
+            std::vector<std::byte> storage;
+            glm::vec3 min(INFINITY), max(-INFINITY);
+            for (const Member &member : cluster.members) {
+                const TrackedEntity &entity = tracked.at(member.entity);
+                const Model *model = model_loader.get_model(entity.model);
+                if (!model || member.mesh >= model->meshes.size())
+                    continue; // unloaded meanwhile
+
+                const Mesh &mesh = model->meshes[member.mesh];
+                std::optional<MeshData> data;
+                if (member.mesh < model->geometry.meshes.size())
+                    data = model->geometry.meshes[member.mesh];
+                else
+                    data = mesh_pool.read(mesh.geometry, storage);
+                if (!data)
+                    continue;
+
+                auto base = (unsigned int) vertices.size();
+                const glm::mat3 rotation(entity.transform); // Transform has no scale
+                for (Vertex vertex : decode_vertices(data->vertices, data->vertex_format, mesh.dequantization)) {
+                    vertex.position = glm::vec3(entity.transform * glm::vec4(vertex.position, 1.0f));
+                    vertex.normal = rotation * vertex.normal;
+                    min = glm::min(min, vertex.position);
+                    max = glm::max(max, vertex.position);
+                    vertices.push_back(vertex);
+                }
+
+                const std::byte *in = data->indices.data();
+                for (std::size_t i = 0; i < data->indices_count(); ++i) {
+                    uint32_t index = 0;
+                    if (data->index_size == sizeof(uint16_t)) {
+                        uint16_t index16;
+                        std::memcpy(&index16, in + i * sizeof(uint16_t), sizeof(uint16_t));
+                        index = index16;
+                    } else {
+                        std::memcpy(&index, in + i * sizeof(uint32_t), sizeof(uint32_t));
+                    }
+                    indices.push_back(base + index);
+                }
+            }
+
+            if (StaticCluster *old = built.get(cluster.built)) {
+                mesh_pool.remove(old->geometry);
+                built.erase(cluster.built);
+                cluster.built.raw = UINT64_MAX;
+            }
+            if (indices.empty())
+                return;
+
+            EncodedVertices encoded = encode_vertices(vertices, VertexQuantization{});
+            std::vector<std::byte> packed = pack_indices(indices, index_size(vertices.size()));
+            MeshData merged;
+            merged.vertices = encoded.data;
+            merged.vertex_format = encoded.format;
+            merged.dequantization = encoded.dequantization;
+            merged.indices = packed;
+            merged.index_size = index_size(vertices.size());
+
+            cluster.built = built.insert(StaticCluster{
+                    .shader = Handle<ShaderProgram>{.raw = key.shader},
+                    .textures = cluster.textures,
+                    .geometry = mesh_pool.add(merged),
+                    .dequantization = encoded.dequantization,
+                    .min = min,
+                    .max = max
+            });
+        }
+    };
+
+    StaticBatch::StaticBatch(MeshPool &mesh_pool) {
+        impl = new Impl(mesh_pool);
+    }
+
+    StaticBatch::~StaticBatch() {
+        delete impl;
+    }
+
+    void StaticBatch::set_cluster_size(float size) {
+        impl->set_cluster_size(size);
+    }
+
+    void StaticBatch::update(const ecs::Entities &entities, const ModelLoader &model_loader) {
+        impl->update(entities, model_loader);
+    }
+
+    std::span<const StaticCluster> StaticBatch::clusters() const {
+        return impl->get_clusters();
+    }
+
+    StaticBatchStats StaticBatch::stats() const {
+        return impl->stats();
+    }
+}
@@ -0,0 +1,52 @@
+#include "render/stream_buffer.h"
+#include "common/trace.h"
+
+#include <bit>
+#include <cstring>
+
+#include <glad/glad.h>
+
+namespace render {
+    StreamBuffer::StreamBuffer(GLStateCache &gl_state, unsigned int target, std::size_t capacity)
+            : gl_state(gl_state), target(target), buffer_size(capacity) {
+        glGenBuffers(1, &buffer);
+        orphan();
+    }
+
+    StreamBuffer::~StreamBuffer() {
+        gl_state.delete_buffer(buffer);
+    }
+
+    std::size_t StreamBuffer::write(const void *data, std::size_t bytes, std::size_t alignment) {
+        HS_ZONE("render::StreamBuffer::write");
+        gl_state.bind_buffer(target, buffer);
+        std::size_t offset = (head + alignment - 1) & ~(alignment - 1);
+        if (offset + bytes > buffer_size) {
+            // With headroom, so that growing writes do not reallocate every time
+            if (bytes > buffer_size)
+                buffer_size = std::bit_ceil(2 * bytes);
+            orphan();
+            offset = 0;
+        }
+        if (bytes == 0)
+            return offset;
+
+        void *mapped = glMapBufferRange(target, (GLintptr) offset, (GLsizeiptr) bytes,
+                                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (mapped) {
+            std::memcpy(mapped, data, bytes);
+            glUnmapBuffer(target);
+        } else {
+            glBufferSubData(target, (GLintptr) offset, (GLsizeiptr) bytes, data);
+        }
+        head = offset + bytes;
+        return offset;
+    }
+
+    void StreamBuffer::orphan() {
+        // Draws in flight keep the old storage, the driver allocates a new one
+        gl_state.bind_buffer(target, buffer);
+        glBufferData(target, (GLsizeiptr) buffer_size, nullptr, GL_STREAM_DRAW);
+        head = 0;
+    }
+}
@@ -0,0 +1,397 @@
+#include "render/texture_cooker.h"
+#include "render/cooked_file.h"
+#include "common/mapped_file.h"
+#include "common/trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace render {
+    namespace {
+        constexpr char magic[4] = {'H', 'S', 'T', 'X'};
+        constexpr uint32_t format_version = 2;
+        constexpr uint64_t data_alignment = 4096;
+        constexpr uint32_t max_levels = 32;
+
+        struct Header {
+            char magic[4];
+            uint32_t version;
+            uint64_t source_key;
+            uint32_t format;
+            uint32_t width;
+            uint32_t height;
+            uint32_t levels_count;
+        };
+
+        struct LevelRecord {
+            uint64_t offset;
+            uint64_t size;
+        };
+
+        struct Image {
+            uint32_t width;
+            uint32_t height;
+            std::vector<uint8_t> rgba;
+        };
+    }
+
+    std::size_t block_size(TextureFormat format) {
+        return format == TextureFormat::bc1 ? 8 : 16;
+    }
+
+    static uint32_t mip_extent(uint32_t extent, uint32_t level) {
+        return std::max(1u, extent >> level);
+    }
+
+    static std::size_t level_size(TextureFormat format, uint32_t width, uint32_t height) {
+        return (std::size_t) ((width + 3) / 4) * ((height + 3) / 4) * block_size(format);
+    }
+
+    static uint32_t levels_count(uint32_t width, uint32_t height) {
+        uint32_t levels = 1;
+        while ((width | height) >> levels)
+            ++levels;
+        return levels;
+    }
+
+    // Mip generation
+
+    static uint32_t rows_grain(uint32_t row_bytes) {
+        return std::max(1u, (64u << 10) / std::max(1u, row_bytes));
+    }
+
+    static uint8_t avg(uint8_t a, uint8_t b) {
+        return (uint8_t) ((a + b + 1) >> 1);
+    }
+
+    /**
+     * 2x2 box filter, edges of odd sizes are clamped.
+     * Rounds like pavgb of pavgb, so both paths give the same result.
+     */
+    static Image downsample(const Image &src, bool simd, ecs::Jobs &jobs) {
+        Image dst{mip_extent(src.width, 1), mip_extent(src.height, 1), {}};
+        dst.rgba.resize((std::size_t) dst.width * dst.height * 4);
+
+        jobs.parallel_for(0, dst.height, rows_grain(dst.width * 4), [&](uint32_t begin, uint32_t end) {
+            for (uint32_t y = begin; y < end; ++y) {
+                const uint8_t *row0 = &src.rgba[(std::size_t) std::min(2 * y, src.height - 1) * src.width * 4];
+                const uint8_t *row1 = &src.rgba[(std::size_t) std::min(2 * y + 1, src.height - 1) * src.width * 4];
+                uint8_t *out = &dst.rgba[(std::size_t) y * dst.width * 4];
+
+                uint32_t x = 0;
+#if defined(__SSE2__)
+                // 8 source pixels of both rows -> 4 output pixels
+                if (simd && src.width % 2 == 0) {
+                    for (; x + 4 <= dst.width; x += 4) {
+                        __m128i a0 = _mm_loadu_si128((const __m128i *) (row0 + x * 8));
+                        __m128i a1 = _mm_loadu_si128((const __m128i *) (row0 + x * 8 + 16));
+                        __m128i b0 = _mm_loadu_si128((const __m128i *) (row1 + x * 8));
+                        __m128i b1 = _mm_loadu_si128((const __m128i *) (row1 + x * 8 + 16));
+                        __m128 v0 = _mm_castsi128_ps(_mm_avg_epu8(a0, b0));
+                        __m128 v1 = _mm_castsi128_ps(_mm_avg_epu8(a1, b1));
+                        __m128i even = _mm_castps_si128(_mm_shuffle_ps(v0, v1, _MM_SHUFFLE(2, 0, 2, 0)));
+                        __m128i odd = _mm_castps_si128(_mm_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 1, 3, 1)));
+                        _mm_storeu_si128((__m128i *) (out + x * 4), _mm_avg_epu8(even, odd));
+                    }
+                }
+#endif
+                for (; x < dst.width; ++x) {
+                    uint32_t x0 = std::min(2 * x, src.width - 1) * 4;
+                    uint32_t x1 = std::min(2 * x + 1, src.width - 1) * 4;
+                    for (uint32_t c = 0; c < 4; ++c)
+                        out[x * 4 + c] = avg(avg(row0[x0 + c], row1[x0 + c]), avg(row0[x1 + c], row1[x1 + c]));
+                }
+            }
+        });
+        return dst;
+    }
+
+    std::vector<uint8_t> detail::downsample(std::span<const uint8_t> rgba, uint32_t width, uint32_t height, bool simd,
+                                            ecs::Jobs &jobs) {
+        Image src{width, height, std::vector<uint8_t>(rgba.begin(), rgba.end())};
+        return render::downsample(src, simd, jobs).rgba;
+    }
+
+    // Block compression
+
+    static uint16_t pack_565(const float color[3]) {
+        auto quantize = [](float value, int max) {
+            return (uint16_t) std::lround(std::clamp(value, 0.0f, 255.0f) * (float) max / 255.0f);
+        };
+        return (uint16_t) (quantize(color[0], 31) << 11 | quantize(color[1], 63) << 5 | quantize(color[2], 31));
+    }
+
+    static void unpack_565(uint16_t packed, int color[3]) {
+        int r = packed >> 11 & 31, g = packed >> 5 & 63, b = packed & 31;
+        color[0] = r << 3 | r >> 2;
+        color[1] = g << 2 | g >> 4;
+        color[2] = b << 3 | b >> 2;
+    }
+
+    /**
+     * Endpoints are the extremes of the pixels along their principal axis.
+     * Always four color mode, as BC3 requires.
+     */
+    static void encode_color_block(const uint8_t block[16][4], uint8_t *out) {
+        float mean[3] = {};
+        for (int i = 0; i < 16; ++i)
+            for (int c = 0; c < 3; ++c)
+                mean[c] += block[i][c] / 16.0f;
+
+        float cov[6] = {}; // rr rg rb gg gb bb
+        for (int i = 0; i < 16; ++i) {
+            float r = block[i][0] - mean[0], g = block[i][1] - mean[1], b = block[i][2] - mean[2];
+            cov[0] += r * r, cov[1] += r * g, cov[2] += r * b;
+            cov[3] += g * g, cov[4] += g * b, cov[5] += b * b;
+        }
+
+        // Power iteration, from the covariance column of the channel which varies most. A fixed start such as
+        // (1, 1, 1) is orthogonal to the axis of anticorrelated channels, and the block would collapse to its mean
+        int start = cov[0] >= cov[3] && cov[0] >= cov[5] ? 0 : cov[3] >= cov[5] ? 1 : 2;
+        const int column[3][3] = {{0, 1, 2}, {1, 3, 4}, {2, 4, 5}};
+        float axis[3] = {cov[column[start][0]], cov[column[start][1]], cov[column[start][2]]};
+        if (std::max({std::abs(axis[0]), std::abs(axis[1]), std::abs(axis[2])}) < 1e-6f)
+            axis[0] = axis[1] = axis[2] = 1.0f; // solid block
+        for (int iteration = 0; iteration < 8; ++iteration) {
+            float next[3] = {
+                    cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+                    cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+                    cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2],
+            };
+            float len = std::max({std::abs(next[0]), std::abs(next[1]), std::abs(next[2])});
+            if (len < 1e-6f)
+                break;
+            for (int c = 0; c < 3; ++c)
+                axis[c] = next[c] / len;
+        }
+
+        float axis_len2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+        float min_t = 0.0f, max_t = 0.0f;
+        for (int i = 0; i < 16; ++i) {
+            float t = ((block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] +
+                       (block[i][2] - mean[2]) * axis[2]) / axis_len2;
+            min_t = std::min(min_t, t);
+            max_t = std::max(max_t, t);
+        }
+
+        float end0[3], end1[3];
+        for (int c = 0; c < 3; ++c) {
+            end0[c] = mean[c] + axis[c] * max_t;
+            end1[c] = mean[c] + axis[c] * min_t;
+        }
+        uint16_t c0 = pack_565(end0), c1 = pack_565(end1);
+        if (c0 < c1)
+            std::swap(c0, c1);
+
+        uint32_t indices = 0;
+        if (c0 != c1) {
+            int palette[4][3];
+            unpack_565(c0, palette[0]);
+            unpack_565(c1, palette[1]);
+            for (int c = 0; c < 3; ++c) {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+
+            for (int i = 0; i < 16; ++i) {
+                int best = 0, best_dist = INT32_MAX;
+                for (int p = 0; p < 4; ++p) {
+                    int dr = block[i][0] - palette[p][0], dg = block[i][1] - palette[p][1], db = block[i][2] - palette[p][2];
+                    int dist = dr * dr + dg * dg + db * db;
+                    if (dist < best_dist)
+                        best = p, best_dist = dist;
+                }
+                indices |= (uint32_t) best << (2 * i);
+            }
+        }
+
+        std::memcpy(out, &c0, 2);
+        std::memcpy(out + 2, &c1, 2);
+        std::memcpy(out + 4, &indices, 4);
+    }
+
+    /**
+     * BC4 block of a single channel, eight values mode.
+     */
+    static void encode_channel_block(const uint8_t block[16][4], int channel, uint8_t *out) {
+        int max = 0, min = 255;
+        for (int i = 0; i < 16; ++i) {
+            max = std::max<int>(max, block[i][channel]);
+            min = std::min<int>(min, block[i][channel]);
+        }
+
+        uint64_t indices = 0;
+        if (max != min) {
+            int values[8] = {max, min};
+            for (int v = 2; v < 8; ++v)
+                values[v] = ((8 - v) * max + (v - 1) * min) / 7;
+
+            for (int i = 0; i < 16; ++i) {
+                int best = 0, best_dist = INT32_MAX;
+                for (int v = 0; v < 8; ++v) {
+                    int dist = std::abs(block[i][channel] - values[v]);
+                    if (dist < best_dist)
+                        best = v, best_dist = dist;
+                }
+                indices |= (uint64_t) best << (3 * i);
+            }
+        }
+
+        out[0] = (uint8_t) max;
+        out[1] = (uint8_t) min;
+        for (int b = 0; b < 6; ++b)
+            out[2 + b] = (uint8_t) (indices >> (8 * b));
+    }
+
+    static void compress(const Image &image, TextureFormat format, std::byte *out, ecs::Jobs &jobs) {
+        uint32_t blocks_x = (image.width + 3) / 4;
+        uint32_t blocks_y = (image.height + 3) / 4;
+        std::size_t block_bytes = block_size(format);
+
+        jobs.parallel_for(0, blocks_y, rows_grain(blocks_x * 64), [&](uint32_t begin, uint32_t end) {
+            uint8_t block[16][4];
+            for (uint32_t by = begin; by < end; ++by) {
+                for (uint32_t bx = 0; bx < blocks_x; ++bx) {
+                    // Blocks crossing the edge repeat the last row and column
+                    for (uint32_t i = 0; i < 16; ++i) {
+                        uint32_t x = std::min(bx * 4 + i % 4, image.width - 1);
+                        uint32_t y = std::min(by * 4 + i / 4, image.height - 1);
+                        std::memcpy(block[i], &image.rgba[((std::size_t) y * image.width + x) * 4], 4);
+                    }
+
+                    auto dst = reinterpret_cast<uint8_t *>(out + ((std::size_t) by * blocks_x + bx) * block_bytes);
+                    switch (format) {
+                        case TextureFormat::bc1:
+                            encode_color_block(block, dst);
+                            break;
+                        case TextureFormat::bc3:
+                            encode_channel_block(block, 3, dst);
+                            encode_color_block(block, dst + 8);
+                            break;
+                        case TextureFormat::bc5:
+                            encode_channel_block(block, 0, dst);
+                            encode_channel_block(block, 1, dst + 8);
+                            break;
+                    }
+                }
+            }
+        });
+    }
+
+    CookedTexture cook_texture(const uint8_t *pixels, uint32_t width, uint32_t height, int channels, ecs::Jobs &jobs) {
+        HS_ZONE("render::cook_texture");
+        Image image{width, height, {}};
+        image.rgba.resize((std::size_t) width * height * 4);
+        bool opaque = true;
+        for (std::size_t i = 0; i < (std::size_t) width * height; ++i) {
+            const uint8_t *src = pixels + i * channels;
+            uint8_t *dst = &image.rgba[i * 4];
+            switch (channels) {
+                case 1: dst[0] = dst[1] = dst[2] = src[0], dst[3] = 255; break;
+                case 2: dst[0] = src[0], dst[1] = src[1], dst[2] = 0, dst[3] = 255; break;
+                case 3: dst[0] = src[0], dst[1] = src[1], dst[2] = src[2], dst[3] = 255; break;
+                default: std::memcpy(dst, src, 4), opaque &= src[3] == 255; break;
+            }
+        }
+
+        CookedTexture result;
+        result.format = channels == 2 ? TextureFormat::bc5 : opaque ? TextureFormat::bc1 : TextureFormat::bc3;
+        result.width = width;
+        result.height = height;
+
+        uint32_t levels = levels_count(width, height);
+        std::vector<std::size_t> offsets(levels + 1, 0);
+        for (uint32_t level = 0; level < levels; ++level)
+            offsets[level + 1] = offsets[level] + level_size(result.format, mip_extent(width, level),
+                                                            mip_extent(height, level));
+
+        auto storage = std::make_shared<std::vector<std::byte>>(offsets[levels]);
+        for (uint32_t level = 0; level < levels; ++level) {
+            if (level > 0)
+                image = downsample(image, true, jobs);
+            compress(image, result.format, storage->data() + offsets[level], jobs);
+            result.levels.emplace_back(storage->data() + offsets[level], offsets[level + 1] - offsets[level]);
+        }
+        result.storage = std::move(storage);
+        return result;
+    }
+
+    // Cache
+
+    TextureCache::TextureCache(fs::path directory) : dir(std::move(directory)) {}
+
+    std::optional<CookedTexture> TextureCache::load(const fs::path &source) const {
+        HS_ZONE("render::TextureCache::load");
+        auto key = source_key(source);
+        if (!key)
+            return std::nullopt;
+
+        auto file = MappedFile::open(cooked_path(dir, *key, ".hstex"));
+        if (!file || file->size() < sizeof(Header))
+            return std::nullopt;
+
+        Header header;
+        std::memcpy(&header, file->data(), sizeof(Header));
+        if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != format_version ||
+            header.source_key != *key || header.format > (uint32_t) TextureFormat::bc5 ||
+            header.width == 0 || header.height == 0 ||
+            header.levels_count != levels_count(header.width, header.height) ||
+            file->size() < sizeof(Header) + header.levels_count * sizeof(LevelRecord))
+            return std::nullopt;
+
+        CookedTexture texture;
+        texture.format = (TextureFormat) header.format;
+        texture.width = header.width;
+        texture.height = header.height;
+        for (uint32_t level = 0; level < header.levels_count; ++level) {
+            LevelRecord record;
+            std::memcpy(&record, file->data() + sizeof(Header) + level * sizeof(LevelRecord), sizeof(LevelRecord));
+            std::size_t expected = level_size(texture.format, mip_extent(header.width, level),
+                                              mip_extent(header.height, level));
+            if (record.size != expected || record.offset > file->size() || record.size > file->size() - record.offset)
+                return std::nullopt;
+            texture.levels.emplace_back(file->data() + record.offset, record.size);
+        }
+
+        texture.storage = std::make_shared<MappedFile>(std::move(*file));
+        return texture;
+    }
+
+    tl::expected<void, std::string> TextureCache::store(const fs::path &source, const CookedTexture &texture) const {
+        HS_ZONE("render::TextureCache::store");
+        auto key = source_key(source);
+        if (!key)
+            return tl::make_unexpected("Failed to stat " + source.string());
+
+        Header header{};
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = format_version;
+        header.source_key = *key;
+        header.format = (uint32_t) texture.format;
+        header.width = texture.width;
+        header.height = texture.height;
+        header.levels_count = std::min((uint32_t) texture.levels.size(), max_levels);
+
+        std::vector<LevelRecord> records;
+        uint64_t offset = data_alignment;
+        for (uint32_t level = 0; level < header.levels_count; ++level) {
+            records.push_back(LevelRecord{offset, texture.levels[level].size()});
+            offset += texture.levels[level].size();
+        }
+
+        CookedFileWriter writer(cooked_path(dir, *key, ".hstex"));
+        writer.write(&header, sizeof(header));
+        writer.write(records.data(), records.size() * sizeof(LevelRecord));
+        writer.pad_to(data_alignment);
+        for (uint32_t level = 0; level < header.levels_count; ++level)
+            writer.write(texture.levels[level].data(), texture.levels[level].size());
+        return writer.commit();
+    }
+}
@@ -3,105 +3,307 @@
 #include <GLFW/glfw3.h>
 #include <stb_image.h>
 
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <optional>
 #include <unordered_map>
 #include <utility>
-#include "common/handle_manager.h"
+#include "common/trace.h"
+#include "render/cooked_file.h"
+#include "render/texture_cooker.h"
 
 namespace fs = std::filesystem;
 
+// S3TC is not core but is supported by all desktop drivers, glad is generated without the extension
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
 namespace render {
+    struct CookedImage {
+        Handle<Texture2d> handle;
+        Texture2d::Type type;
+        CookedTexture texture;
+    };
+
+    static tl::expected<CookedTexture, std::string> decode_image(const fs::path &path, ecs::Jobs &jobs) {
+        HS_ZONE("render::decode_image");
+        int width, height, nr_channels;
+        uint8_t *data = stbi_load(path.c_str(), &width, &height, &nr_channels, 0);
+        if (!data)
+            return tl::make_unexpected<std::string>("Failed to load image from path " + path.string());
+
+        CookedTexture texture = cook_texture(data, width, height, nr_channels, jobs);
+        stbi_image_free(data);
+        return texture;
+    }
+
+    static Texture2d upload_image(GLStateCache &gl_state, const CookedTexture &texture, Texture2d::Type type) {
+        HS_ZONE("render::upload_image");
+        Texture2d tex{};
+        tex.type = type;
+        glGenTextures(1, &tex.id);
+        gl_state.bind_texture(0, tex.id);
+
+        GLenum internal_format;
+        switch (texture.format) {
+            case TextureFormat::bc1: internal_format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT; break;
+            case TextureFormat::bc3: internal_format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
+            case TextureFormat::bc5: internal_format = GL_COMPRESSED_RG_RGTC2; break;
+        }
+
+        // Mips are cooked, the driver neither compresses nor generates them
+        for (std::size_t level = 0; level < texture.levels.size(); ++level) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, (GLint) level, internal_format,
+                                   (GLsizei) std::max(1u, texture.width >> level),
+                                   (GLsizei) std::max(1u, texture.height >> level), 0,
+                                   (GLsizei) texture.levels[level].size(), texture.levels[level].data());
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint) texture.levels.size() - 1);
+        return tex;
+    }
+
+    static Texture2d create_placeholder(GLStateCache &gl_state, Texture2d::Type type, uint8_t value) {
+        uint8_t pixel[4] = {value, value, value, 255};
+        Texture2d tex{};
+        tex.type = type;
+        glGenTextures(1, &tex.id);
+        gl_state.bind_texture(0, tex.id);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        return tex;
+    }
+
     class TextureLoader::Impl {
     public:
+        Impl(GLStateCache &gl_state, ecs::Jobs &jobs) : gl_state(gl_state), jobs(jobs) {
+            set_cache_directory(default_cache_directory());
+            placeholders[Texture2d::diffuse] = create_placeholder(gl_state, Texture2d::diffuse, 255);
+            placeholders[Texture2d::specular] = create_placeholder(gl_state, Texture2d::specular, 0);
+        }
+
         tl::expected<Handle<Texture2d>, std::string>
         load_from_file(fs::path path, Texture2d::Type type) {
+            HS_ZONE("render::TextureLoader::load_from_file");
 
             std::error_code ec;
             path = fs::canonical(path, ec);
             if (ec) return tl::make_unexpected<std::string>(ec.message());
 
-            auto handle_it = loaded_textures.find(fs::hash_value(path));
-            if (handle_it != loaded_textures.end() && handle_manager.get(handle_it->second))
-                return handle_it->second;
+            Handle<Texture2d> handle;
+            auto created = acquire(path, type, handle);
+            if (!created)
+                return tl::make_unexpected(created.error());
+            if (!*created)
+                return handle;
 
-            auto *tex = new Texture2d();
-            glGenTextures(1, &tex->id);
-            glBindTexture(GL_TEXTURE_2D, tex->id);
-            tex->type = type;
+            auto texture = read_texture(path);
+            if (!texture) {
+                std::lock_guard lock(mutex);
+                textures.erase(handle);
+                pending_types.erase(handle.index);
+                loaded_textures.erase(fs::hash_value(path));
+                return tl::make_unexpected(texture.error());
+            }
 
-            if (auto result = load_texture_stbi(path)) {}
-            else return tl::make_unexpected(result.error());
+            Texture2d tex = upload_image(gl_state, *texture, type);
 
-            auto handle = handle_manager.insert(tex);
-            loaded_textures[fs::hash_value(path)] = handle;
+            std::lock_guard lock(mutex);
+            textures.set_ready(handle, tex);
+            pending_types.erase(handle.index);
             return handle;
         }
 
-        Texture2d *get_texture(Handle<Texture2d> handle) const {
-            return handle_manager.get(handle);
+        tl::expected<Handle<Texture2d>, std::string>
+        load_from_file_async(fs::path path, Texture2d::Type type) {
+            std::error_code ec;
+            path = fs::canonical(path, ec);
+            if (ec) return tl::make_unexpected<std::string>(ec.message());
+
+            Handle<Texture2d> handle;
+            auto created = acquire(path, type, handle);
+            if (!created)
+                return tl::make_unexpected(created.error());
+            if (!*created)
+                return handle;
+
+            jobs.spawn_background(pending_jobs, [this, handle, type, path = std::move(path)] {
+                auto texture = read_texture(path);
+
+                std::lock_guard lock(mutex);
+                if (texture) {
+                    cooked.push_back(CookedImage{handle, type, std::move(*texture)});
+                } else {
+                    textures.set_failed(handle);
+                }
+            });
+            return handle;
         }
 
-        bool unload_texture(Handle<Texture2d> handle) {
-            if (Texture2d *tex = handle_manager.erase(handle)) {
-                handle_manager.erase(handle);
-                glDeleteTextures(1, &tex->id);
-                delete tex;
-                return true;
+        void upload_pending(UploadScope &scope) {
+            while (!scope.exhausted()) {
+                CookedImage image;
+                {
+                    std::lock_guard lock(mutex);
+                    if (cooked.empty())
+                        return;
+                    image = std::move(cooked.front());
+                    cooked.pop_front();
+                }
+
+                // The texture might have been unloaded while decoding
+                if (textures.state(image.handle) == ResourceState::loading) {
+                    Texture2d tex = upload_image(gl_state, image.texture, image.type);
+                    std::lock_guard lock(mutex);
+                    textures.set_ready(image.handle, tex);
+                    pending_types.erase(image.handle.index);
+                }
+
+                std::size_t bytes = 0;
+                for (auto level : image.texture.levels)
+                    bytes += level.size();
+                scope.spend(bytes);
             }
+        }
+
+        void set_cache_directory(const fs::path &directory) {
+            if (directory.empty())
+                cache.reset();
+            else
+                cache.emplace(directory);
+        }
+
+        Texture2d *get_texture(Handle<Texture2d> handle) {
+            if (Texture2d *tex = textures.get(handle))
+                return tex;
+            if (!textures.is_valid(handle))
+                return nullptr;
+
+            std::lock_guard lock(mutex);
+            auto type_it = pending_types.find(handle.index);
+            return &placeholders[type_it != pending_types.end() ? type_it->second : Texture2d::diffuse];
+        }
+
+        ResourceState get_state(Handle<Texture2d> handle) const {
+            return textures.state(handle);
+        }
+
+        bool unload_texture(Handle<Texture2d> handle) {
+            std::lock_guard lock(mutex);
+            if (!textures.is_valid(handle))
+                return false;
+
+            if (auto tex = textures.erase(handle))
+                gl_state.delete_texture(tex->id);
+            pending_types.erase(handle.index);
             return true;
         }
 
         ~Impl() {
-            foreach(handle_manager, [](Texture2d *tex) {
-                glDeleteTextures(1, &tex->id);
-                delete tex;
+            jobs.wait(pending_jobs);
+
+            textures.foreach([this](Handle<Texture2d>, Texture2d &tex) {
+                gl_state.delete_texture(tex.id);
             });
+            for (auto &placeholder : placeholders)
+                gl_state.delete_texture(placeholder.id);
         }
 
     private:
-        static tl::expected<void, std::string> load_texture_stbi(const fs::path &path) {
-            int width, height, nr_channels;
-            uint8_t *data = stbi_load(path.c_str(), &width, &height, &nr_channels, 0);
-
-            if (data) {
-                //   nr_channels   components                   OpenGL representation
-                //       1           grey                         GL_RED
-                //       2           grey, alpha                  GL_RG
-                //       3           red, green, blue             GL_RGB
-                //       4           red, green, blue, alpha      GL_RGBA
-                constexpr int pixel_format_mapping[] = {-1, GL_RED, GL_RG, GL_RGB, GL_RGBA};
-                int pixel_data_format = pixel_format_mapping[nr_channels];
-
-                glTexImage2D(GL_TEXTURE_2D, 0, GL_COMPRESSED_RGB, width, height, 0, pixel_data_format, GL_UNSIGNED_BYTE, data);
-                glGenerateMipmap(GL_TEXTURE_2D);
-            } else {
-                return tl::make_unexpected<std::string>("Failed to load image from path " + path.string());
+        /**
+         * Maps the cooked texture or decodes the image and cooks it.
+         */
+        tl::expected<CookedTexture, std::string> read_texture(const fs::path &path) {
+            if (cache) {
+                if (auto texture = cache->load(path))
+                    return std::move(*texture);
             }
-            stbi_image_free(data);
-            return {};
+
+            auto texture = decode_image(path, jobs);
+            if (texture && cache)
+                (void) cache->store(path, *texture); // the cache is best effort, the texture is loaded anyway
+            return texture;
         }
 
+        /**
+         * Finds the texture loaded from the path or creates a loading handle for it.
+         * @return true if the handle was created and the texture must be loaded,
+         * error if too many textures are loaded.
+         */
+        tl::expected<bool, std::string> acquire(const fs::path &path, Texture2d::Type type, Handle<Texture2d> &handle) {
+            std::lock_guard lock(mutex);
+            auto handle_it = loaded_textures.find(fs::hash_value(path));
+            if (handle_it != loaded_textures.end()) {
+                ResourceState state = textures.state(handle_it->second);
+                if (state == ResourceState::loading || state == ResourceState::ready) {
+                    handle = handle_it->second;
+                    return false;
+                }
+            }
+
+            handle = textures.create();
+            if (!textures.is_valid(handle))
+                return tl::make_unexpected<std::string>("Too many textures loaded");
+            loaded_textures[fs::hash_value(path)] = handle;
+            pending_types[handle.index] = type;
+            return true;
+        }
+
+        GLStateCache &gl_state;
+        ecs::Jobs &jobs;
+        ecs::JobCounter pending_jobs;
+
+        // Guards everything below but lock-free reads of textures
+        std::mutex mutex;
         std::unordered_map<std::size_t, Handle<Texture2d>> loaded_textures;
-        HandleManager<Texture2d> handle_manager;
+        std::unordered_map<uint32_t, Texture2d::Type> pending_types; // by handle index, until ready
+        std::deque<CookedImage> cooked;
+
+        ConcurrentHandleManager<Texture2d> textures;
+        Texture2d placeholders[2]{};
+
+        std::optional<TextureCache> cache;
     };
 
+    void TextureLoader::set_cache_directory(const std::filesystem::path &directory) {
+        impl->set_cache_directory(directory);
+    }
+
     tl::expected<Handle<Texture2d>, std::string>
     TextureLoader::load_from_file(std::filesystem::path path, Texture2d::Type type) {
         return impl->load_from_file(std::move(path), type);
     }
 
+    tl::expected<Handle<Texture2d>, std::string>
+    TextureLoader::load_from_file_async(std::filesystem::path path, Texture2d::Type type) {
+        return impl->load_from_file_async(std::move(path), type);
+    }
+
+    void TextureLoader::upload_pending(UploadScope &scope) {
+        impl->upload_pending(scope);
+    }
+
     Texture2d *TextureLoader::get_texture(Handle<Texture2d> handle) const {
         return impl->get_texture(handle);
     }
 
+    ResourceState TextureLoader::get_state(Handle<Texture2d> handle) const {
+        return impl->get_state(handle);
+    }
+
     bool TextureLoader::unload_texture(Handle<Texture2d> handle) {
         return impl->unload_texture(handle);
     }
 
-    TextureLoader::TextureLoader() {
-        impl = new Impl();
+    TextureLoader::TextureLoader(GLStateCache &gl_state, ecs::Jobs &jobs) {
+        impl = new Impl(gl_state, jobs);
     }
 
     TextureLoader::~TextureLoader() {
         delete impl;
     }
-}
\ No newline at end of file
+}
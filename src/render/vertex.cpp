@@ -0,0 +1,140 @@
+#include "render/vertex.h"
+#include "common/trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <glm/gtc/packing.hpp>
+
+namespace render {
+    static constexpr float max_quantized_position = 32767.0f;
+
+    static PositionDequantization position_dequantization(std::span<const Vertex> vertices) {
+        if (vertices.empty())
+            return {};
+
+        glm::vec3 min(INFINITY), max(-INFINITY);
+        for (const auto &vertex : vertices) {
+            min = glm::min(min, vertex.position);
+            max = glm::max(max, vertex.position);
+        }
+
+        float half_extent = std::max({max.x - min.x, max.y - min.y, max.z - min.z}) / 2.0f;
+        return PositionDequantization{
+                .offset = (min + max) / 2.0f,
+                .scale = half_extent > 0.0f ? half_extent / max_quantized_position : 1.0f
+        };
+    }
+
+    static glm::i16vec3 quantize_position(const glm::vec3 &position, const PositionDequantization &dequantization) {
+        glm::vec3 q = glm::round((position - dequantization.offset) / dequantization.scale);
+        q = glm::clamp(q, -max_quantized_position, max_quantized_position);
+        return glm::i16vec3(glm::isnan(q.x) ? 0 : q.x, glm::isnan(q.y) ? 0 : q.y, glm::isnan(q.z) ? 0 : q.z);
+    }
+
+    static uint32_t pack_normal(const glm::vec3 &normal) {
+        return glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
+    }
+
+    EncodedVertices encode_vertices(std::span<const Vertex> vertices, const VertexQuantization &tolerance) {
+        HS_ZONE("render::encode_vertices");
+        EncodedVertices result;
+        result.dequantization = position_dequantization(vertices);
+
+        // Largest error of each attribute in its compact format
+        float position_error = 0.0f, normal_error = 0.0f, tex_coords_error = 0.0f;
+        for (const auto &vertex : vertices) {
+            glm::vec3 position = result.dequantization.offset +
+                                 glm::vec3(quantize_position(vertex.position, result.dequantization)) *
+                                 result.dequantization.scale;
+            glm::vec3 normal = glm::vec3(glm::unpackSnorm3x10_1x2(pack_normal(vertex.normal)));
+            glm::vec2 tex_coords = glm::unpackHalf2x16(glm::packHalf2x16(vertex.tex_coords));
+
+            // NaN errors (e.g. of missing normals) keep the attribute as floats
+            auto accumulate = [](float &error, glm::vec3 delta) {
+                for (int c = 0; c < 3; ++c)
+                    error = std::isnan(delta[c]) ? INFINITY : std::max(error, std::abs(delta[c]));
+            };
+            accumulate(position_error, position - vertex.position);
+            accumulate(normal_error, normal - vertex.normal);
+            accumulate(tex_coords_error, glm::vec3(tex_coords - vertex.tex_coords, 0.0f));
+        }
+
+        float extent = result.dequantization.scale * max_quantized_position * 2.0f;
+        if (position_error <= tolerance.position_error * extent)
+            result.format.flags |= VertexFormat::quantized_positions;
+        else
+            result.dequantization = PositionDequantization{};
+        if (normal_error <= tolerance.normal_error)
+            result.format.flags |= VertexFormat::packed_normals;
+        if (tex_coords_error <= tolerance.tex_coords_error)
+            result.format.flags |= VertexFormat::half_tex_coords;
+
+        const VertexFormat format = result.format;
+        const uint32_t stride = format.stride();
+        result.data.resize(vertices.size() * stride);
+        for (std::size_t i = 0; i < vertices.size(); ++i) {
+            const Vertex &vertex = vertices[i];
+            std::byte *out = result.data.data() + i * stride;
+
+            if (format.flags & VertexFormat::quantized_positions) {
+                glm::i16vec3 position = quantize_position(vertex.position, result.dequantization);
+                std::memcpy(out, &position, sizeof(position)); // padding stays zero
+            } else {
+                std::memcpy(out, &vertex.position, sizeof(vertex.position));
+            }
+
+            if (format.flags & VertexFormat::packed_normals) {
+                uint32_t normal = pack_normal(vertex.normal);
+                std::memcpy(out + format.normal_offset(), &normal, sizeof(normal));
+            } else {
+                std::memcpy(out + format.normal_offset(), &vertex.normal, sizeof(vertex.normal));
+            }
+
+            if (format.flags & VertexFormat::half_tex_coords) {
+                uint32_t tex_coords = glm::packHalf2x16(vertex.tex_coords);
+                std::memcpy(out + format.tex_coords_offset(), &tex_coords, sizeof(tex_coords));
+            } else {
+                std::memcpy(out + format.tex_coords_offset(), &vertex.tex_coords, sizeof(vertex.tex_coords));
+            }
+        }
+        return result;
+    }
+
+    std::vector<Vertex> decode_vertices(std::span<const std::byte> data, const VertexFormat &format,
+                                        const PositionDequantization &dequantization) {
+        HS_ZONE("render::decode_vertices");
+        const uint32_t stride = format.stride();
+        std::vector<Vertex> vertices(data.size() / stride);
+        for (std::size_t i = 0; i < vertices.size(); ++i) {
+            Vertex &vertex = vertices[i];
+            const std::byte *in = data.data() + i * stride;
+
+            if (format.flags & VertexFormat::quantized_positions) {
+                glm::i16vec3 position;
+                std::memcpy(&position, in, sizeof(position));
+                vertex.position = dequantization.offset + glm::vec3(position) * dequantization.scale;
+            } else {
+                std::memcpy(&vertex.position, in, sizeof(vertex.position));
+            }
+
+            if (format.flags & VertexFormat::packed_normals) {
+                uint32_t normal;
+                std::memcpy(&normal, in + format.normal_offset(), sizeof(normal));
+                vertex.normal = glm::vec3(glm::unpackSnorm3x10_1x2(normal));
+            } else {
+                std::memcpy(&vertex.normal, in + format.normal_offset(), sizeof(vertex.normal));
+            }
+
+            if (format.flags & VertexFormat::half_tex_coords) {
+                uint32_t tex_coords;
+                std::memcpy(&tex_coords, in + format.tex_coords_offset(), sizeof(tex_coords));
+                vertex.tex_coords = glm::unpackHalf2x16(tex_coords);
+            } else {
+                std::memcpy(&vertex.tex_coords, in + format.tex_coords_offset(), sizeof(vertex.tex_coords));
+            }
+        }
+        return vertices;
+    }
+}
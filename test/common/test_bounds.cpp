@@ -0,0 +1,61 @@
+#include "doctest.h"
+
+#include "common/bounds.h"
+
+#include <vector>
+
+#include "glm/gtc/matrix_transform.hpp"
+
+TEST_SUITE("Bounds") {
+    static bool contains(const Bounds &bounds, const glm::vec3 &point) {
+        const float epsilon = 1e-4f;
+        return glm::all(glm::greaterThanEqual(point, bounds.min - epsilon)) &&
+               glm::all(glm::lessThanEqual(point, bounds.max + epsilon)) &&
+               glm::length(point - bounds.center) <= bounds.radius + epsilon;
+    }
+
+    static const std::vector<glm::vec3> points{
+            {1.0f, 2.0f, 3.0f}, {-1.0f, 0.0f, 5.0f}, {3.0f, -2.0f, 4.0f}, {0.0f, 1.0f, 3.5f}
+    };
+
+    TEST_CASE("from_points") {
+        Bounds bounds = Bounds::from_points(points);
+        CHECK(bounds.min == glm::vec3(-1.0f, -2.0f, 3.0f));
+        CHECK(bounds.max == glm::vec3(3.0f, 2.0f, 5.0f));
+        CHECK(bounds.center == glm::vec3(1.0f, 0.0f, 4.0f));
+        for (const auto &point : points)
+            CHECK(contains(bounds, point));
+        CHECK(bounds.radius < glm::length(bounds.max - bounds.min) * 0.5f + 1e-4f);
+
+        CHECK(Bounds::from_points({}).empty());
+        CHECK(!bounds.empty());
+    }
+
+    TEST_CASE("merge") {
+        Bounds a = Bounds::from_points(std::vector<glm::vec3>{{0.0f, 0.0f, 0.0f}, {2.0f, 0.0f, 0.0f}});
+        Bounds b = Bounds::from_points(std::vector<glm::vec3>{{10.0f, 0.0f, 0.0f}, {12.0f, 0.0f, 0.0f}});
+        Bounds merged = Bounds::merge(a, b);
+        CHECK(merged.min == glm::vec3(0.0f));
+        CHECK(merged.max == glm::vec3(12.0f, 0.0f, 0.0f));
+        CHECK(merged.center.x == doctest::Approx(6.0f));
+        CHECK(merged.radius == doctest::Approx(6.0f));
+
+        Bounds inner = Bounds::from_points(std::vector<glm::vec3>{{0.5f, 0.0f, 0.0f}, {1.5f, 0.0f, 0.0f}});
+        CHECK(Bounds::merge(a, inner).radius == a.radius);
+        CHECK(Bounds::merge(a, Bounds{}) == a);
+        CHECK(Bounds::merge(Bounds{}, a) == a);
+    }
+
+    TEST_CASE("transformed contains transformed points") {
+        Bounds bounds = Bounds::from_points(points);
+        glm::mat4 matrix = glm::translate(glm::mat4(1.0f), glm::vec3(5.0f, -3.0f, 2.0f));
+        matrix = glm::rotate(matrix, glm::radians(37.0f), glm::normalize(glm::vec3(1.0f, 2.0f, 0.5f)));
+        matrix = glm::scale(matrix, glm::vec3(2.0f, 1.0f, 0.5f));
+
+        Bounds world = bounds.transformed(matrix);
+        for (const auto &point : points)
+            CHECK(contains(world, glm::vec3(matrix * glm::vec4(point, 1.0f))));
+        CHECK(world.radius == doctest::Approx(bounds.radius * 2.0f));
+        CHECK(Bounds{}.transformed(matrix).empty());
+    }
+}
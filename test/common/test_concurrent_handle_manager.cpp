@@ -0,0 +1,113 @@
+#include "doctest.h"
+
+#include "common/concurrent_handle_manager.h"
+
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+TEST_SUITE("ConcurrentHandleManager") {
+    TEST_CASE("lifecycle") {
+        ConcurrentHandleManager<std::unique_ptr<int>> manager;
+        auto handle = manager.create();
+        CHECK(manager.size() == 1);
+        CHECK(manager.is_valid(handle));
+        CHECK(manager.state(handle) == ResourceState::loading);
+        CHECK(!manager.get(handle));
+
+        CHECK(manager.set_ready(handle, std::make_unique<int>(5)));
+        CHECK(!manager.set_ready(handle, std::make_unique<int>(6)));
+        CHECK(!manager.set_failed(handle));
+        CHECK(manager.state(handle) == ResourceState::ready);
+        REQUIRE(manager.get(handle));
+        CHECK(**manager.get(handle) == 5);
+
+        auto erased = manager.erase(handle);
+        REQUIRE(erased);
+        CHECK(**erased == 5);
+        CHECK(manager.size() == 0);
+        CHECK(!manager.is_valid(handle));
+        CHECK(manager.state(handle) == ResourceState::invalid);
+        CHECK(!manager.erase(handle));
+
+        // The entry is reused with a new version
+        auto failed = manager.create();
+        CHECK(failed.index == handle.index);
+        CHECK(failed.version != handle.version);
+        CHECK(manager.state(handle) == ResourceState::invalid);
+
+        CHECK(manager.set_failed(failed));
+        CHECK(manager.state(failed) == ResourceState::failed);
+        CHECK(!manager.get(failed));
+        CHECK(!manager.erase(failed)); // no data to return
+        CHECK(!manager.is_valid(failed));
+    }
+
+    TEST_CASE("values are destroyed with manager") {
+        auto value = std::make_shared<int>(1);
+        {
+            ConcurrentHandleManager<std::shared_ptr<int>> manager;
+            manager.set_ready(manager.create(), value);
+            manager.create(); // still loading
+            CHECK(value.use_count() == 2);
+        }
+        CHECK(value.use_count() == 1);
+    }
+
+    TEST_CASE("parallel create and erase") {
+        ConcurrentHandleManager<int> manager;
+        constexpr int threads_count = 4;
+        constexpr int per_thread = 5000;
+
+        std::vector<std::vector<Handle<int>>> kept(threads_count);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threads_count; ++t)
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < per_thread; ++i) {
+                    auto handle = manager.create();
+                    manager.set_ready(handle, t * per_thread + i);
+                    if (i % 2)
+                        manager.erase(handle);
+                    else
+                        kept[t].push_back(handle);
+                }
+            });
+        for (auto &thread : threads)
+            thread.join();
+
+        CHECK(manager.size() == threads_count * per_thread / 2);
+
+        std::set<uint32_t> indices;
+        for (int t = 0; t < threads_count; ++t)
+            for (std::size_t i = 0; i < kept[t].size(); ++i) {
+                auto handle = kept[t][i];
+                indices.insert(handle.index);
+                REQUIRE(manager.get(handle));
+                CHECK(*manager.get(handle) == t * per_thread + (int) i * 2);
+            }
+        CHECK(indices.size() == manager.size()); // live handles never share an entry
+    }
+
+    TEST_CASE("create fails when full") {
+        using Manager = ConcurrentHandleManager<char>;
+        auto manager = std::make_unique<Manager>();
+        Handle<char> last{};
+        for (uint32_t i = 0; i < Manager::max_size; ++i)
+            last = manager->create();
+        CHECK(manager->state(last) == ResourceState::loading);
+
+        auto overflow = manager->create();
+        CHECK(manager->state(overflow) == ResourceState::invalid);
+        CHECK(!manager->set_ready(overflow, 'a'));
+        CHECK(!manager->erase(overflow));
+        CHECK(manager->size() == Manager::max_size);
+
+        // Freed entries are reused as usual
+        manager->set_failed(last);
+        manager->erase(last);
+        auto reused = manager->create();
+        CHECK(reused.index == last.index);
+        CHECK(manager->state(reused) == ResourceState::loading);
+    }
+}
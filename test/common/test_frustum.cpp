@@ -0,0 +1,53 @@
+#include "doctest.h"
+
+#include "common/frustum.h"
+
+#include <random>
+
+#include "glm/gtc/matrix_transform.hpp"
+
+TEST_SUITE("Frustum") {
+    // Camera at the origin looking down -z, 90 degrees field of view
+    static Frustum camera_frustum() {
+        glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+        glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        return Frustum::from_matrix(projection * view);
+    }
+
+    TEST_CASE("spheres and boxes") {
+        Frustum frustum = camera_frustum();
+        CHECK(frustum.intersects_sphere({0.0f, 0.0f, -10.0f}, 1.0f));
+        CHECK(!frustum.intersects_sphere({0.0f, 0.0f, 10.0f}, 1.0f)); // behind
+        CHECK(!frustum.intersects_sphere({0.0f, 0.0f, -200.0f}, 1.0f)); // past the far plane
+        CHECK(!frustum.intersects_sphere({20.0f, 0.0f, -10.0f}, 1.0f)); // to the right
+        CHECK(frustum.intersects_sphere({11.0f, 0.0f, -10.0f}, 1.0f)); // crosses the right plane
+        CHECK(frustum.intersects_sphere({0.0f, 0.0f, 0.5f}, 1.0f)); // contains the camera
+
+        CHECK(frustum.intersects_box({-1.0f, -1.0f, -11.0f}, {1.0f, 1.0f, -9.0f}));
+        CHECK(!frustum.intersects_box({-1.0f, -1.0f, 9.0f}, {1.0f, 1.0f, 11.0f}));
+        CHECK(frustum.intersects_box({-100.0f, -1.0f, -11.0f}, {100.0f, 1.0f, -9.0f})); // wider than the view
+    }
+
+    TEST_CASE("cull_spheres matches intersects_sphere") {
+        Frustum frustum = camera_frustum();
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+        std::uniform_real_distribution<float> radius(0.0f, 5.0f);
+
+        BoundingSpheres spheres;
+        for (int i = 0; i < 1003; ++i)
+            spheres.push_back({position(random), position(random), position(random)}, radius(random));
+
+        // Ranges which are not multiples of 8 and do not start at 0
+        for (auto [first, last] : {std::pair<uint32_t, uint32_t>{0, 1003}, {3, 10}, {5, 5}, {8, 16}, {1000, 1003}}) {
+            std::vector<uint32_t> expected;
+            for (uint32_t i = first; i < last; ++i)
+                if (frustum.intersects_sphere({spheres.x[i], spheres.y[i], spheres.z[i]}, spheres.radius[i]))
+                    expected.push_back(i);
+
+            std::vector<uint32_t> visible;
+            cull_spheres(frustum, spheres, first, last, visible);
+            CHECK(visible == expected);
+        }
+    }
+}
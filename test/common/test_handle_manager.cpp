@@ -0,0 +1,31 @@
+#include "doctest.h"
+
+#include "common/handle_manager.h"
+
+#include <algorithm>
+#include <vector>
+
+TEST_SUITE("HandleManager") {
+    TEST_CASE("erase keeps other handles iterable") {
+        int values[3] = {1, 2, 3};
+        HandleManager<int> manager;
+        auto a = manager.insert(&values[0]);
+        auto b = manager.insert(&values[1]);
+        auto c = manager.insert(&values[2]);
+
+        // b is in the middle of the used list
+        CHECK(manager.erase(b) == &values[1]);
+        CHECK(manager.get(a) == &values[0]);
+        CHECK(manager.get(c) == &values[2]);
+
+        std::vector<int> visited;
+        foreach(manager, [&](int *value) { visited.push_back(*value); });
+        std::sort(visited.begin(), visited.end());
+        CHECK(visited == std::vector<int>{1, 3});
+
+        CHECK(manager.erase(a) == &values[0]);
+        visited.clear();
+        foreach(manager, [&](int *value) { visited.push_back(*value); });
+        CHECK(visited == std::vector<int>{3});
+    }
+}
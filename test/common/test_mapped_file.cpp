@@ -0,0 +1,42 @@
+#include "doctest.h"
+
+#include "common/mapped_file.h"
+
+#include <cstring>
+#include <fstream>
+
+TEST_SUITE("MappedFile") {
+    TEST_CASE("maps file contents") {
+        auto path = std::filesystem::temp_directory_path() / "high_shift_test_mapped_file.bin";
+        std::string contents(10000, 'x');
+        contents[9999] = 'y';
+        {
+            std::ofstream fout(path, std::ios::binary);
+            fout << contents;
+        }
+
+        auto file = MappedFile::open(path);
+        REQUIRE(file);
+        REQUIRE(file->size() == contents.size());
+        CHECK(std::memcmp(file->data(), contents.data(), contents.size()) == 0);
+
+        MappedFile moved = std::move(*file);
+        CHECK(file->data() == nullptr);
+        CHECK(moved.size() == contents.size());
+        CHECK((char) moved.bytes().back() == 'y');
+
+        std::filesystem::remove(path);
+    }
+
+    TEST_CASE("empty and missing files") {
+        auto path = std::filesystem::temp_directory_path() / "high_shift_test_mapped_empty.bin";
+        std::ofstream(path).close();
+
+        auto empty = MappedFile::open(path);
+        REQUIRE(empty);
+        CHECK(empty->size() == 0);
+
+        std::filesystem::remove(path);
+        CHECK(!MappedFile::open(path));
+    }
+}
@@ -0,0 +1,63 @@
+#include "doctest.h"
+
+#include "common/radix_sort.h"
+
+#include <algorithm>
+#include <random>
+#include <utility>
+
+TEST_SUITE("radix_sort") {
+    using Item = std::pair<uint64_t, uint32_t>; // key, original position
+
+    static uint64_t item_key(const Item &item) {
+        return item.first;
+    }
+
+    TEST_CASE("sorts like stable_sort") {
+        std::mt19937_64 random(42);
+        std::vector<Item> items;
+        for (uint32_t i = 0; i < 10000; ++i)
+            items.emplace_back(random() >> (i % 64), i); // various numbers of significant bytes
+
+        auto expected = items;
+        std::stable_sort(expected.begin(), expected.end(), [](const Item &a, const Item &b) {
+            return a.first < b.first;
+        });
+
+        std::vector<Item> scratch;
+        radix_sort(items, scratch, item_key);
+        CHECK(items == expected);
+    }
+
+    TEST_CASE("is stable") {
+        std::vector<Item> items;
+        for (uint32_t i = 0; i < 1000; ++i)
+            items.emplace_back((uint64_t) (i % 7) << 40, i);
+
+        std::vector<Item> scratch;
+        radix_sort(items, scratch, item_key);
+        for (std::size_t i = 1; i < items.size(); ++i) {
+            REQUIRE(items[i - 1].first <= items[i].first);
+            if (items[i - 1].first == items[i].first)
+                CHECK(items[i - 1].second < items[i].second);
+        }
+    }
+
+    TEST_CASE("equal and trivial inputs") {
+        std::vector<Item> scratch;
+
+        std::vector<Item> empty;
+        radix_sort(empty, scratch, item_key);
+        CHECK(empty.empty());
+
+        std::vector<Item> equal(100, Item{UINT64_MAX, 0});
+        radix_sort(equal, scratch, item_key);
+        CHECK(std::all_of(equal.begin(), equal.end(), [](const Item &item) { return item.first == UINT64_MAX; }));
+
+        std::vector<Item> reversed;
+        for (uint32_t i = 0; i < 300; ++i)
+            reversed.emplace_back(300 - i, i);
+        radix_sort(reversed, scratch, item_key);
+        CHECK(std::is_sorted(reversed.begin(), reversed.end()));
+    }
+}
@@ -0,0 +1,58 @@
+#include "doctest.h"
+
+#include "common/range_allocator.h"
+
+TEST_SUITE("RangeAllocator") {
+    TEST_CASE("allocate and free") {
+        RangeAllocator allocator(100);
+        CHECK(allocator.allocate(40) == 0);
+        CHECK(allocator.allocate(40) == 40);
+        CHECK(!allocator.allocate(40));
+        CHECK(allocator.used() == 80);
+
+        allocator.free(0, 40);
+        CHECK(allocator.allocate(30) == 0);
+        CHECK(!allocator.allocate(30)); // 10 and 20 are free, but not contiguous
+        CHECK(allocator.allocate(20) == 80);
+        CHECK(allocator.allocate(10) == 30);
+    }
+
+    TEST_CASE("alignment keeps padding free") {
+        RangeAllocator allocator(64);
+        CHECK(allocator.allocate(3) == 0);
+        CHECK(allocator.allocate(8, 8) == 8);
+        CHECK(allocator.allocate(2, 2) == 4);
+        CHECK(allocator.used() == 13);
+    }
+
+    TEST_CASE("free merges neighbours") {
+        RangeAllocator allocator(30);
+        auto a = allocator.allocate(10);
+        auto b = allocator.allocate(10);
+        auto c = allocator.allocate(10);
+        REQUIRE((a && b && c));
+
+        allocator.free(*a, 10);
+        allocator.free(*c, 10);
+        CHECK(allocator.fragmentation() == doctest::Approx(0.5f));
+        CHECK(!allocator.allocate(30));
+
+        allocator.free(*b, 10);
+        CHECK(allocator.fragmentation() == 0.0f);
+        CHECK(allocator.used() == 0);
+        CHECK(allocator.allocate(30) == 0);
+    }
+
+    TEST_CASE("grow") {
+        RangeAllocator allocator;
+        CHECK(!allocator.allocate(1));
+
+        allocator.grow(16);
+        CHECK(allocator.allocate(10) == 0);
+        allocator.grow(32);
+        CHECK(allocator.size() == 32);
+        // Tail before growing and the new space are one range
+        CHECK(allocator.allocate(20) == 10);
+        CHECK(allocator.used() == 30);
+    }
+}
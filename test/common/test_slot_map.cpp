@@ -0,0 +1,93 @@
+#include "doctest.h"
+
+#include "common/slot_map.h"
+
+#include <memory>
+#include <vector>
+
+TEST_SUITE("SlotMap") {
+    TEST_CASE("insert and get") {
+        SlotMap<int> map;
+        CHECK(map.empty());
+
+        auto a = map.insert(1);
+        auto b = map.emplace(2);
+        CHECK(map.size() == 2);
+        REQUIRE(map.get(a));
+        REQUIRE(map.get(b));
+        CHECK(*map.get(a) == 1);
+        CHECK(*map.get(b) == 2);
+
+        *map.get(a) = 10;
+        CHECK(*map.get(a) == 10);
+    }
+
+    TEST_CASE("erase") {
+        SlotMap<int> map;
+        auto a = map.insert(1);
+        auto b = map.insert(2);
+        auto c = map.insert(3);
+
+        auto erased = map.erase(a);
+        REQUIRE(erased);
+        CHECK(*erased == 1);
+        CHECK(!map.erase(a));
+        CHECK(!map.is_valid(a));
+        CHECK(!map.get(a));
+
+        SUBCASE("others stay valid") {
+            CHECK(*map.get(b) == 2);
+            CHECK(*map.get(c) == 3);
+            CHECK(map.size() == 2);
+        }
+
+        SUBCASE("slot is reused with new version") {
+            auto d = map.insert(4);
+            CHECK(d.index == a.index);
+            CHECK(d.version != a.version);
+            CHECK(!map.get(a));
+            CHECK(*map.get(d) == 4);
+        }
+
+        SUBCASE("clear") {
+            map.clear();
+            CHECK(map.empty());
+            CHECK(!map.is_valid(b));
+            CHECK(!map.is_valid(c));
+            auto d = map.insert(5);
+            CHECK(*map.get(d) == 5);
+        }
+    }
+
+    TEST_CASE("contiguous iteration") {
+        SlotMap<int> map;
+        map.reserve(16);
+        CHECK(map.capacity() >= 16);
+
+        std::vector<Handle<int>> handles;
+        for (int i = 0; i < 10; ++i)
+            handles.push_back(map.insert(i));
+        for (int i = 0; i < 10; i += 3)
+            map.erase(handles[i]);
+
+        CHECK(map.end() - map.begin() == 6);
+        int sum = 0;
+        for (int value : map)
+            sum += value;
+        CHECK(sum == 1 + 2 + 4 + 5 + 7 + 8);
+
+        for (std::size_t i = 0; i < map.size(); ++i)
+            CHECK(map.get(map.handle_at(i)) == map.begin() + i);
+    }
+
+    TEST_CASE("move-only values") {
+        SlotMap<std::unique_ptr<int>> map;
+        auto a = map.insert(std::make_unique<int>(1));
+        auto b = map.insert(std::make_unique<int>(2));
+
+        auto erased = map.erase(a);
+        REQUIRE(erased);
+        CHECK(**erased == 1);
+        CHECK(**map.get(b) == 2);
+    }
+}
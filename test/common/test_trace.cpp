@@ -0,0 +1,67 @@
+#include "doctest.h"
+
+#include "common/trace.h"
+
+#include <fstream>
+#include <sstream>
+
+TEST_SUITE("trace") {
+    static std::string read_file(const std::filesystem::path &path) {
+        std::ifstream fin(path);
+        std::stringstream ss;
+        ss << fin.rdbuf();
+        return ss.str();
+    }
+
+    TEST_CASE("zones are written to chrome trace") {
+        auto path = std::filesystem::temp_directory_path() / "high_shift_test_trace.json";
+        {
+            trace::Session session(path);
+            REQUIRE(session.is_open());
+
+            trace::set_thread_name("main");
+            {
+                trace::Zone zone("outer \"quoted\"");
+                trace::Zone inner("inner");
+            }
+
+            std::thread worker([] {
+                trace::set_thread_name("worker");
+                trace::Zone zone("worker zone");
+            });
+            worker.join();
+
+            SUBCASE("only one session at a time") {
+                trace::Session other(path);
+                CHECK(!other.is_open());
+            }
+        }
+
+        std::string json = read_file(path);
+        CHECK(json.rfind("{\"traceEvents\":[", 0) == 0);
+        CHECK(json.find("]}") != std::string::npos);
+        CHECK(json.find(R"("name":"outer \"quoted\"")") != std::string::npos);
+        CHECK(json.find(R"("name":"inner")") != std::string::npos);
+        CHECK(json.find(R"("name":"worker zone")") != std::string::npos);
+        CHECK(json.find(R"("args":{"name":"worker"})") != std::string::npos);
+        CHECK(json.find(R"("ph":"X")") != std::string::npos);
+
+        std::filesystem::remove(path);
+    }
+
+    TEST_CASE("nothing is recorded without session") {
+        auto path = std::filesystem::temp_directory_path() / "high_shift_test_trace_empty.json";
+        {
+            trace::Zone zone("before session");
+        }
+        {
+            trace::Session session(path);
+            REQUIRE(session.is_open());
+        }
+
+        std::string json = read_file(path);
+        CHECK(json.find("before session") == std::string::npos);
+
+        std::filesystem::remove(path);
+    }
+}
@@ -74,6 +74,34 @@ TEST_SUITE("ecs::EntityChunkMapping") {
 
             CHECK(!mapping.erase(id));
         }
+
+        SUBCASE("erase moves the last entity") {
+            mapping.insert(1, {.index_in_chunk = 1});
+            mapping.insert(2, {.index_in_chunk = 2});
+            mapping.insert(3, {.index_in_chunk = 3});
+
+            CHECK(mapping.erase(1));
+            CHECK(mapping[2].index_in_chunk == 2);
+            CHECK(mapping[3].index_in_chunk == 3);
+            CHECK(mapping.erase(3));
+            CHECK(mapping[2].index_in_chunk == 2);
+        }
+    }
+
+    TEST_CASE("large ids") {
+        ecs::EntityChunkMapping mapping;
+        ecs::Id id = ecs::PagedIdSet::max_size - 1;
+        ecs::EntityPosInChunk entity_pos{.index_in_chunk = 7};
+
+        CHECK(mapping.insert(id, entity_pos));
+        CHECK(mapping.insert(0, {.index_in_chunk = 8}));
+        CHECK(mapping[id] == entity_pos);
+        CHECK(mapping[0].index_in_chunk == 8);
+        CHECK(mapping.memory_usage() < 256 * 1024);
+
+        CHECK(mapping.erase(id));
+        CHECK(!mapping.contains(id));
+        CHECK(mapping[0].index_in_chunk == 8);
     }
 }
 
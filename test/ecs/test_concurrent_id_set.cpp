@@ -0,0 +1,98 @@
+#include "doctest.h"
+
+#include "ecs/concurrent_id_set.h"
+#include "ecs/jobs.h"
+
+#include <vector>
+
+TEST_SUITE("ecs::ConcurrentIdSet") {
+    template<typename Set>
+    static std::vector<ecs::Id> collect(const Set &set) {
+        std::vector<ecs::Id> ids;
+        for (ecs::Id id : set)
+            ids.push_back(id);
+        return ids;
+    }
+
+    TEST_CASE("single thread") {
+        ecs::ConcurrentIdSet set(100000);
+        CHECK(set.empty());
+        CHECK(set.capacity() >= 100000);
+
+        CHECK(set.insert(5));
+        CHECK(!set.insert(5));
+        CHECK(set.insert(70000));
+        CHECK(set.size() == 2);
+        CHECK(set.contains(70000));
+        CHECK(set.first() == 5);
+        CHECK(collect(set) == std::vector<ecs::Id>{5, 70000});
+
+        CHECK(set.erase(5));
+        CHECK(!set.erase(5));
+        CHECK(set.first() == 70000);
+
+        set.clear();
+        CHECK(set.empty());
+        CHECK(set.first() == set.capacity());
+    }
+
+    TEST_CASE("parallel producers") {
+        ecs::Jobs jobs(4);
+        constexpr ecs::Id count = 1 << 18;
+        ecs::ConcurrentIdSet set(count);
+
+        // Chunks overlap, so each id is inserted by several threads
+        jobs.parallel_for(0, count * 4, 1000, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i)
+                if ((i / 4) % 3 == 0)
+                    set.insert(i / 4);
+        });
+
+        std::vector<ecs::Id> expected;
+        for (ecs::Id id = 0; id < count; id += 3)
+            expected.push_back(id);
+
+        CHECK(set.size() == expected.size());
+        CHECK(collect(set) == expected);
+
+        SUBCASE("merge into id set") {
+            ecs::IdSet result;
+            result.insert(1);
+            set.merge_into(result);
+            CHECK(result.size() == expected.size() + 1);
+            CHECK(result.contains(1));
+            CHECK(result.contains(count - 1 - (count - 1) % 3));
+            CHECK(!result.contains(2));
+        }
+
+        SUBCASE("query algebra") {
+            ecs::IdSet odd;
+            for (ecs::Id id = 1; id < 100; id += 2)
+                odd.insert(id);
+            CHECK(collect(set & odd) == std::vector<ecs::Id>{3, 9, 15, 21, 27, 33, 39, 45, 51, 57, 63, 69, 75, 81, 87, 93, 99});
+        }
+    }
+
+    TEST_CASE("concurrent insert and erase keep upper levels") {
+        ecs::Jobs jobs(4);
+        ecs::ConcurrentIdSet set(1 << 16);
+
+        // Threads toggle neighbouring ids of the same words,
+        // emptying and refilling words and their parents
+        for (int round = 0; round <= 20; ++round) {
+            jobs.parallel_for(0, 1 << 16, 16, [&](uint32_t begin, uint32_t end) {
+                for (uint32_t id = begin; id < end; ++id) {
+                    set.insert(id);
+                    if (id % 64 != 0 || round % 2)
+                        set.erase(id);
+                }
+            });
+        }
+
+        std::vector<ecs::Id> expected;
+        for (ecs::Id id = 0; id < (1 << 16); id += 64)
+            expected.push_back(id);
+        CHECK(set.size() == expected.size());
+        CHECK(collect(set) == expected);
+    }
+}
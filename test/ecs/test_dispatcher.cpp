@@ -97,6 +97,114 @@ namespace {
         void update() {}
     };
 
+    struct StepsCounter {
+        int fixed = 0;
+        int frame = 0;
+        float fixed_delta_time = 0.0f;
+    };
+
+    class FixedSystem {
+    public:
+        using UpdateTag = ecs::FixedUpdateTag;
+
+        void update(StepsCounter &counter, const ecs::DeltaTime &delta_time) {
+            ++counter.fixed;
+            counter.fixed_delta_time = delta_time();
+        }
+    };
+
+    class FrameSystem {
+    public:
+        void update(StepsCounter &counter) {
+            ++counter.frame;
+        }
+    };
+
+    struct GroupCounters {
+        int a = 0;
+        int b = 0;
+        int c = 0;
+        float a_delta_time = 0.0f;
+        bool enabled = true;
+    };
+
+    class GroupedSystemA {
+    public:
+        void update(GroupCounters &counters, const ecs::DeltaTime &delta_time) {
+            ++counters.a;
+            counters.a_delta_time = delta_time();
+        }
+    };
+
+    class GroupedSystemB {
+    public:
+        void update(GroupCounters &counters) {
+            ++counters.b;
+        }
+    };
+
+    class GroupedSystemC {
+    public:
+        void update(GroupCounters &counters) {
+            ++counters.c;
+        }
+    };
+
+    class StoppingSystem {
+    public:
+        void update(StepsCounter &counter, ecs::GameLoopControl &game_loop_control) {
+            if (counter.frame == 5)
+                game_loop_control.stop();
+        }
+    };
+
+    struct ParallelA {
+        int value = 0;
+    };
+
+    struct ParallelB {
+        int value = 0;
+    };
+
+    class WriterSystemA {
+    public:
+        using ThreadTag = ecs::AnyThreadTag;
+
+        void update(ParallelA &a) {
+            ++a.value;
+        }
+    };
+
+    class WriterSystemB {
+    public:
+        using ThreadTag = ecs::AnyThreadTag;
+
+        void update(ParallelB &b, ecs::Jobs &jobs) {
+            std::atomic<int> sum{0};
+            jobs.parallel_for(0, 100, 10, [&](uint32_t begin, uint32_t end) {
+                sum.fetch_add((int) (end - begin));
+            });
+            b.value += sum.load() / 100;
+        }
+    };
+
+    class ReaderSystemAB {
+    public:
+        using ThreadTag = ecs::AnyThreadTag;
+
+        void update(const ParallelA &a, const ParallelB &b, StepsCounter &counter) {
+            // Writers must have finished by now
+            if (a.value == b.value)
+                ++counter.frame;
+        }
+    };
+
+    static_assert(ecs::FixedStepSystem<FixedSystem>);
+    static_assert(!ecs::FixedStepSystem<FrameSystem>);
+
+    static_assert(ecs::ParallelSystem<WriterSystemA>);
+    static_assert(!ecs::ParallelSystem<FrameSystem>);
+
     static_assert(ecs::System<SomeSystem>);
     static_assert(ecs::System<OtherSystem>);
     static_assert(ecs::System<ThirdSystem>);
@@ -241,4 +349,205 @@ TEST_SUITE("ecs::Dispatcher") {
         CHECK(world.get<SomeRes>().a == 1);
         CHECK(world.get<OtherRes>().a == 2);
     }
-}
\ No newline at end of file
+
+    TEST_CASE("fixed step") {
+        auto dispatcher_result = ecs::Dispatcher::create<FixedSystem, FrameSystem>();
+        REQUIRE(dispatcher_result);
+
+        auto dispatcher = std::move(dispatcher_result.value());
+        ecs::World &world = dispatcher.get_world();
+        auto &counter = world.get<StepsCounter>();
+        auto &fixed_time = world.get<ecs::FixedTime>();
+        fixed_time.set_step(0.25f);
+        fixed_time.set_max_steps_per_frame(4);
+
+        SUBCASE("accumulates frame time") {
+            dispatcher.update(0.1f);
+            CHECK(counter.fixed == 0);
+            CHECK(counter.frame == 1);
+            CHECK(fixed_time.alpha() == doctest::Approx(0.4f));
+
+            dispatcher.update(0.6f);
+            CHECK(counter.fixed == 2);
+            CHECK(counter.frame == 2);
+            CHECK(fixed_time.steps() == 2);
+            CHECK(fixed_time.alpha() == doctest::Approx(0.8f));
+            CHECK(counter.fixed_delta_time == doctest::Approx(0.25f));
+            CHECK(world.get<ecs::DeltaTime>()() == doctest::Approx(0.6f));
+        }
+
+        SUBCASE("catch-up is bounded") {
+            dispatcher.update(10.1f);
+            CHECK(counter.fixed == 4);
+            CHECK(counter.frame == 1);
+            CHECK(fixed_time.alpha() < 1.0f);
+
+            dispatcher.update(0.0f);
+            CHECK(counter.fixed == 4);
+        }
+    }
+
+    TEST_CASE("system groups") {
+        SUBCASE("every n frames with phase offsets") {
+            auto dispatcher_result = ecs::DispatcherBuilder()
+                    .add_group("slow", ecs::RunCriteria{.every_frames = 2})
+                    .add_system_to_group<GroupedSystemA>("slow")
+                    .add_system_to_group<GroupedSystemB>("slow")
+                    .add_system<GroupedSystemC>()
+                    .build();
+            REQUIRE(dispatcher_result);
+
+            auto dispatcher = std::move(dispatcher_result.value());
+            auto &counters = dispatcher.get_world().get<GroupCounters>();
+
+            dispatcher.update(0.1f);
+            CHECK(counters.a + counters.b == 1);
+            CHECK(counters.c == 1);
+
+            dispatcher.update(0.1f);
+            CHECK(counters.a == 1);
+            CHECK(counters.b == 1);
+            CHECK(counters.c == 2);
+
+            for (int i = 0; i < 4; ++i)
+                dispatcher.update(0.1f);
+            CHECK(counters.a == 3);
+            CHECK(counters.b == 3);
+            CHECK(counters.c == 6);
+            CHECK(counters.a_delta_time == doctest::Approx(0.2f));
+        }
+
+        SUBCASE("no stagger") {
+            auto dispatcher_result = ecs::DispatcherBuilder()
+                    .add_group("slow", ecs::RunCriteria{.every_frames = 3, .stagger = false})
+                    .add_system_to_group<GroupedSystemA>("slow")
+                    .add_system_to_group<GroupedSystemB>("slow")
+                    .build();
+            REQUIRE(dispatcher_result);
+
+            auto dispatcher = std::move(dispatcher_result.value());
+            auto &counters = dispatcher.get_world().get<GroupCounters>();
+
+            dispatcher.update(0.1f);
+            CHECK(counters.a == 1);
+            CHECK(counters.b == 1);
+
+            dispatcher.update(0.1f);
+            dispatcher.update(0.1f);
+            CHECK(counters.a == 1);
+
+            dispatcher.update(0.1f);
+            CHECK(counters.a == 2);
+            CHECK(counters.b == 2);
+        }
+
+        SUBCASE("every t seconds") {
+            auto dispatcher_result = ecs::DispatcherBuilder()
+                    .add_group("timer", ecs::RunCriteria{.every_seconds = 1.0f})
+                    .add_system_to_group<GroupedSystemA>("timer")
+                    .add_system_to_group<GroupedSystemB>("timer")
+                    .build();
+            REQUIRE(dispatcher_result);
+
+            auto dispatcher = std::move(dispatcher_result.value());
+            auto &counters = dispatcher.get_world().get<GroupCounters>();
+
+            // The second system is shifted by half of the period
+            dispatcher.update(0.25f);
+            CHECK(counters.a + counters.b == 1);
+            dispatcher.update(0.25f);
+            dispatcher.update(0.25f);
+            CHECK(counters.a == 1);
+            CHECK(counters.b == 1);
+
+            for (int i = 0; i < 4; ++i)
+                dispatcher.update(0.25f);
+            CHECK(counters.a == 2);
+            CHECK(counters.b == 2);
+            CHECK(counters.a_delta_time == doctest::Approx(1.0f));
+
+            // A long frame does not cause a burst of updates
+            dispatcher.update(10.0f);
+            dispatcher.update(0.25f);
+            CHECK(counters.a == 3);
+            CHECK(counters.b == 3);
+        }
+
+        SUBCASE("run condition") {
+            auto dispatcher_result = ecs::DispatcherBuilder()
+                    .add_group("conditional", ecs::RunCriteria{
+                            .condition = [](ecs::World &world) { return world.get<GroupCounters>().enabled; }
+                    })
+                    .add_system_to_group<GroupedSystemA>("conditional")
+                    .build();
+            REQUIRE(dispatcher_result);
+
+            auto dispatcher = std::move(dispatcher_result.value());
+            auto &counters = dispatcher.get_world().get<GroupCounters>();
+
+            dispatcher.update(0.1f);
+            CHECK(counters.a == 1);
+
+            counters.enabled = false;
+            dispatcher.update(0.1f);
+            dispatcher.update(0.1f);
+            CHECK(counters.a == 1);
+
+            counters.enabled = true;
+            dispatcher.update(0.1f);
+            CHECK(counters.a == 2);
+            CHECK(counters.a_delta_time == doctest::Approx(0.3f));
+        }
+
+        SUBCASE("unknown group") {
+            auto dispatcher_result = ecs::DispatcherBuilder()
+                    .add_system_to_group<GroupedSystemA>("missing")
+                    .build();
+            REQUIRE(!dispatcher_result);
+
+            auto err = std::move(dispatcher_result.error());
+            REQUIRE(std::holds_alternative<ecs::Dispatcher::GroupError>(err));
+            CHECK(std::get<ecs::Dispatcher::GroupError>(err).group_name == "missing");
+        }
+    }
+
+    TEST_CASE("headless loop") {
+        SUBCASE("fixed number of frames") {
+            auto dispatcher_result = ecs::Dispatcher::create<FixedSystem, FrameSystem>();
+            REQUIRE(dispatcher_result);
+
+            auto dispatcher = std::move(dispatcher_result.value());
+            auto &counter = dispatcher.get_world().get<StepsCounter>();
+            dispatcher.get_world().get<ecs::FixedTime>().set_step(0.25f);
+
+            dispatcher.loop(ecs::HeadlessLoop{.frames = 10, .delta_time = 0.5f});
+            CHECK(counter.frame == 10);
+            CHECK(counter.fixed == 20);
+            CHECK(dispatcher.get_world().get<ecs::DeltaTime>()() == 0.5f);
+        }
+
+        SUBCASE("until stopped") {
+            auto dispatcher_result = ecs::Dispatcher::create<FrameSystem, StoppingSystem>();
+            REQUIRE(dispatcher_result);
+
+            auto dispatcher = std::move(dispatcher_result.value());
+            auto &counter = dispatcher.get_world().get<StepsCounter>();
+
+            dispatcher.loop(ecs::HeadlessLoop{});
+            CHECK(counter.frame == 5);
+        }
+    }
+
+    TEST_CASE("parallel systems") {
+        auto dispatcher_result = ecs::Dispatcher::create<WriterSystemA, WriterSystemB, ReaderSystemAB>();
+        REQUIRE(dispatcher_result);
+
+        auto dispatcher = std::move(dispatcher_result.value());
+        auto &world = dispatcher.get_world();
+
+        dispatcher.loop(ecs::HeadlessLoop{.frames = 100});
+        CHECK(world.get<ParallelA>().value == 100);
+        CHECK(world.get<ParallelB>().value == 100);
+        CHECK(world.get<StepsCounter>().frame == 100);
+    }
+}
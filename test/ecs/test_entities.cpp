@@ -99,6 +99,18 @@ TEST_SUITE("ecs::Entities") {
             });
         }
 
+        SUBCASE("foreach with optional component") {
+            entities.foreach([&](const ComponentA &a, const ComponentB *b) {
+                visited[a.x] = true;
+                if (a.x < n) {
+                    REQUIRE(b);
+                    CHECK(b->y == a.x);
+                } else {
+                    CHECK(!b);
+                }
+            });
+        }
+
         CHECK(std::find(visited.begin(), visited.end(), false) - visited.begin() == n + m);
     }
 
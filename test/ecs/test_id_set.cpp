@@ -2,7 +2,10 @@
 
 #include "ecs/id_set.h"
 
+#include <chrono>
 #include <climits>
+#include <random>
+#include <set>
 
 TEST_SUITE("ecs::IdSet") {
     TEST_CASE("empty") {
@@ -285,4 +288,278 @@ TEST_SUITE("ecs::IdSet") {
             CHECK(i == ids_n);
         }
     }
-}
\ No newline at end of file
+
+    static std::vector<ecs::Id> to_vector(const ecs::IdSet &set) {
+        std::vector<ecs::Id> ids;
+        ecs::foreach(set, [&](ecs::Id id) { ids.push_back(id); });
+        return ids;
+    }
+
+    static void check_consistent(const ecs::IdSet &set, const std::set<ecs::Id> &expected) {
+        CHECK(to_vector(set) == std::vector<ecs::Id>(expected.begin(), expected.end()));
+        CHECK(set.size() == expected.size());
+        CHECK(set.empty() == expected.empty());
+        if (!expected.empty())
+            CHECK(set.first() == *expected.begin());
+    }
+
+    TEST_CASE("bulk operations") {
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<ecs::Id> id_dist(0, 300000);
+
+        std::vector<ecs::Id> a_ids(5000), b_ids(3000);
+        for (auto &id : a_ids) id = id_dist(rng);
+        for (auto &id : b_ids) id = id_dist(rng) / 3; // smaller capacity
+        std::sort(a_ids.begin(), a_ids.end());
+        std::sort(b_ids.begin(), b_ids.end());
+
+        std::set<ecs::Id> a_expected(a_ids.begin(), a_ids.end());
+        std::set<ecs::Id> b_expected(b_ids.begin(), b_ids.end());
+
+        ecs::IdSet a(a_ids);
+        ecs::IdSet b(b_ids);
+
+        SUBCASE("construction from sorted ids") {
+            check_consistent(a, a_expected);
+            check_consistent(b, b_expected);
+            check_consistent(ecs::IdSet(std::span<const ecs::Id>{}), {});
+        }
+
+        SUBCASE("union") {
+            std::set<ecs::Id> expected = a_expected;
+            expected.insert(b_expected.begin(), b_expected.end());
+
+            ecs::IdSet a_copy = a;
+            a |= b;
+            check_consistent(a, expected);
+
+            b |= a_copy;
+            check_consistent(b, expected);
+        }
+
+        SUBCASE("intersection") {
+            std::set<ecs::Id> expected;
+            for (ecs::Id id : a_expected)
+                if (b_expected.count(id))
+                    expected.insert(id);
+
+            ecs::IdSet a_copy = a;
+            a &= b;
+            check_consistent(a, expected);
+
+            b &= a_copy;
+            check_consistent(b, expected);
+
+            a &= ecs::IdSet();
+            check_consistent(a, {});
+        }
+
+        SUBCASE("difference") {
+            std::set<ecs::Id> a_minus_b, b_minus_a;
+            for (ecs::Id id : a_expected)
+                if (!b_expected.count(id))
+                    a_minus_b.insert(id);
+            for (ecs::Id id : b_expected)
+                if (!a_expected.count(id))
+                    b_minus_a.insert(id);
+
+            ecs::IdSet a_copy = a;
+            a -= b;
+            check_consistent(a, a_minus_b);
+
+            b -= a_copy;
+            check_consistent(b, b_minus_a);
+        }
+
+        SUBCASE("ranges") {
+            a.insert_range(1000, 5000);
+            a.erase_range(2000, 2070);
+            a.erase_range(290000, 10000000);
+            a.insert_range(70, 70);
+
+            for (ecs::Id id = 1000; id < 5000; ++id)
+                a_expected.insert(id);
+            for (ecs::Id id = 2000; id < 2070; ++id)
+                a_expected.erase(id);
+            a_expected.erase(a_expected.lower_bound(290000), a_expected.end());
+            check_consistent(a, a_expected);
+        }
+
+        SUBCASE("rank and select") {
+            std::vector<ecs::Id> ids(a_expected.begin(), a_expected.end());
+            for (std::size_t k = 0; k < ids.size(); k += 37) {
+                CHECK(a.select(k) == ids[k]);
+                CHECK(a.rank(ids[k]) == k);
+                CHECK(a.rank(ids[k] + 1) == k + 1);
+            }
+            CHECK(a.select(ids.size()) == ecs::IdSet::max_size);
+            CHECK(a.rank(ecs::IdSet::max_size) == ids.size());
+        }
+
+        SUBCASE("clear") {
+            a.clear();
+            check_consistent(a, {});
+            a.insert(12345);
+            check_consistent(a, {12345});
+        }
+    }
+
+    static_assert(std::forward_iterator<ecs::IdSetIterator<ecs::IdSet>>);
+
+    template<typename Set>
+    static std::vector<ecs::Id> collect_blocks(const Set &set) {
+        std::vector<ecs::Id> ids;
+        ecs::foreach_block(set, [&](ecs::Id base, uint64_t mask) {
+            CHECK(base % 64 == 0);
+            CHECK(mask != 0);
+            for (ecs::Id i = 0; i < 64; ++i)
+                if (mask & (1ull << i))
+                    ids.push_back(base + i);
+        });
+        return ids;
+    }
+
+    template<typename Set>
+    static std::vector<ecs::Id> collect_iterated(const Set &set) {
+        std::vector<ecs::Id> ids;
+        for (ecs::Id id : set)
+            ids.push_back(id);
+        return ids;
+    }
+
+    TEST_CASE("block iteration") {
+        constexpr ecs::Id a_ids[] = {0, 10, 11, 63, 64, 500, 1000, 5000, 100000, 100001, 1000000, 10000000};
+        constexpr ecs::Id b_ids[] = {10, 63, 65, 500, 4096, 100001, 10000000};
+
+        ecs::IdSet a(a_ids);
+        ecs::IdSet b(b_ids);
+
+        std::vector<ecs::Id> a_expected(std::begin(a_ids), std::end(a_ids));
+        std::vector<ecs::Id> and_expected = {10, 63, 500, 100001, 10000000};
+        std::vector<ecs::Id> or_expected;
+        std::set_union(std::begin(a_ids), std::end(a_ids), std::begin(b_ids), std::end(b_ids),
+                       std::back_inserter(or_expected));
+
+        SUBCASE("id set") {
+            CHECK(collect_blocks(a) == a_expected);
+            CHECK(collect_iterated(a) == a_expected);
+            CHECK(collect_iterated(ecs::IdSet()).empty());
+        }
+
+        SUBCASE("and") {
+            CHECK(collect_blocks(a & b) == and_expected);
+            CHECK(collect_iterated(a & b) == and_expected);
+
+            ecs::DynamicIdSetAnd dynamic_and({&a, &b});
+            CHECK(collect_blocks(dynamic_and) == and_expected);
+            CHECK(collect_iterated(dynamic_and) == and_expected);
+        }
+
+        SUBCASE("or") {
+            CHECK(collect_blocks(a | b) == or_expected);
+            CHECK(collect_iterated(a | b) == or_expected);
+        }
+
+        SUBCASE("not") {
+            auto not_a = ~a;
+            auto it = ecs::begin(not_a);
+            CHECK(*it++ == 1);
+            CHECK(*it == 2);
+            CHECK(*std::find_if(it, ecs::end(not_a), [](ecs::Id id) { return id >= 63; }) == 65);
+        }
+    }
+
+    static std::vector<ecs::IdSet> random_sets(std::size_t count, std::size_t capacity, std::mt19937 &rng) {
+        std::vector<ecs::IdSet> sets(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            // Sets of different density and capacity
+            std::uniform_int_distribution<ecs::Id> id_dist(0, (ecs::Id) (capacity >> i) - 1);
+            std::size_t n = capacity / (4 << i);
+            for (std::size_t j = 0; j < n; ++j)
+                sets[i].insert(id_dist(rng));
+        }
+        return sets;
+    }
+
+    TEST_CASE("dynamic bitwise and") {
+        std::mt19937 rng(42);
+        auto sets = random_sets(4, 1 << 20, rng);
+
+        std::vector<const ecs::IdSet *> pointers;
+        for (auto &set : sets)
+            pointers.push_back(&set);
+        ecs::DynamicIdSetAnd sets_and(pointers);
+
+        std::vector<ecs::Id> expected;
+        ecs::foreach(sets[0], [&](ecs::Id id) {
+            if (sets[1].contains(id) && sets[2].contains(id) && sets[3].contains(id))
+                expected.push_back(id);
+        });
+        REQUIRE(!expected.empty());
+
+        SUBCASE("lazy traversal") {
+            std::vector<ecs::Id> actual;
+            ecs::foreach(sets_and, [&](ecs::Id id) { actual.push_back(id); });
+            CHECK(actual == expected);
+            CHECK(sets_and.contains(expected[0]));
+            CHECK(sets_and.first() == expected[0]);
+        }
+
+        SUBCASE("materialize") {
+            ecs::IdSet result;
+            result.insert(5000000); // stale data must be dropped
+
+            for (int i = 0; i < 2; ++i) {
+                sets_and.materialize(result);
+
+                std::vector<ecs::Id> actual;
+                ecs::foreach(result, [&](ecs::Id id) { actual.push_back(id); });
+                CHECK(actual == expected);
+                CHECK(result.size() == expected.size());
+                CHECK(result.first() == expected[0]);
+            }
+        }
+
+        SUBCASE("materialize empty intersection") {
+            ecs::IdSet empty;
+            empty.insert(1);
+            pointers.push_back(&empty);
+
+            ecs::IdSet result;
+            ecs::DynamicIdSetAnd(pointers).materialize(result);
+            CHECK(result.empty());
+            CHECK(!ecs::find_if(result, [](ecs::Id) { return true; }));
+        }
+    }
+
+    TEST_CASE("dynamic bitwise and benchmark" * doctest::skip()) {
+        using Clock = std::chrono::steady_clock;
+        std::mt19937 rng(42);
+        auto sets = random_sets(6, ecs::IdSet::max_size, rng);
+
+        std::vector<const ecs::IdSet *> pointers;
+        for (auto &set : sets)
+            pointers.push_back(&set);
+        ecs::DynamicIdSetAnd sets_and(pointers);
+
+        const int iterations = 50;
+        std::size_t lazy_count = 0, materialized_count = 0;
+
+        auto begin = Clock::now();
+        for (int i = 0; i < iterations; ++i)
+            ecs::foreach(sets_and, [&](ecs::Id) { ++lazy_count; });
+        auto lazy = Clock::now() - begin;
+
+        ecs::IdSet scratch;
+        begin = Clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            sets_and.materialize(scratch);
+            ecs::foreach(scratch, [&](ecs::Id) { ++materialized_count; });
+        }
+        auto materialized = Clock::now() - begin;
+
+        CHECK(lazy_count == materialized_count);
+        MESSAGE("per-word traversal: ", std::chrono::duration<double, std::micro>(lazy).count() / iterations, " us");
+        MESSAGE("materialized: ", std::chrono::duration<double, std::micro>(materialized).count() / iterations, " us");
+    }
+}
@@ -0,0 +1,144 @@
+#include "doctest.h"
+
+#include "ecs/jobs.h"
+
+#include <numeric>
+#include <thread>
+
+TEST_SUITE("ecs::Jobs") {
+    TEST_CASE("parallel for") {
+        for (uint32_t workers_count : {0u, 1u, 4u}) {
+            ecs::Jobs jobs(workers_count);
+            CAPTURE(workers_count);
+
+            std::vector<uint32_t> values(10000, 0);
+            jobs.parallel_for(0, (uint32_t) values.size(), 64, [&](uint32_t begin, uint32_t end) {
+                CHECK(end - begin <= 64);
+                for (uint32_t i = begin; i < end; ++i)
+                    values[i] += i;
+            });
+
+            std::vector<uint32_t> expected(values.size());
+            std::iota(expected.begin(), expected.end(), 0);
+            CHECK(values == expected);
+
+            bool called = false;
+            jobs.parallel_for(5, 5, 1, [&](uint32_t, uint32_t) { called = true; });
+            CHECK(!called);
+        }
+    }
+
+    TEST_CASE("nested parallel for") {
+        ecs::Jobs jobs(3);
+        std::atomic<uint32_t> sum{0};
+
+        jobs.parallel_for(0, 16, 1, [&](uint32_t, uint32_t) {
+            jobs.parallel_for(0, 100, 10, [&](uint32_t begin, uint32_t end) {
+                sum.fetch_add(end - begin);
+            });
+        });
+        CHECK(sum.load() == 1600);
+    }
+
+    TEST_CASE("spawn and wait") {
+        ecs::Jobs jobs(2);
+        ecs::JobCounter counter;
+        std::atomic<int> done{0};
+
+        for (int i = 0; i < 100; ++i)
+            jobs.spawn(counter, [&] { done.fetch_add(1); });
+        jobs.wait(counter);
+
+        CHECK(counter.done());
+        CHECK(done.load() == 100);
+    }
+
+    TEST_CASE("background tasks") {
+        for (uint32_t workers_count : {0u, 2u}) {
+            ecs::Jobs jobs(workers_count);
+            CAPTURE(workers_count);
+            const auto main_thread = std::this_thread::get_id();
+
+            ecs::JobCounter background;
+            std::atomic<bool> release{false};
+            std::atomic<bool> on_main{false};
+            std::atomic<int> nested{0};
+            jobs.spawn_background(background, [&] {
+                // Tasks spawned here are background too
+                ecs::JobCounter children;
+                for (int i = 0; i < 8; ++i)
+                    jobs.spawn(children, [&] {
+                        on_main = on_main || std::this_thread::get_id() == main_thread;
+                        nested.fetch_add(1);
+                    });
+                jobs.wait(children);
+
+                on_main = on_main || std::this_thread::get_id() == main_thread;
+                while (!release)
+                    std::this_thread::yield();
+            });
+
+            // Waiting for other tasks never picks up the background ones
+            for (int round = 0; round < 100; ++round) {
+                ecs::JobCounter counter;
+                std::atomic<int> done{0};
+                for (int i = 0; i < 4; ++i)
+                    jobs.spawn(counter, [&] { done.fetch_add(1); });
+                jobs.wait(counter);
+                CHECK(done.load() == 4);
+            }
+
+            release = true;
+            while (!background.done())
+                std::this_thread::yield();
+            CHECK(!on_main);
+            CHECK(nested.load() == 8);
+        }
+    }
+
+    TEST_CASE("wait runs background tasks of the counter") {
+        ecs::Jobs jobs(0);
+        ecs::JobCounter counter;
+        std::atomic<int> done{0};
+        for (int i = 0; i < 10; ++i)
+            jobs.spawn_background(counter, [&] { done.fetch_add(1); });
+        jobs.wait(counter);
+        CHECK(done.load() == 10);
+    }
+
+    TEST_CASE("task graph") {
+        for (uint32_t workers_count : {0u, 3u}) {
+            ecs::Jobs jobs(workers_count);
+            CAPTURE(workers_count);
+
+            std::mutex mutex;
+            std::vector<char> order;
+            auto record = [&](char c) {
+                return [&, c] {
+                    std::lock_guard lock(mutex);
+                    order.push_back(c);
+                };
+            };
+
+            // a -> {b, c} -> d
+            ecs::TaskGraph graph;
+            auto a = graph.add(record('a'));
+            auto b = graph.add(record('b'));
+            auto c = graph.add(record('c'));
+            auto d = graph.add(record('d'));
+            graph.precede(a, b);
+            graph.precede(a, c);
+            graph.precede(b, d);
+            graph.precede(c, d);
+
+            for (int run = 0; run < 2; ++run) {
+                order.clear();
+                jobs.run(graph);
+
+                REQUIRE(order.size() == 4);
+                CHECK(order.front() == 'a');
+                CHECK(order.back() == 'd');
+            }
+        }
+    }
+}
@@ -0,0 +1,136 @@
+#include "doctest.h"
+
+#include "ecs/paged_id_set.h"
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <vector>
+
+TEST_SUITE("ecs::PagedIdSet") {
+    template<typename Set>
+    static std::vector<ecs::Id> collect(const Set &set) {
+        std::vector<ecs::Id> ids;
+        for (ecs::Id id : set)
+            ids.push_back(id);
+        return ids;
+    }
+
+    TEST_CASE("empty") {
+        ecs::PagedIdSet set;
+        CHECK(set.size() == 0);
+        CHECK(set.empty());
+        CHECK(!set.contains(0));
+        CHECK(!set.contains(4000000000u));
+        CHECK(collect(set).empty());
+        CHECK(set.first() == set.capacity());
+    }
+
+    TEST_CASE("insert and erase") {
+        ecs::PagedIdSet set;
+        set.insert(100);
+        CHECK(set.levels_count() == 2);
+        CHECK(set.contains(100));
+        CHECK(!set.contains(101));
+
+        set.insert(100);
+        CHECK(set.size() == 1);
+
+        set.insert(4000000000u);
+        CHECK(set.levels_count() == ecs::PagedIdSet::max_levels);
+        CHECK(set.contains(100));
+        CHECK(set.contains(4000000000u));
+        CHECK(set.size() == 2);
+        CHECK(set.first() == 100);
+
+        CHECK(set.erase(100));
+        CHECK(!set.erase(100));
+        CHECK(!set.contains(100));
+        CHECK(set.first() == 4000000000u);
+
+        CHECK(set.erase(4000000000u));
+        CHECK(set.empty());
+        CHECK(set.first() == set.capacity());
+    }
+
+    TEST_CASE("memory is proportional to population") {
+        ecs::PagedIdSet set;
+        set.insert(ecs::PagedIdSet::max_size - 1);
+        CHECK(set.memory_usage() < 8 * 1024);
+
+        // Worst case: each id gets its own page on the two lower levels
+        for (ecs::Id i = 0; i < 1000; ++i)
+            set.insert(i * 1000003u);
+        CHECK(set.size() == 1001);
+        CHECK(set.memory_usage() < 4 * 1024 * 1024);
+
+        SUBCASE("pages are reused after erase") {
+            std::size_t memory = 0;
+            for (ecs::Id round = 0; round < 3; ++round) {
+                for (ecs::Id i = 0; i < 1000; ++i)
+                    CHECK(set.erase(i * 1000003u + round));
+                for (ecs::Id i = 0; i < 1000; ++i)
+                    set.insert(i * 1000003u + round + 1);
+                if (round > 0)
+                    CHECK(set.memory_usage() == memory);
+                memory = set.memory_usage();
+            }
+        }
+
+        SUBCASE("clear") {
+            set.clear();
+            CHECK(set.empty());
+            CHECK(set.levels_count() == 1);
+            CHECK(!set.contains(ecs::PagedIdSet::max_size - 1));
+            set.insert(7);
+            CHECK(collect(set) == std::vector<ecs::Id>{7});
+        }
+    }
+
+    TEST_CASE("random") {
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<ecs::Id> id_dist(0, ecs::PagedIdSet::max_size - 1);
+        std::uniform_int_distribution<ecs::Id> near_dist(0, 10000);
+
+        ecs::PagedIdSet set;
+        std::set<ecs::Id> expected;
+        for (int i = 0; i < 20000; ++i) {
+            ecs::Id id = i % 2 ? id_dist(rng) : near_dist(rng);
+            if (i % 3 == 0) {
+                CHECK(set.erase(id) == (expected.erase(id) > 0));
+            } else {
+                set.insert(id);
+                expected.insert(id);
+            }
+        }
+
+        CHECK(set.size() == expected.size());
+        CHECK(collect(set) == std::vector<ecs::Id>(expected.begin(), expected.end()));
+
+        std::vector<ecs::Id> blocks;
+        ecs::foreach(set, [&](ecs::Id id) { blocks.push_back(id); });
+        CHECK(blocks == std::vector<ecs::Id>(expected.begin(), expected.end()));
+    }
+
+    TEST_CASE("combined with id set") {
+        ecs::PagedIdSet paged;
+        for (ecs::Id id : {5u, 64u, 4096u, 70000u, 3000000000u})
+            paged.insert(id);
+
+        ecs::IdSet dense;
+        for (ecs::Id id : {5u, 6u, 4096u, 100000u})
+            dense.insert(id);
+
+        CHECK(collect(paged & dense) == std::vector<ecs::Id>{5, 4096});
+        CHECK(collect(paged | dense) == std::vector<ecs::Id>{5, 6, 64, 4096, 70000, 100000, 3000000000u});
+        CHECK(collect(paged & ~dense) == std::vector<ecs::Id>{64, 70000, 3000000000u});
+        CHECK((paged & dense).first() == 5);
+        CHECK(ecs::find_if(paged, [](ecs::Id id) { return id > 70000; }) == 3000000000u);
+
+        // IdSet::max_size is a valid id of PagedIdSet
+        ecs::PagedIdSet large;
+        large.insert(ecs::IdSet::max_size);
+        CHECK(ecs::find_if(large, [](ecs::Id) { return true; }) == ecs::IdSet::max_size);
+        CHECK(!ecs::find_if(large, [](ecs::Id id) { return id != ecs::IdSet::max_size; }));
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef HIGH_SHIFT_GL_CONTEXT_H
+#define HIGH_SHIFT_GL_CONTEXT_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+namespace {
+    /**
+     * Hidden window whose GL context is current while the object lives.
+     * Converts to false if there is no display, tests are skipped then.
+     */
+    class GLContext {
+    public:
+        GLContext() {
+            if (!glfwInit())
+                return;
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+            glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+            glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+            window = glfwCreateWindow(64, 64, "tests", nullptr, nullptr);
+            if (!window)
+                return;
+
+            glfwMakeContextCurrent(window);
+            if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
+                glfwDestroyWindow(window);
+                window = nullptr;
+            }
+        }
+
+        GLContext(const GLContext &) = delete;
+        GLContext &operator=(const GLContext &) = delete;
+
+        ~GLContext() {
+            if (window)
+                glfwDestroyWindow(window);
+            glfwTerminate();
+        }
+
+        explicit operator bool() const {
+            return window != nullptr;
+        }
+
+    private:
+        GLFWwindow *window = nullptr;
+    };
+}
+
+#endif //HIGH_SHIFT_GL_CONTEXT_H
@@ -0,0 +1,167 @@
+#include "doctest.h"
+
+#include "render/mesh_optimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <random>
+
+TEST_SUITE("render::mesh_optimizer") {
+    struct Grid {
+        std::vector<render::Vertex> vertices;
+        std::vector<unsigned int> indices;
+    };
+
+    // size x size quads of two triangles in the xy plane, row by row or in random order if seed is not zero
+    static Grid make_grid(uint32_t size, unsigned int seed) {
+        Grid grid;
+        for (uint32_t y = 0; y <= size; ++y)
+            for (uint32_t x = 0; x <= size; ++x)
+                grid.vertices.push_back(render::Vertex{
+                        .position = {(float) x, (float) y, 0.0f},
+                        .normal = {0.0f, 0.0f, 1.0f},
+                        .tex_coords = {(float) x / size, (float) y / size}
+                });
+
+        std::vector<std::array<unsigned int, 3>> triangles;
+        for (uint32_t y = 0; y < size; ++y)
+            for (uint32_t x = 0; x < size; ++x) {
+                unsigned int v = y * (size + 1) + x;
+                triangles.push_back({v, v + 1, v + size + 2});
+                triangles.push_back({v, v + size + 2, v + size + 1});
+            }
+        if (seed != 0)
+            std::shuffle(triangles.begin(), triangles.end(), std::mt19937(seed));
+        for (const auto &triangle : triangles)
+            grid.indices.insert(grid.indices.end(), triangle.begin(), triangle.end());
+        return grid;
+    }
+
+    static bool same_vertex(const render::Vertex &a, const render::Vertex &b) {
+        return std::memcmp(&a, &b, sizeof(render::Vertex)) == 0;
+    }
+
+    // Triangles as vertex data, sorted, so that meshes are compared regardless of indexing and order
+    static std::vector<std::array<float, 24>> triangles(std::span<const render::Vertex> vertices,
+                                                        std::span<const unsigned int> indices) {
+        std::vector<std::array<float, 24>> result(indices.size() / 3);
+        for (std::size_t i = 0; i < indices.size(); ++i)
+            std::memcpy(result[i / 3].data() + (i % 3) * 8, &vertices[indices[i]], sizeof(render::Vertex));
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    TEST_CASE("vertex cache and overdraw reorder triangles") {
+        Grid grid = make_grid(32, 1);
+        const auto original = triangles(grid.vertices, grid.indices);
+        float acmr_before = render::average_cache_miss_ratio(grid.indices, grid.vertices.size());
+
+        render::optimize_vertex_cache(grid.indices, grid.vertices.size());
+        CHECK(triangles(grid.vertices, grid.indices) == original);
+        float acmr_cache = render::average_cache_miss_ratio(grid.indices, grid.vertices.size());
+        CHECK(acmr_cache <= acmr_before);
+        CHECK(acmr_cache < 1.0f); // a grid has 0.5 vertices per triangle, random order is close to 3
+
+        render::optimize_overdraw(grid.indices, grid.vertices);
+        CHECK(triangles(grid.vertices, grid.indices) == original);
+        CHECK(render::average_cache_miss_ratio(grid.indices, grid.vertices.size()) <= acmr_cache * 1.05f);
+    }
+
+    TEST_CASE("vertex cache of a grid in rows") {
+        // Rows longer than the cache load every vertex twice
+        Grid grid = make_grid(64, 0);
+        const auto original = triangles(grid.vertices, grid.indices);
+        float acmr_before = render::average_cache_miss_ratio(grid.indices, grid.vertices.size());
+        CHECK(acmr_before == doctest::Approx(1.0f).epsilon(0.05));
+
+        render::optimize_vertex_cache(grid.indices, grid.vertices.size());
+        CHECK(triangles(grid.vertices, grid.indices) == original);
+        CHECK(render::average_cache_miss_ratio(grid.indices, grid.vertices.size()) < acmr_before);
+    }
+
+    TEST_CASE("average cache miss ratio") {
+        std::vector<unsigned int> indices{0, 1, 2, 2, 1, 3};
+        CHECK(render::average_cache_miss_ratio(indices, 4) == doctest::Approx(2.0f));
+        CHECK(render::average_cache_miss_ratio({}, 0) == 0.0f);
+
+        // Every vertex is evicted before its reuse
+        std::vector<unsigned int> thrashing;
+        for (unsigned int round = 0; round < 2; ++round)
+            for (unsigned int v = 0; v < 3 * 8; ++v)
+                thrashing.push_back(v);
+        CHECK(render::average_cache_miss_ratio(thrashing, 24, 8) == doctest::Approx(3.0f));
+        CHECK(render::average_cache_miss_ratio(thrashing, 24, 24) == doctest::Approx(1.5f));
+    }
+
+    TEST_CASE("deduplicate and fetch keep geometry") {
+        Grid grid = make_grid(16, 3);
+        const auto original = triangles(grid.vertices, grid.indices);
+
+        // Unindexed copy: every corner has its own vertex, plus an unused one
+        std::vector<render::Vertex> vertices;
+        std::vector<unsigned int> indices;
+        for (unsigned int index : grid.indices) {
+            indices.push_back((unsigned int) vertices.size());
+            vertices.push_back(grid.vertices[index]);
+        }
+        vertices.push_back(render::Vertex{.position = {-1.0f, -1.0f, -1.0f}});
+
+        render::deduplicate_vertices(vertices, indices);
+        CHECK(vertices.size() == grid.vertices.size() + 1);
+        bool unique = true;
+        for (std::size_t i = 0; i < vertices.size(); ++i)
+            for (std::size_t j = i + 1; j < vertices.size(); ++j)
+                unique &= !same_vertex(vertices[i], vertices[j]);
+        CHECK(unique);
+        CHECK(triangles(vertices, indices) == original);
+
+        render::optimize_vertex_fetch(vertices, indices);
+        CHECK(vertices.size() == grid.vertices.size()); // the unused vertex is dropped
+        CHECK(triangles(vertices, indices) == original);
+
+        // Vertices are in the order of their first use
+        unsigned int next = 0;
+        for (unsigned int index : indices) {
+            CHECK(index <= next);
+            if (index == next)
+                ++next;
+        }
+        CHECK(next == vertices.size());
+    }
+
+    TEST_CASE("optimize_mesh") {
+        Grid grid = make_grid(24, 4);
+        const auto original = triangles(grid.vertices, grid.indices);
+
+        auto report = render::optimize_mesh(grid.vertices, grid.indices);
+        CHECK(triangles(grid.vertices, grid.indices) == original);
+        CHECK(report.before.indices_count == report.after.indices_count);
+        CHECK(report.after.acmr <= report.before.acmr);
+        CHECK(report.after.bytes < report.before.bytes); // 16-bit indices
+    }
+
+    TEST_CASE("index packing") {
+        CHECK(render::index_size(0) == 2);
+        CHECK(render::index_size(65536) == 2); // the largest index is 65535
+        CHECK(render::index_size(65537) == 4);
+
+        std::vector<unsigned int> indices{0, 1, 65535, 7};
+        auto packed = render::pack_indices(indices, render::index_size(65536));
+        REQUIRE(packed.size() == indices.size() * sizeof(uint16_t));
+        for (std::size_t i = 0; i < indices.size(); ++i) {
+            uint16_t index;
+            std::memcpy(&index, packed.data() + i * sizeof(uint16_t), sizeof(uint16_t));
+            CHECK(index == indices[i]);
+        }
+
+        indices.push_back(65536);
+        packed = render::pack_indices(indices, render::index_size(65537));
+        REQUIRE(packed.size() == indices.size() * sizeof(uint32_t));
+        for (std::size_t i = 0; i < indices.size(); ++i) {
+            uint32_t index;
+            std::memcpy(&index, packed.data() + i * sizeof(uint32_t), sizeof(uint32_t));
+            CHECK(index == indices[i]);
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#include "doctest.h"
+
+#include "render/model_loader.h"
+#include "gl_context.h"
+
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+TEST_SUITE("render::ModelLoader") {
+    // A textured quad and its 2x2 texture
+    static fs::path write_model() {
+        fs::path dir = fs::temp_directory_path() / "high_shift_test_model_loader";
+        fs::create_directories(dir);
+
+        std::ofstream(dir / "quad.obj") << "mtllib quad.mtl\n"
+                                           "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+                                           "vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+                                           "vn 0 0 1\n"
+                                           "usemtl textured\n"
+                                           "f 1/1/1 2/2/1 3/3/1\nf 1/1/1 3/3/1 4/4/1\n";
+        std::ofstream(dir / "quad.mtl") << "newmtl textured\nmap_Kd quad.ppm\n";
+        std::ofstream texture(dir / "quad.ppm", std::ios::binary);
+        texture << "P6\n2 2\n255\n";
+        for (int i = 0; i < 4; ++i)
+            texture << (char) (i * 60) << (char) 128 << (char) 255;
+        return dir;
+    }
+
+    TEST_CASE("unload with textures while loading") {
+        GLContext context;
+        if (!context) {
+            MESSAGE("no display, skipped");
+            return;
+        }
+
+        fs::path dir = write_model();
+        ecs::Jobs jobs(1);
+        render::GLStateCache gl_state;
+        render::TextureLoader texture_loader(gl_state, jobs);
+        texture_loader.set_cache_directory({});
+        render::MeshPool mesh_pool(gl_state);
+        render::ModelLoader model_loader(texture_loader, mesh_pool, jobs);
+        model_loader.set_cache_directory({});
+
+        // The model gets the same texture handle, so its state tells whether the model released it
+        auto texture = texture_loader.load_from_file(dir / "quad.ppm", render::Texture2d::diffuse);
+        REQUIRE(texture);
+
+        auto model = model_loader.load_model_async(dir / "quad.obj");
+        CHECK(model_loader.unload_model_and_textures(model));
+        CHECK(model_loader.get_state(model) == ResourceState::invalid);
+
+        // Frames until the parsed model is dropped
+        for (int frame = 0; frame < 5000 && texture_loader.get_state(*texture) != ResourceState::invalid; ++frame) {
+            render::UploadScope scope(render::UploadBudget{});
+            model_loader.upload_pending(scope);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        CHECK(texture_loader.get_state(*texture) == ResourceState::invalid);
+    }
+}
@@ -0,0 +1,187 @@
+#include "doctest.h"
+
+#include "render/texture_cooker.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <random>
+
+TEST_SUITE("render::cook_texture") {
+    // Reference decoders of a single 4x4 block, pixels in rows
+
+    static void decode_color_block(const std::byte *block, uint8_t pixels[16][4]) {
+        uint16_t c[2];
+        uint32_t indices;
+        std::memcpy(c, block, 4);
+        std::memcpy(&indices, block + 4, 4);
+
+        int palette[4][3];
+        for (int e = 0; e < 2; ++e) {
+            int r = c[e] >> 11 & 31, g = c[e] >> 5 & 63, b = c[e] & 31;
+            palette[e][0] = r << 3 | r >> 2;
+            palette[e][1] = g << 2 | g >> 4;
+            palette[e][2] = b << 3 | b >> 2;
+        }
+        for (int ch = 0; ch < 3; ++ch) {
+            if (c[0] > c[1]) {
+                palette[2][ch] = (2 * palette[0][ch] + palette[1][ch]) / 3;
+                palette[3][ch] = (palette[0][ch] + 2 * palette[1][ch]) / 3;
+            } else {
+                palette[2][ch] = (palette[0][ch] + palette[1][ch]) / 2;
+                palette[3][ch] = 0;
+            }
+        }
+        for (int i = 0; i < 16; ++i)
+            for (int ch = 0; ch < 3; ++ch)
+                pixels[i][ch] = (uint8_t) palette[indices >> (2 * i) & 3][ch];
+    }
+
+    static void decode_channel_block(const std::byte *block, int channel, uint8_t pixels[16][4]) {
+        int a0 = (int) block[0], a1 = (int) block[1];
+        uint64_t indices = 0;
+        for (int b = 0; b < 6; ++b)
+            indices |= (uint64_t) block[2 + b] << (8 * b);
+
+        int values[8] = {a0, a1};
+        if (a0 > a1) {
+            for (int v = 2; v < 8; ++v)
+                values[v] = ((8 - v) * a0 + (v - 1) * a1) / 7;
+        } else {
+            for (int v = 2; v < 6; ++v)
+                values[v] = ((6 - v) * a0 + (v - 1) * a1) / 5;
+            values[6] = 0;
+            values[7] = 255;
+        }
+        for (int i = 0; i < 16; ++i)
+            pixels[i][channel] = (uint8_t) values[indices >> (3 * i) & 7];
+    }
+
+    static void decode_block(const render::CookedTexture &texture, uint8_t pixels[16][4]) {
+        const std::byte *block = texture.levels[0].data();
+        switch (texture.format) {
+            case render::TextureFormat::bc1:
+                decode_color_block(block, pixels);
+                break;
+            case render::TextureFormat::bc3:
+                decode_channel_block(block, 3, pixels);
+                decode_color_block(block + 8, pixels);
+                break;
+            case render::TextureFormat::bc5:
+                decode_channel_block(block, 0, pixels);
+                decode_channel_block(block + 8, 1, pixels);
+                break;
+        }
+    }
+
+    // Largest differences between the channels of the source pixels and of the decoded 4x4 texture
+    static std::array<int, 4> block_errors(const std::vector<uint8_t> &source, int channels) {
+        ecs::Jobs jobs(0);
+        auto texture = render::cook_texture(source.data(), 4, 4, channels, jobs);
+        uint8_t pixels[16][4];
+        decode_block(texture, pixels);
+
+        std::array<int, 4> errors{};
+        for (int i = 0; i < 16; ++i)
+            for (int c = 0; c < channels; ++c)
+                errors[c] = std::max(errors[c], std::abs(pixels[i][c] - source[i * channels + c]));
+        return errors;
+    }
+
+    static int max_error(const std::array<int, 4> &errors) {
+        return *std::max_element(errors.begin(), errors.end());
+    }
+
+    TEST_CASE("solid blocks") {
+        // 565 endpoints are exact up to the bits they drop
+        std::vector<uint8_t> rgb;
+        for (int i = 0; i < 16; ++i)
+            rgb.insert(rgb.end(), {200, 100, 50});
+        CHECK(max_error(block_errors(rgb, 3)) <= 4);
+
+        std::vector<uint8_t> rgba;
+        for (int i = 0; i < 16; ++i)
+            rgba.insert(rgba.end(), {10, 250, 128, 77});
+        auto rgba_errors = block_errors(rgba, 4);
+        CHECK(max_error(rgba_errors) <= 4);
+        CHECK(rgba_errors[3] == 0);
+
+        std::vector<uint8_t> rg;
+        for (int i = 0; i < 16; ++i)
+            rg.insert(rg.end(), {33, 222});
+        CHECK(max_error(block_errors(rg, 2)) == 0);
+    }
+
+    TEST_CASE("gradient blocks") {
+        std::vector<uint8_t> rgb, rgba, rg;
+        for (int i = 0; i < 16; ++i) {
+            auto t = (uint8_t) (i * 16);
+            rgb.insert(rgb.end(), {t, (uint8_t) (255 - t), 64});
+            rgba.insert(rgba.end(), {t, t, t, (uint8_t) (255 - t)});
+            rg.insert(rg.end(), {t, (uint8_t) (t / 2)});
+        }
+
+        // Colors are on a line, four points of it are a third of the range apart
+        CHECK(max_error(block_errors(rgb, 3)) <= 48);
+        auto rgba_errors = block_errors(rgba, 4);
+        CHECK(std::max({rgba_errors[0], rgba_errors[1], rgba_errors[2]}) <= 48);
+        // Eight values, a seventh of the range apart
+        CHECK(rgba_errors[3] <= 20);
+        CHECK(max_error(block_errors(rg, 2)) <= 20);
+    }
+
+    TEST_CASE("formats") {
+        ecs::Jobs jobs(0);
+        std::vector<uint8_t> pixels(4 * 4 * 4, 255);
+        CHECK(render::cook_texture(pixels.data(), 4, 4, 1, jobs).format == render::TextureFormat::bc1);
+        CHECK(render::cook_texture(pixels.data(), 4, 4, 2, jobs).format == render::TextureFormat::bc5);
+        CHECK(render::cook_texture(pixels.data(), 4, 4, 3, jobs).format == render::TextureFormat::bc1);
+        CHECK(render::cook_texture(pixels.data(), 4, 4, 4, jobs).format == render::TextureFormat::bc1); // opaque
+        pixels[3] = 0;
+        CHECK(render::cook_texture(pixels.data(), 4, 4, 4, jobs).format == render::TextureFormat::bc3);
+    }
+
+    TEST_CASE("levels of NPOT images") {
+        ecs::Jobs jobs(2);
+        struct Case {
+            uint32_t width, height;
+            std::vector<std::size_t> level_blocks;
+        };
+        for (const auto &[width, height, level_blocks] : {
+                Case{5, 3, {2, 1, 1}}, // 5x3, 2x1, 1x1
+                Case{1, 7, {2, 1, 1}}, // 1x7, 1x3, 1x1
+                Case{13, 6, {8, 2, 1, 1}}, // 13x6, 6x3, 3x1, 1x1
+                Case{16, 16, {16, 4, 1, 1, 1}}}) {
+            CAPTURE(width);
+            CAPTURE(height);
+            std::vector<uint8_t> pixels((std::size_t) width * height * 3, 90);
+            auto texture = render::cook_texture(pixels.data(), width, height, 3, jobs);
+            CHECK(texture.width == width);
+            CHECK(texture.height == height);
+            REQUIRE(texture.levels.size() == level_blocks.size());
+            for (std::size_t level = 0; level < level_blocks.size(); ++level)
+                CHECK(texture.levels[level].size() == level_blocks[level] * render::block_size(texture.format));
+        }
+    }
+
+    TEST_CASE("SIMD and scalar mips match") {
+        std::mt19937 random(3);
+        std::uniform_int_distribution<int> byte(0, 255);
+        for (uint32_t workers_count : {0u, 2u}) {
+            ecs::Jobs jobs(workers_count);
+            for (auto [width, height] : {std::pair<uint32_t, uint32_t>{16, 8}, {17, 9}, {8, 3}, {10, 10},
+                                         {1, 5}, {64, 33}, {130, 2}}) {
+                CAPTURE(width);
+                CAPTURE(height);
+                std::vector<uint8_t> rgba((std::size_t) width * height * 4);
+                for (auto &value : rgba)
+                    value = (uint8_t) byte(random);
+
+                auto simd = render::detail::downsample(rgba, width, height, true, jobs);
+                auto scalar = render::detail::downsample(rgba, width, height, false, jobs);
+                CHECK(simd.size() == (std::size_t) std::max(1u, width / 2) * std::max(1u, height / 2) * 4);
+                CHECK(simd == scalar);
+            }
+        }
+    }
+}
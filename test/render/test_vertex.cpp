@@ -0,0 +1,145 @@
+#include "doctest.h"
+
+#include "render/vertex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+TEST_SUITE("render::encode_vertices") {
+    static std::vector<render::Vertex> random_vertices(std::size_t count, float extent, unsigned int seed) {
+        std::mt19937 random(seed);
+        std::uniform_real_distribution<float> position(-extent / 2, extent / 2);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        std::uniform_real_distribution<float> tex(0.0f, 1.0f);
+
+        std::vector<render::Vertex> vertices(count);
+        for (auto &vertex : vertices) {
+            vertex.position = glm::vec3(position(random), position(random), position(random)) + glm::vec3(100.0f);
+            vertex.normal = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.0f, 0.0f, 2.0f));
+            vertex.tex_coords = {tex(random), tex(random)};
+        }
+        return vertices;
+    }
+
+    static float max_error(const glm::vec3 &a, const glm::vec3 &b) {
+        glm::vec3 d = glm::abs(a - b);
+        return std::max({d.x, d.y, d.z});
+    }
+
+    TEST_CASE("layouts") {
+        using Format = render::VertexFormat;
+        struct Case {
+            uint32_t flags, stride, normal_offset, tex_coords_offset;
+        };
+        for (const auto &[flags, stride, normal_offset, tex_coords_offset] : {
+                Case{0, 32, 12, 24},
+                Case{Format::quantized_positions, 28, 8, 20},
+                Case{Format::packed_normals, 24, 12, 16},
+                Case{Format::half_tex_coords, 28, 12, 24},
+                Case{Format::quantized_positions | Format::packed_normals | Format::half_tex_coords, 16, 8, 12}}) {
+            CAPTURE(flags);
+            Format format{flags};
+            CHECK(format.stride() == stride);
+            CHECK(format.normal_offset() == normal_offset);
+            CHECK(format.tex_coords_offset() == tex_coords_offset);
+        }
+    }
+
+    TEST_CASE("compact round trip") {
+        const float extent = 10.0f;
+        auto vertices = random_vertices(1000, extent, 1);
+        render::VertexQuantization tolerance;
+        auto encoded = render::encode_vertices(vertices, tolerance);
+
+        CHECK(encoded.format.flags == (render::VertexFormat::quantized_positions | render::VertexFormat::packed_normals |
+                                       render::VertexFormat::half_tex_coords));
+        CHECK(encoded.data.size() == vertices.size() * encoded.format.stride());
+
+        auto decoded = render::decode_vertices(encoded.data, encoded.format, encoded.dequantization);
+        REQUIRE(decoded.size() == vertices.size());
+        float position_error = 0.0f, normal_error = 0.0f, tex_coords_error = 0.0f;
+        for (std::size_t i = 0; i < vertices.size(); ++i) {
+            position_error = std::max(position_error, max_error(decoded[i].position, vertices[i].position));
+            normal_error = std::max(normal_error, max_error(decoded[i].normal, vertices[i].normal));
+            tex_coords_error = std::max(tex_coords_error, max_error(glm::vec3(decoded[i].tex_coords, 0.0f),
+                                                                    glm::vec3(vertices[i].tex_coords, 0.0f)));
+        }
+        CHECK(position_error <= tolerance.position_error * extent);
+        CHECK(normal_error <= tolerance.normal_error);
+        CHECK(tex_coords_error <= tolerance.tex_coords_error);
+
+        // Positions are the signed 16-bit integers of the dequantization
+        int16_t quantized[3];
+        std::memcpy(quantized, encoded.data.data(), sizeof(quantized));
+        glm::vec3 position = encoded.dequantization.offset + glm::vec3(quantized[0], quantized[1], quantized[2]) *
+                                                             encoded.dequantization.scale;
+        CHECK(position == decoded[0].position);
+    }
+
+    TEST_CASE("lossless without tolerance") {
+        auto vertices = random_vertices(100, 3.0f, 2);
+        auto encoded = render::encode_vertices(vertices, render::VertexQuantization{0.0f, 0.0f, 0.0f});
+        CHECK(encoded.format.flags == 0);
+        CHECK(encoded.data.size() == vertices.size() * 32);
+        CHECK(encoded.dequantization.scale == 1.0f);
+        CHECK(encoded.dequantization.offset == glm::vec3(0.0f));
+
+        // Full floats at the offsets of the format
+        for (std::size_t i = 0; i < vertices.size(); ++i) {
+            const std::byte *vertex = encoded.data.data() + i * encoded.format.stride();
+            glm::vec3 position, normal;
+            glm::vec2 tex_coords;
+            std::memcpy(&position, vertex, sizeof(position));
+            std::memcpy(&normal, vertex + encoded.format.normal_offset(), sizeof(normal));
+            std::memcpy(&tex_coords, vertex + encoded.format.tex_coords_offset(), sizeof(tex_coords));
+            CHECK(position == vertices[i].position);
+            CHECK(normal == vertices[i].normal);
+            CHECK(tex_coords == vertices[i].tex_coords);
+        }
+
+        auto decoded = render::decode_vertices(encoded.data, encoded.format, encoded.dequantization);
+        REQUIRE(decoded.size() == vertices.size());
+        CHECK(std::memcmp(decoded.data(), vertices.data(), vertices.size() * sizeof(render::Vertex)) == 0);
+    }
+
+    TEST_CASE("attributes out of tolerance stay floats") {
+        auto vertices = random_vertices(100, 1.0f, 3);
+
+        SUBCASE("NaN normals") {
+            vertices[10].normal = glm::vec3(NAN);
+            auto encoded = render::encode_vertices(vertices, render::VertexQuantization{});
+            CHECK(!(encoded.format.flags & render::VertexFormat::packed_normals));
+            CHECK((encoded.format.flags & render::VertexFormat::quantized_positions) != 0);
+            CHECK((encoded.format.flags & render::VertexFormat::half_tex_coords) != 0);
+
+            auto decoded = render::decode_vertices(encoded.data, encoded.format, encoded.dequantization);
+            CHECK(std::isnan(decoded[10].normal.x));
+            CHECK(decoded[11].normal == vertices[11].normal);
+        }
+
+        SUBCASE("texture coordinates beyond half precision") {
+            vertices[5].tex_coords = {1000.3f, 0.5f};
+            auto encoded = render::encode_vertices(vertices, render::VertexQuantization{});
+            CHECK(!(encoded.format.flags & render::VertexFormat::half_tex_coords));
+            auto decoded = render::decode_vertices(encoded.data, encoded.format, encoded.dequantization);
+            CHECK(decoded[5].tex_coords == vertices[5].tex_coords);
+        }
+
+        SUBCASE("positions beyond 16 bits over the extent") {
+            vertices[0].position = glm::vec3(1e5f);
+            vertices[1].position = vertices[2].position + glm::vec3(1e-3f, 0.0f, 0.0f);
+            auto encoded = render::encode_vertices(vertices, render::VertexQuantization{.position_error = 1e-9f});
+            CHECK(!(encoded.format.flags & render::VertexFormat::quantized_positions));
+            auto decoded = render::decode_vertices(encoded.data, encoded.format, encoded.dequantization);
+            CHECK(decoded[1].position == vertices[1].position);
+        }
+    }
+
+    TEST_CASE("empty") {
+        auto encoded = render::encode_vertices({}, render::VertexQuantization{});
+        CHECK(encoded.data.empty());
+        CHECK(render::decode_vertices(encoded.data, encoded.format, encoded.dequantization).empty());
+    }
+}